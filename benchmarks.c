@@ -0,0 +1,317 @@
+/*
+ SPDX-License-Identifier: MIT
+
+ Parson (https://github.com/kgabis/parson)
+ Copyright (c) 2012 - 2023 Krzysztof Gabis
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+/* Parse and serialize throughput harness. Each corpus stresses one hot path
+   (mixed structure, number parsing/formatting, string processing, nesting
+   bookkeeping), so a regression in that path shows up in its corpus. Run with
+   no arguments to print a report, with '--record <file>' to save the numbers
+   as a baseline, and with '--check <file>' to fail (exit 1) when any corpus
+   drops below BENCH_REGRESSION_FACTOR of the recorded baseline. */
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if defined(__unix__) || defined(__unix) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define BENCH_POSIX
+#endif
+
+#include "parson.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef BENCH_POSIX
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#define BENCH_MIN_SECONDS 0.4 /* per corpus and phase; repetitions adapt to this */
+#define BENCH_REGRESSION_FACTOR 0.7
+#define BENCH_MAX_CORPORA 8
+
+typedef struct bench_result {
+    const char *name;
+    double parse_mbs;
+    double serialize_mbs;
+} Bench_Result;
+
+static const char *g_tests_path = "tests";
+
+static double now_seconds(void) {
+#ifdef BENCH_POSIX
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+    }
+#endif
+    return (double)clock() / (double)CLOCKS_PER_SEC;
+}
+
+static double peak_rss_megabytes(void) {
+#ifdef BENCH_POSIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return (double)usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+        return (double)usage.ru_maxrss / 1024.0;
+#endif
+    }
+#endif
+    return 0;
+}
+
+static char * read_file_or_die(const char *filename) {
+    FILE *fp = fopen(filename, "r");
+    long pos = 0;
+    size_t size_read = 0;
+    char *contents = NULL;
+    if (fp == NULL) {
+        printf("Failed to open %s (run from the repository root)\n", filename);
+        exit(1);
+    }
+    fseek(fp, 0L, SEEK_END);
+    pos = ftell(fp);
+    rewind(fp);
+    contents = (char*)malloc((size_t)pos + 1);
+    if (contents == NULL) {
+        exit(1);
+    }
+    size_read = fread(contents, 1, (size_t)pos, fp);
+    fclose(fp);
+    contents[size_read] = '\0';
+    return contents;
+}
+
+/* ~4 MB array of objects full of mixed-magnitude doubles and integers;
+   dominated by parse_number and the number formatter. */
+static char * generate_number_corpus(void) {
+    size_t capacity = 5 * 1024 * 1024;
+    char *buf = (char*)malloc(capacity);
+    size_t len = 0;
+    unsigned long seed = 123456789UL;
+    int i = 0;
+    if (buf == NULL) {
+        exit(1);
+    }
+    len += (size_t)sprintf(buf + len, "[");
+    for (i = 0; len < capacity - 256 && i < 1000000; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        len += (size_t)sprintf(buf + len, "%s{\"i\":%lu,\"f\":%lu.%04lu,\"e\":%lu.%lue%d}",
+            i > 0 ? "," : "", seed % 100000UL, seed % 1000UL, (seed >> 8) % 10000UL,
+            seed % 10UL, (seed >> 4) % 1000UL, (int)(seed % 40UL) - 20);
+    }
+    len += (size_t)sprintf(buf + len, "]");
+    return buf;
+}
+
+/* ~4 MB of string values mixing clean runs, escapes and multi-byte UTF-8;
+   dominated by process_string and json_serialize_string. */
+static char * generate_string_corpus(void) {
+    size_t capacity = 5 * 1024 * 1024;
+    char *buf = (char*)malloc(capacity);
+    size_t len = 0;
+    int i = 0;
+    if (buf == NULL) {
+        exit(1);
+    }
+    len += (size_t)sprintf(buf + len, "[");
+    for (i = 0; len < capacity - 512; i++) {
+        len += (size_t)sprintf(buf + len,
+            "%s\"plain text with no escapes at all, just words %d\","
+            "\"quoted \\\"part\\\" and\\na line break\\twith tab %d\","
+            "\"unicode \\u00e9\\u00e8 and utf8 z\\u00f3\\u0142w %d\"",
+            i > 0 ? "," : "", i, i, i);
+    }
+    len += (size_t)sprintf(buf + len, "]");
+    return buf;
+}
+
+/* 1000 levels of nesting repeated side by side; dominated by the parser's
+   stack handling and the serializer's recursion over containers. */
+static char * generate_deep_corpus(void) {
+    size_t capacity = 5 * 1024 * 1024;
+    char *buf = (char*)malloc(capacity);
+    size_t len = 0;
+    int depth = 1000;
+    int i = 0, d = 0;
+    if (buf == NULL) {
+        exit(1);
+    }
+    len += (size_t)sprintf(buf + len, "[");
+    for (i = 0; len < capacity - 3 * (size_t)depth - 256; i++) {
+        if (i > 0) {
+            buf[len++] = ',';
+        }
+        for (d = 0; d < depth; d++) {
+            len += (size_t)sprintf(buf + len, d % 2 == 0 ? "[" : "{\"k\":");
+        }
+        buf[len++] = '1';
+        for (d = depth - 1; d >= 0; d--) {
+            buf[len++] = d % 2 == 0 ? ']' : '}';
+        }
+    }
+    len += (size_t)sprintf(buf + len, "]");
+    buf[len] = '\0';
+    return buf;
+}
+
+static void bench_corpus(const char *name, const char *data, Bench_Result *result) {
+    JSON_Parser parser = json_get_default_parser();
+    double bytes = (double)strlen(data);
+    double start = 0, elapsed = 0;
+    int reps = 0;
+    JSON_Value *value = NULL;
+    char *serialized = NULL;
+
+    result->name = name;
+
+    /* parse throughput */
+    elapsed = 0;
+    reps = 0;
+    while (elapsed < BENCH_MIN_SECONDS) {
+        start = now_seconds();
+        value = json_parse_string(&parser, data);
+        elapsed += now_seconds() - start;
+        if (value == NULL) {
+            printf("%s: parse failed\n", name);
+            exit(1);
+        }
+        reps++;
+        if (elapsed < BENCH_MIN_SECONDS) {
+            json_value_free(&parser, value);
+            value = NULL;
+        }
+    }
+    result->parse_mbs = bytes * reps / elapsed / (1024.0 * 1024.0);
+
+    /* serialize throughput over the last parsed tree */
+    elapsed = 0;
+    reps = 0;
+    while (elapsed < BENCH_MIN_SECONDS) {
+        start = now_seconds();
+        serialized = json_serialize_to_string(&parser, value);
+        elapsed += now_seconds() - start;
+        if (serialized == NULL) {
+            printf("%s: serialization failed\n", name);
+            exit(1);
+        }
+        reps++;
+        json_free_serialized_string(&parser, serialized);
+    }
+    result->serialize_mbs = bytes * reps / elapsed / (1024.0 * 1024.0);
+    json_value_free(&parser, value);
+
+    printf("%-12s %10.1f MB %8.1f MB/s parse %8.1f MB/s serialize\n",
+        name, bytes / (1024.0 * 1024.0), result->parse_mbs, result->serialize_mbs);
+}
+
+static int write_baseline(const char *filename, const Bench_Result *results, int count) {
+    FILE *fp = fopen(filename, "w");
+    int i = 0;
+    if (fp == NULL) {
+        printf("Failed to open %s for writing\n", filename);
+        return 1;
+    }
+    for (i = 0; i < count; i++) {
+        fprintf(fp, "%s %.1f %.1f\n", results[i].name, results[i].parse_mbs, results[i].serialize_mbs);
+    }
+    fclose(fp);
+    printf("Baseline recorded to %s\n", filename);
+    return 0;
+}
+
+static int check_baseline(const char *filename, const Bench_Result *results, int count) {
+    FILE *fp = fopen(filename, "r");
+    char name[64];
+    double parse_mbs = 0, serialize_mbs = 0;
+    int i = 0;
+    int failures = 0;
+    if (fp == NULL) {
+        printf("Failed to open baseline %s\n", filename);
+        return 1;
+    }
+    while (fscanf(fp, "%63s %lf %lf", name, &parse_mbs, &serialize_mbs) == 3) {
+        for (i = 0; i < count; i++) {
+            if (strcmp(results[i].name, name) != 0) {
+                continue;
+            }
+            if (results[i].parse_mbs < parse_mbs * BENCH_REGRESSION_FACTOR) {
+                printf("REGRESSION %s parse: %.1f MB/s vs baseline %.1f MB/s\n",
+                    name, results[i].parse_mbs, parse_mbs);
+                failures++;
+            }
+            if (results[i].serialize_mbs < serialize_mbs * BENCH_REGRESSION_FACTOR) {
+                printf("REGRESSION %s serialize: %.1f MB/s vs baseline %.1f MB/s\n",
+                    name, results[i].serialize_mbs, serialize_mbs);
+                failures++;
+            }
+        }
+    }
+    fclose(fp);
+    if (failures == 0) {
+        printf("All corpora within %.0f%% of baseline\n", BENCH_REGRESSION_FACTOR * 100.0);
+    }
+    return failures > 0;
+}
+
+int main(int argc, char *argv[]) {
+    Bench_Result results[BENCH_MAX_CORPORA];
+    int count = 0;
+    char path[256];
+    char *mixed = NULL, *numbers = NULL, *strings = NULL, *deep = NULL;
+    int exit_code = 0;
+
+    sprintf(path, "%s/test_2.txt", g_tests_path);
+    mixed = read_file_or_die(path);
+    numbers = generate_number_corpus();
+    strings = generate_string_corpus();
+    deep = generate_deep_corpus();
+
+    bench_corpus("mixed", mixed, &results[count++]);
+    bench_corpus("numbers", numbers, &results[count++]);
+    bench_corpus("strings", strings, &results[count++]);
+    bench_corpus("deep", deep, &results[count++]);
+    printf("peak RSS: %.1f MB\n", peak_rss_megabytes());
+
+    if (argc == 3 && strcmp(argv[1], "--record") == 0) {
+        exit_code = write_baseline(argv[2], results, count);
+    } else if (argc == 3 && strcmp(argv[1], "--check") == 0) {
+        exit_code = check_baseline(argv[2], results, count);
+    } else if (argc != 1) {
+        printf("Usage: %s [--record <baseline>|--check <baseline>]\n", argv[0]);
+        exit_code = 1;
+    }
+
+    free(mixed);
+    free(numbers);
+    free(strings);
+    free(deep);
+    return exit_code;
+}
@@ -26,8 +26,22 @@
 #ifndef _CRT_SECURE_NO_WARNINGS
 #define _CRT_SECURE_NO_WARNINGS
 #endif /* _CRT_SECURE_NO_WARNINGS */
+#include <intrin.h> /* _InterlockedExchangeAdd for json_value_ref */
 #endif /* _MSC_VER */
 
+/* Memory-mapped file reads (json_parse_file/json_parse_file_mmap). Define
+   PARSON_DISABLE_MMAP to force the plain stdio path on every platform. */
+#ifndef PARSON_DISABLE_MMAP
+#if defined(_WIN32)
+#define PARSON_MMAP_WIN32
+#elif defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* for mmap and friends under strict ANSI mode */
+#endif
+#define PARSON_MMAP_POSIX
+#endif
+#endif /* PARSON_DISABLE_MMAP */
+
 #include "parson.h"
 
 #define PARSON_IMPL_VERSION_MAJOR 1
@@ -46,6 +60,53 @@
 #include <ctype.h>
 #include <math.h>
 #include <errno.h>
+#include <limits.h>
+
+#if defined(PARSON_MMAP_POSIX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#elif defined(PARSON_MMAP_WIN32)
+#include <windows.h>
+#endif
+
+/* Vectorized string scanning (see scan_string_special). Opt-in via the
+   PARSON_ENABLE_SIMD build option; falls back to scalar code on other ISAs. */
+#ifdef PARSON_ENABLE_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARSON_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PARSON_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif /* PARSON_ENABLE_SIMD */
+
+/* AddressSanitizer flags the deliberate aligned overreads in
+   scan_string_special (see the comment there), so sanitized builds drop its
+   vector variants and use the scalar loop. The bounded SIMD loops elsewhere
+   are unaffected. */
+#if defined(__SANITIZE_ADDRESS__)
+#define PARSON_ADDRESS_SANITIZER
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define PARSON_ADDRESS_SANITIZER
+#endif
+#endif
+
+/* Parallel parsing of large top-level arrays (see parse_thread_count). Opt-in
+   via the PARSON_ENABLE_PARALLEL build option; pthreads on POSIX, native
+   threads on Windows. */
+#ifdef PARSON_ENABLE_PARALLEL
+#if defined(_WIN32)
+#define PARSON_PARALLEL_WIN32
+#include <windows.h>
+#else
+#define PARSON_PARALLEL_POSIX
+#include <pthread.h>
+#endif
+#endif /* PARSON_ENABLE_PARALLEL */
 
 /* Apparently sscanf is not implemented in some "standard" libraries, so don't use it, if you
  * don't have to. */
@@ -61,6 +122,11 @@
 #define strcpy USE_MEMCPY_INSTEAD_OF_STRCPY
 
 #define STARTING_CAPACITY 16
+
+/* Object hash table load factor, in percent (see JSON_Parser.object_load_factor) */
+#define OBJECT_LOAD_FACTOR_DEFAULT 70
+#define OBJECT_LOAD_FACTOR_MIN     10
+#define OBJECT_LOAD_FACTOR_MAX     90
 #define MAX_NESTING       2048
 
 #ifndef PARSON_DEFAULT_FLOAT_FORMAT
@@ -75,9 +141,28 @@
 #define PARSON_INDENT_STR "    "
 #endif
 
+#ifndef PARSON_STREAM_BUF_SIZE
+#define PARSON_STREAM_BUF_SIZE 4096 /* chunk size for json_serialize_to_stream; must exceed PARSON_NUM_BUF_SIZE */
+#endif
+
+/* 64-bit unsigned type for the built-in number formatter. Strict C89 has no
+   long long, so on such compilers we only get one when unsigned long happens
+   to be exactly 64 bits wide; without it number serialization falls back to
+   sprintf with PARSON_DEFAULT_FLOAT_FORMAT. */
+#if defined(_MSC_VER)
+#define PARSON_UINT64 unsigned __int64
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L)
+#define PARSON_UINT64 unsigned long long
+#elif defined(ULONG_MAX) && (((ULONG_MAX >> 31) >> 31) >> 1) == 1
+#define PARSON_UINT64 unsigned long
+#endif
+
+#ifdef PARSON_UINT64
+#define PARSON_U64_C(hi, lo) ((((PARSON_UINT64)(hi)) << 32) | (PARSON_UINT64)(lo))
+#endif
+
 #define SIZEOF_TOKEN(a)       (sizeof(a) - 1)
 #define SKIP_CHAR(str)        ((*str)++)
-#define SKIP_WHITESPACES(str) while (isspace((unsigned char)(**str))) { SKIP_CHAR(str); }
 #define MAX(a, b)             ((a) > (b) ? (a) : (b))
 
 #undef malloc
@@ -101,6 +186,7 @@ typedef int parson_bool_t;
 typedef struct json_string {
     char *chars;
     size_t length;
+    parson_bool_t owned; /* PARSON_FALSE when chars point into caller-owned memory (in-situ parsing) */
 } JSON_String;
 
 /* Type definitions */
@@ -116,12 +202,27 @@ typedef union json_value_value {
 struct json_value_t {
     JSON_Value      *parent;
     JSON_Value_Type  type;
+    int              ref_count; /* extra owners of a shared root (see json_value_ref); 0 when uniquely owned */
     JSON_Value_Value value;
 };
 
+/* Hash cells carry the full hash and an inline copy of short keys next to the
+   item index, so the common probe is resolved from one cache line without
+   chasing the names pointer; only keys longer than 15 bytes fall back to the
+   names array. The struct is exactly 32 bytes on 64-bit platforms. */
+#define OBJECT_CELL_KEY_INLINE_MAX 15
+#define OBJECT_CELL_KEY_TOO_LONG   ((unsigned char)0xFF)
+
+typedef struct json_object_cell {
+    size_t item_ix;        /* OBJECT_INVALID_IX when the cell is empty */
+    unsigned long hash;
+    unsigned char key_len; /* OBJECT_CELL_KEY_TOO_LONG when the key is not inlined */
+    char key[OBJECT_CELL_KEY_INLINE_MAX]; /* inline copy, not NUL-terminated */
+} JSON_Object_Cell;
+
 struct json_object_t {
-    JSON_Value    *wrapping_value;
-    size_t        *cells;
+    JSON_Value       *wrapping_value;
+    JSON_Object_Cell *cells;
     unsigned long *hashes;
     char         **names;
     JSON_Value   **values;
@@ -129,24 +230,32 @@ struct json_object_t {
     size_t         count;
     size_t         item_capacity;
     size_t         cell_capacity;
+    parson_bool_t  owns_keys; /* PARSON_FALSE when keys point into caller-owned memory (in-situ parsing) */
+    parson_bool_t  frozen;    /* mutating calls are rejected (see json_value_freeze) */
+    parson_bool_t  packed;    /* all five arrays live in one block starting at cells */
+    unsigned long  cached_hash; /* lazily computed structural hash, 0 when absent (see json_value_hash) */
 };
 
 struct json_array_t {
     JSON_Value  *wrapping_value;
     JSON_Value **items;
+    double      *numbers; /* packed homogeneous storage; items is NULL when set (see json_array_pack_numbers) */
     size_t       count;
     size_t       capacity;
+    parson_bool_t frozen; /* mutating calls are rejected (see json_value_freeze) */
+    unsigned long cached_hash; /* lazily computed structural hash, 0 when absent (see json_value_hash) */
 };
 
 /* Memory */
 static void * default_malloc(size_t size, void * userdata);
 static void default_free(void * ptr, void * userdata);
+static void * arena_malloc(size_t size, void * userdata);
+static void arena_free(void * ptr, void * userdata);
 
 /* Various */
 static char * read_file(JSON_Parser const * parser, const char *filename);
-static void   remove_comments(char *string, const char *start_token, const char *end_token);
+static void   skip_whitespaces(JSON_Parser const * parser, const char **string);
 static char * parson_strndup(JSON_Parser const * parser, const char *string, size_t n);
-static char * parson_strdup(JSON_Parser const * parser, const char *string);
 static int    hex_char_to_int(char c);
 static JSON_Status parse_utf16_hex(const char *string, unsigned int *result);
 static int         num_bytes_in_utf8_sequence(unsigned char c);
@@ -159,22 +268,27 @@ static unsigned long hash_string(const char *string, size_t n);
 static JSON_Object * json_object_make(JSON_Parser const * parser, JSON_Value *wrapping_value);
 static JSON_Status   json_object_init(JSON_Parser const * parser, JSON_Object *object, size_t capacity);
 static void          json_object_deinit(JSON_Parser const * parser, JSON_Object *object, parson_bool_t free_keys, parson_bool_t free_values);
+static size_t        json_object_max_items(JSON_Parser const * parser, size_t cell_capacity);
+static JSON_Status   json_object_rehash_to(JSON_Parser const * parser, JSON_Object *object, size_t new_capacity);
 static JSON_Status   json_object_grow_and_rehash(JSON_Parser const * parser, JSON_Object *object);
+static JSON_Status   json_object_ensure_item_capacity(JSON_Parser const * parser, JSON_Object *object, size_t total_count);
 static size_t        json_object_get_cell_ix(const JSON_Object *object, const char *key, size_t key_len, unsigned long hash, parson_bool_t *out_found);
-static JSON_Status   json_object_add(JSON_Parser const * parser, JSON_Object *object, char *name, JSON_Value *value);
+static JSON_Status   json_object_add_with_hash(JSON_Parser const * parser, JSON_Object *object, char *name, unsigned long hash, JSON_Value *value);
+static JSON_Status   json_object_pack(JSON_Parser const * parser, JSON_Object *object);
+static JSON_Status   json_value_measure_copy(JSON_Parser const * parser, const JSON_Value *value, size_t *out_bytes);
+static char *        json_object_key_copy(JSON_Parser const * parser, const char *name, size_t name_len, unsigned long hash);
 static JSON_Value  * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len);
+static JSON_Value  * json_object_getn_value_with_hash(const JSON_Object *object, const char *name, size_t name_len, unsigned long hash);
 static JSON_Status   json_object_remove_internal(JSON_Parser const * parser, JSON_Object *object, const char *name, parson_bool_t free_value);
 static JSON_Status   json_object_dotremove_internal(JSON_Parser const * parser, JSON_Object *object, const char *name, parson_bool_t free_value);
-static void          json_object_free(JSON_Parser const * parser, JSON_Object *object);
 
 /* JSON Array */
 static JSON_Array * json_array_make(JSON_Parser const * parser, JSON_Value *wrapping_value);
 static JSON_Status  json_array_add(JSON_Parser const * parser, JSON_Array *array, JSON_Value *value);
 static JSON_Status  json_array_resize(JSON_Parser const * parser, JSON_Array *array, size_t new_capacity);
-static void         json_array_free(JSON_Parser const * parser, JSON_Array *array);
 
 /* JSON Value */
-static JSON_Value * json_value_init_string_no_copy(JSON_Parser const * parser, char *string, size_t length);
+static JSON_Value * json_value_init_string_no_copy(JSON_Parser const * parser, char *string, size_t length, parson_bool_t owned);
 static const JSON_String * json_value_get_string_desc(const JSON_Value *value);
 
 /* Parser */
@@ -182,17 +296,18 @@ static JSON_Status   skip_quotes(const char **string);
 static JSON_Status   parse_utf16(const char **unprocessed, char **processed);
 static char *        process_string(JSON_Parser const * parser, const char *input, size_t input_len, size_t *output_len);
 static char *        get_quoted_string(JSON_Parser const * parser, const char **string, size_t *output_string_len);
-static JSON_Value *  parse_object_value(JSON_Parser const * parser, const char **string, size_t nesting);
-static JSON_Value *  parse_array_value(JSON_Parser const * parser, const char **string, size_t nesting);
-static JSON_Value *  parse_string_value(JSON_Parser const * parser, const char **string);
+static char *        get_quoted_string_inplace(const char **string, size_t *output_string_len);
+static JSON_Value *  parse_string_value(JSON_Parser const * parser, const char **string, parson_bool_t in_situ);
 static JSON_Value *  parse_boolean_value(JSON_Parser const * parser, const char **string);
+static JSON_Status   parse_number_token(const char **string, double *output);
 static JSON_Value *  parse_number_value(JSON_Parser const * parser, const char **string);
 static JSON_Value *  parse_null_value(JSON_Parser const * parser, const char **string);
-static JSON_Value *  parse_value(JSON_Parser const * parser, const char **string, size_t nesting);
+static JSON_Value *  parse_value(JSON_Parser const * parser, const char **string, parson_bool_t in_situ);
 
 /* Serialization */
-static int json_serialize_to_buffer_r(JSON_Parser const * parser, const JSON_Value *value, char *buf, int level, parson_bool_t is_pretty, char *num_buf);
-static int json_serialize_string(JSON_Parser const * parser, const char *string, size_t len, char *buf);
+typedef struct json_writer JSON_Writer;
+static JSON_Status json_serialize_to_buffer_r(JSON_Parser const * parser, const JSON_Value *value, JSON_Writer *writer, int level, parson_bool_t is_pretty, char *num_buf);
+static JSON_Status json_serialize_string(JSON_Parser const * parser, const char *string, size_t len, JSON_Writer *writer);
 
 /* Memory */
 static void * default_malloc(size_t size, void * userdata) {
@@ -205,7 +320,243 @@ static void default_free(void * ptr, void * userdata) {
     free(ptr);
 }
 
+/* All internal allocation goes through these wrappers so the optional stats
+   sink sees every call; with stats unset the overhead is one pointer test. */
+static void * parson_malloc(JSON_Parser const * parser, size_t size) {
+    if (parser->stats != NULL) {
+        parser->stats->alloc_count++;
+        parser->stats->alloc_bytes += size;
+    }
+    return parser->malloc_func(size, parser->malloc_userdata);
+}
+
+/* Atomic add used by json_value_ref/json_value_unref. The plain fallback is
+   still correct when values are not shared across threads. */
+static int parson_atomic_add(volatile int *target, int delta) {
+#if defined(_MSC_VER)
+    return (int)_InterlockedExchangeAdd((volatile long*)target, (long)delta) + delta; /* int and long are both 32-bit on Windows */
+#elif defined(__GNUC__) || defined(__clang__)
+    return __sync_add_and_fetch(target, delta);
+#else
+    *target += delta;
+    return *target;
+#endif
+}
+
+/* Mutations walk the parent chain dropping cached structural hashes, so a
+   stale hash can never outlive a change to the subtree below it. Caches are
+   filled bottom-up and cleared root-wards, so a clear cache means every
+   ancestor is clear too and the walk can stop - without this, each append
+   during parsing would walk to the root and deep documents would go
+   quadratic. */
+static void json_value_invalidate_hash(JSON_Value *value) {
+    while (value != NULL) {
+        unsigned long *slot = NULL;
+        if (value->type == JSONObject) {
+            slot = &value->value.object->cached_hash;
+        } else if (value->type == JSONArray) {
+            slot = &value->value.array->cached_hash;
+        }
+        if (slot != NULL) {
+            if (*slot == 0) {
+                break;
+            }
+            *slot = 0;
+        }
+        value = value->parent;
+    }
+}
+
+static void parson_free(JSON_Parser const * parser, void * ptr) {
+    if (parser->stats != NULL && ptr != NULL) {
+        parser->stats->free_count++;
+    }
+    parser->free_func(ptr, parser->malloc_userdata);
+}
+
+/* Arena allocator */
+
+#ifndef PARSON_ARENA_DEFAULT_BLOCK_SIZE
+#define PARSON_ARENA_DEFAULT_BLOCK_SIZE 65536
+#endif
+
+/* All arena allocations are aligned to this boundary, which has to be enough for every type parson allocates */
+#define PARSON_ARENA_ALIGNMENT 8
+#define PARSON_ARENA_ALIGN_UP(n) (((n) + (PARSON_ARENA_ALIGNMENT - 1)) & ~(size_t)(PARSON_ARENA_ALIGNMENT - 1))
+
+typedef struct json_arena_block {
+    struct json_arena_block *next;
+    size_t capacity;
+    size_t used;
+    /* block memory follows the header */
+} JSON_Arena_Block;
+
+struct json_arena {
+    JSON_Parser base; /* parser used for block allocations, also source of serialization settings */
+    size_t block_size;
+    JSON_Arena_Block *blocks; /* head is the block currently allocated from */
+};
+
+static JSON_Arena_Block * arena_add_block(JSON_Arena *arena, size_t min_capacity) {
+    size_t capacity = MAX(arena->block_size, min_capacity);
+    JSON_Arena_Block *block = (JSON_Arena_Block*)parson_malloc(&arena->base, sizeof(JSON_Arena_Block) + capacity);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->capacity = capacity;
+    block->used = 0;
+    block->next = arena->blocks;
+    arena->blocks = block;
+    return block;
+}
+
+static void * arena_malloc(size_t size, void * userdata) {
+    JSON_Arena *arena = (JSON_Arena*)userdata;
+    JSON_Arena_Block *block = arena->blocks;
+    char *result = NULL;
+    size = PARSON_ARENA_ALIGN_UP(size);
+    if (block == NULL || block->capacity - block->used < size) {
+        block = arena_add_block(arena, size);
+        if (block == NULL) {
+            return NULL;
+        }
+    }
+    result = (char*)block + sizeof(JSON_Arena_Block) + block->used;
+    block->used += size;
+    return result;
+}
+
+static void arena_free(void * ptr, void * userdata) {
+    /* Arena allocations are only reclaimed by json_arena_reset/json_arena_destroy */
+    (void)ptr;
+    (void)userdata;
+}
+
+JSON_Arena * json_arena_create(JSON_Parser const * parser, size_t block_size) {
+    JSON_Arena *arena = (JSON_Arena*)parson_malloc(parser, sizeof(JSON_Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->base = *parser;
+    arena->block_size = block_size != 0 ? block_size : PARSON_ARENA_DEFAULT_BLOCK_SIZE;
+    arena->blocks = NULL;
+    return arena;
+}
+
+void json_arena_reset(JSON_Arena *arena) {
+    JSON_Arena_Block *block = NULL, *next = NULL;
+    if (arena == NULL) {
+        return;
+    }
+    for (block = arena->blocks; block != NULL; block = next) {
+        next = block->next;
+        parson_free(&arena->base, block);
+    }
+    arena->blocks = NULL;
+}
+
+void json_arena_destroy(JSON_Arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+    json_arena_reset(arena);
+    parson_free(&arena->base, arena);
+}
+
+JSON_Parser json_get_arena_parser(JSON_Arena *arena) {
+    JSON_Parser parser = arena->base;
+    parser.malloc_func = arena_malloc;
+    parser.free_func = arena_free;
+    parser.malloc_userdata = arena;
+    return parser;
+}
+
+JSON_Status json_arena_reserve(JSON_Arena *arena, size_t bytes) {
+    if (arena == NULL) {
+        return JSONFailure;
+    }
+    bytes = PARSON_ARENA_ALIGN_UP(bytes);
+    if (arena->blocks != NULL && arena->blocks->capacity - arena->blocks->used >= bytes) {
+        return JSONSuccess;
+    }
+    return arena_add_block(arena, bytes) != NULL ? JSONSuccess : JSONFailure;
+}
+
 /* Various */
+
+/* Maps 'filename' read-only and null-terminated. The parser wants a terminated
+   buffer, so the mapping relies on the zero fill of the last partial page; when
+   the file size is an exact multiple of the page size (or the file is empty)
+   there is no such guarantee and NULL is returned so callers fall back to
+   read_file. Mappings are released with unmap_file. */
+#if defined(PARSON_MMAP_POSIX)
+static char * map_file(const char * filename, size_t * out_size) {
+    int fd = -1;
+    struct stat st;
+    long page_size = 0;
+    void *mapping = NULL;
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0 || ((size_t)st.st_size % (size_t)page_size) == 0) {
+        close(fd);
+        return NULL;
+    }
+    mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* the mapping keeps its own reference */
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    *out_size = (size_t)st.st_size;
+    return (char*)mapping;
+}
+
+static void unmap_file(char * data, size_t size) {
+    munmap(data, size);
+}
+#elif defined(PARSON_MMAP_WIN32)
+static char * map_file(const char * filename, size_t * out_size) {
+    HANDLE file = INVALID_HANDLE_VALUE, file_mapping = NULL;
+    LARGE_INTEGER file_size;
+    SYSTEM_INFO system_info;
+    void *mapping = NULL;
+    GetSystemInfo(&system_info);
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0
+        || (ULONGLONG)file_size.QuadPart > ((SIZE_T)-1 / 2)
+        || ((size_t)file_size.QuadPart % system_info.dwPageSize) == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    file_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file); /* the mapping keeps its own reference */
+    if (file_mapping == NULL) {
+        return NULL;
+    }
+    mapping = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(file_mapping); /* the view keeps its own reference */
+    if (mapping == NULL) {
+        return NULL;
+    }
+    *out_size = (size_t)file_size.QuadPart;
+    return (char*)mapping;
+}
+
+static void unmap_file(char * data, size_t size) {
+    (void)size;
+    UnmapViewOfFile(data);
+}
+#endif
+
 static char * read_file(JSON_Parser const * parser, const char * filename) {
     FILE *fp = fopen(filename, "r");
     size_t size_to_read = 0;
@@ -223,7 +574,7 @@ static char * read_file(JSON_Parser const * parser, const char * filename) {
     }
     size_to_read = pos;
     rewind(fp);
-    file_contents = (char*)parser->malloc_func(sizeof(char) * (size_to_read + 1), parser->malloc_userdata);
+    file_contents = (char*)parson_malloc(parser, sizeof(char) * (size_to_read + 1));
     if (!file_contents) {
         fclose(fp);
         return NULL;
@@ -231,7 +582,7 @@ static char * read_file(JSON_Parser const * parser, const char * filename) {
     size_read = fread(file_contents, 1, size_to_read, fp);
     if (size_read == 0 || ferror(fp)) {
         fclose(fp);
-        parser->free_func(file_contents, parser->malloc_userdata);
+        parson_free(parser, file_contents);
         return NULL;
     }
     fclose(fp);
@@ -239,44 +590,37 @@ static char * read_file(JSON_Parser const * parser, const char * filename) {
     return file_contents;
 }
 
-static void remove_comments(char *string, const char *start_token, const char *end_token) {
-    parson_bool_t in_string = PARSON_FALSE, escaped = PARSON_FALSE;
-    size_t i;
-    char *ptr = NULL, current_char;
-    size_t start_token_len = strlen(start_token);
-    size_t end_token_len = strlen(end_token);
-    if (start_token_len == 0 || end_token_len == 0) {
-        return;
-    }
-    while ((current_char = *string) != '\0') {
-        if (current_char == '\\' && !escaped) {
-            escaped = PARSON_TRUE;
-            string++;
-            continue;
-        } else if (current_char == '\"' && !escaped) {
-            in_string = !in_string;
-        } else if (!in_string && strncmp(string, start_token, start_token_len) == 0) {
-            for(i = 0; i < start_token_len; i++) {
-                string[i] = ' ';
-            }
-            string = string + start_token_len;
-            ptr = strstr(string, end_token);
-            if (!ptr) {
-                return;
+/* Skips whitespace and, when parser->allow_comments is set, C and C++ style
+   comments, so commented input parses in one pass instead of through the
+   stripped writable duplicate json_parse_string_with_comments used to make. */
+static void skip_whitespaces(JSON_Parser const * parser, const char **string) {
+    for (;;) {
+        while (isspace((unsigned char)(**string))) {
+            SKIP_CHAR(string);
+        }
+        if (!parser->allow_comments || **string != '/') {
+            return;
+        }
+        if ((*string)[1] == '*') {
+            const char *end = strstr(*string + 2, "*/");
+            if (end == NULL) {
+                return; /* unterminated comment: parsing fails at the '/' */
             }
-            for (i = 0; i < (ptr - string) + end_token_len; i++) {
-                string[i] = ' ';
+            *string = end + 2;
+        } else if ((*string)[1] == '/') {
+            *string += 2;
+            while (**string != '\0' && **string != '\n') {
+                SKIP_CHAR(string);
             }
-            string = ptr + end_token_len - 1;
+        } else {
+            return;
         }
-        escaped = PARSON_FALSE;
-        string++;
     }
 }
 
 static char * parson_strndup(JSON_Parser const * parser, const char *string, size_t n) {
     /* We expect the caller has validated that 'n' fits within the input buffer. */
-    char *output_string = (char*)parser->malloc_func(n + 1, parser->malloc_userdata);
+    char *output_string = (char*)parson_malloc(parser, n + 1);
     if (!output_string) {
         return NULL;
     }
@@ -285,10 +629,6 @@ static char * parson_strndup(JSON_Parser const * parser, const char *string, siz
     return output_string;
 }
 
-static char * parson_strdup(JSON_Parser const * parser, const char *string) {
-    return parson_strndup(parser, string, strlen(string));
-}
-
 static int hex_char_to_int(char c) {
     if (c >= '0' && c <= '9') {
         return c - '0';
@@ -373,10 +713,49 @@ static JSON_Status verify_utf8_sequence(const unsigned char *string, int *len) {
     return JSONSuccess;
 }
 
+/* Mask with the top bit of every byte set, for whole-word ASCII checks */
+#define PARSON_HIGH_BITS ((((size_t)-1) / 0xFF) * 0x80)
+
 static int is_valid_utf8(const char *string, size_t string_len) {
     int len = 0;
     const char *string_end =  string + string_len;
     while (string < string_end) {
+        /* ASCII fast path: 7-bit bytes are always valid, skip whole chunks of
+           them per iteration and only step into the sequence checks on the
+           first byte with the top bit set */
+#if defined(PARSON_SIMD_SSE2)
+        while (string + 16 <= string_end) {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)string);
+            if (_mm_movemask_epi8(chunk) != 0) {
+                break;
+            }
+            string += 16;
+        }
+#elif defined(PARSON_SIMD_NEON)
+        while (string + 16 <= string_end) {
+            uint8x16_t chunk = vld1q_u8((const unsigned char*)string);
+            if (vmaxvq_u8(chunk) >= 0x80) {
+                break;
+            }
+            string += 16;
+        }
+#else
+        while (string + sizeof(size_t) <= string_end) {
+            size_t chunk = 0;
+            memcpy(&chunk, string, sizeof(chunk));
+            if ((chunk & PARSON_HIGH_BITS) != 0) {
+                break;
+            }
+            string += sizeof(chunk);
+        }
+#endif
+        if (string >= string_end) {
+            break;
+        }
+        if ((unsigned char)*string < 0x80) {
+            string++;
+            continue;
+        }
         if (verify_utf8_sequence((const unsigned char*)string, &len) != JSONSuccess) {
             return PARSON_FALSE;
         }
@@ -405,6 +784,34 @@ static unsigned long hash_string(const char *string, size_t n) {
     (void)string;
     (void)n;
     return 0;
+#elif defined(PARSON_UINT64)
+    /* MurmurHash64A: eight bytes per round with strong mixing, instead of the
+       old byte-at-a-time djb2 loop. Unaligned loads go through memcpy, which
+       compilers turn into plain reads; byte order only affects which hash a
+       key gets, not correctness. */
+    const PARSON_UINT64 m = PARSON_U64_C(0xC6A4A793, 0x5BD1E995);
+    PARSON_UINT64 h = PARSON_U64_C(0x5F356495, 0x9E3779B9) ^ ((PARSON_UINT64)n * m);
+    PARSON_UINT64 k = 0;
+    while (n >= 8) {
+        memcpy(&k, string, 8);
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        h ^= k;
+        h *= m;
+        string += 8;
+        n -= 8;
+    }
+    if (n > 0) {
+        k = 0;
+        memcpy(&k, string, n);
+        h ^= k;
+        h *= m;
+    }
+    h ^= h >> 47;
+    h *= m;
+    h ^= h >> 47;
+    return (unsigned long)h;
 #else
     unsigned long hash = 5381;
     unsigned char c;
@@ -420,22 +827,164 @@ static unsigned long hash_string(const char *string, size_t n) {
 #endif
 }
 
+/* Key intern pool. An open-addressing set of NUL-terminated key strings with
+   their hashes; capacity is kept a power of two. Keys are owned by the pool
+   and shared by every object that stores them (such objects have owns_keys
+   unset), so a vocabulary of repeated field names costs one allocation total
+   instead of one per object per document. */
+struct json_intern_pool {
+    JSON_Parser parser; /* allocator for pool memory, captured at create */
+    char **keys;        /* NULL entries are empty slots */
+    unsigned long *hashes;
+    size_t count;
+    size_t capacity;
+};
+
+static char * json_intern_pool_find(const JSON_Intern_Pool *pool, const char *key, size_t key_len, unsigned long hash) {
+    size_t i = 0, ix = 0;
+    if (pool->capacity == 0) {
+        return NULL;
+    }
+    for (i = 0; i < pool->capacity; i++) {
+        ix = (hash + i) & (pool->capacity - 1);
+        if (pool->keys[ix] == NULL) {
+            return NULL;
+        }
+        if (pool->hashes[ix] == hash
+            && strncmp(pool->keys[ix], key, key_len) == 0
+            && pool->keys[ix][key_len] == '\0') {
+            return pool->keys[ix];
+        }
+    }
+    return NULL;
+}
+
+static JSON_Status json_intern_pool_grow(JSON_Intern_Pool *pool) {
+    JSON_Parser const * parser = &pool->parser;
+    size_t new_capacity = MAX(pool->capacity * 2, STARTING_CAPACITY);
+    char **new_keys = NULL;
+    unsigned long *new_hashes = NULL;
+    size_t i = 0, j = 0, ix = 0;
+    new_keys = (char**)parson_malloc(parser, new_capacity * sizeof(*new_keys));
+    new_hashes = (unsigned long*)parson_malloc(parser, new_capacity * sizeof(*new_hashes));
+    if (new_keys == NULL || new_hashes == NULL) {
+        parson_free(parser, new_keys);
+        parson_free(parser, new_hashes);
+        return JSONFailure;
+    }
+    for (i = 0; i < new_capacity; i++) {
+        new_keys[i] = NULL;
+    }
+    for (i = 0; i < pool->capacity; i++) {
+        if (pool->keys[i] == NULL) {
+            continue;
+        }
+        for (j = 0; j < new_capacity; j++) {
+            ix = (pool->hashes[i] + j) & (new_capacity - 1);
+            if (new_keys[ix] == NULL) {
+                new_keys[ix] = pool->keys[i];
+                new_hashes[ix] = pool->hashes[i];
+                break;
+            }
+        }
+    }
+    parson_free(parser, pool->keys);
+    parson_free(parser, pool->hashes);
+    pool->keys = new_keys;
+    pool->hashes = new_hashes;
+    pool->capacity = new_capacity;
+    return JSONSuccess;
+}
+
+/* Takes ownership of 'key' (allocated with the pool's allocator) and returns
+   the canonical pointer for its contents: 'key' itself when it is new, or the
+   already-interned copy (freeing 'key') when it is not. NULL on OOM, in which
+   case 'key' has been freed. */
+static char * json_intern_pool_intern_owned(JSON_Parser const * parser, JSON_Intern_Pool *pool, char *key, size_t key_len, unsigned long hash) {
+    size_t i = 0, ix = 0;
+    char *interned = json_intern_pool_find(pool, key, key_len, hash);
+    if (interned != NULL) {
+        parson_free(parser, key);
+        return interned;
+    }
+    if ((pool->count + 1) * 10 > pool->capacity * 7 /* keep load below 70% */
+        && json_intern_pool_grow(pool) != JSONSuccess) {
+        parson_free(parser, key);
+        return NULL;
+    }
+    for (i = 0; i < pool->capacity; i++) {
+        ix = (hash + i) & (pool->capacity - 1);
+        if (pool->keys[ix] == NULL) {
+            pool->keys[ix] = key;
+            pool->hashes[ix] = hash;
+            pool->count++;
+            return key;
+        }
+    }
+    parson_free(parser, key);
+    return NULL; /* unreachable: growth keeps free slots available */
+}
+
+JSON_Intern_Pool * json_intern_pool_create(JSON_Parser const * parser) {
+    JSON_Intern_Pool *pool = (JSON_Intern_Pool*)parson_malloc(parser, sizeof(JSON_Intern_Pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->parser = *parser;
+    pool->parser.intern_pool = NULL; /* the pool's own bookkeeping is not interned */
+    pool->keys = NULL;
+    pool->hashes = NULL;
+    pool->count = 0;
+    pool->capacity = 0;
+    return pool;
+}
+
+void json_intern_pool_destroy(JSON_Intern_Pool *pool) {
+    JSON_Parser const * parser = NULL;
+    size_t i = 0;
+    if (pool == NULL) {
+        return;
+    }
+    parser = &pool->parser;
+    for (i = 0; i < pool->capacity; i++) {
+        parson_free(parser, pool->keys[i]);
+    }
+    parson_free(parser, pool->keys);
+    parson_free(parser, pool->hashes);
+    parson_free(parser, pool);
+}
+
 /* JSON Object */
 static JSON_Object * json_object_make(JSON_Parser const * parser, JSON_Value *wrapping_value) {
     JSON_Status res = JSONFailure;
-    JSON_Object *new_obj = (JSON_Object*)parser->malloc_func(sizeof(JSON_Object), parser->malloc_userdata);
+    JSON_Object *new_obj = (JSON_Object*)parson_malloc(parser, sizeof(JSON_Object));
     if (new_obj == NULL) {
         return NULL;
     }
     new_obj->wrapping_value = wrapping_value;
     res = json_object_init(parser, new_obj, 0);
     if (res != JSONSuccess) {
-        parser->free_func(new_obj, parser->malloc_userdata);
+        parson_free(parser, new_obj);
         return NULL;
     }
     return new_obj;
 }
 
+/* Items a table of 'cell_capacity' cells may hold before it grows. The
+   threshold is the parser's object_load_factor (percent, clamped; 0 picks the
+   historical 70). */
+static size_t json_object_max_items(JSON_Parser const * parser, size_t cell_capacity) {
+    size_t load = parser->object_load_factor;
+    if (load == 0) {
+        load = OBJECT_LOAD_FACTOR_DEFAULT;
+    } else if (load < OBJECT_LOAD_FACTOR_MIN) {
+        load = OBJECT_LOAD_FACTOR_MIN;
+    } else if (load > OBJECT_LOAD_FACTOR_MAX) {
+        load = OBJECT_LOAD_FACTOR_MAX;
+    }
+    return cell_capacity * load / 100;
+}
+
 static JSON_Status json_object_init(JSON_Parser const * parser, JSON_Object *object, size_t capacity) {
     unsigned int i = 0;
 
@@ -447,17 +996,21 @@ static JSON_Status json_object_init(JSON_Parser const * parser, JSON_Object *obj
 
     object->count = 0;
     object->cell_capacity = capacity;
-    object->item_capacity = (unsigned int)(capacity * 7/10);
+    object->item_capacity = (unsigned int)json_object_max_items(parser, capacity);
+    object->owns_keys = (parser->intern_pool == NULL); /* interned keys belong to the pool */
+    object->frozen = PARSON_FALSE;
+    object->packed = PARSON_FALSE;
+    object->cached_hash = 0;
 
     if (capacity == 0) {
         return JSONSuccess;
     }
 
-    object->cells = (size_t*)parser->malloc_func(object->cell_capacity * sizeof(*object->cells), parser->malloc_userdata);
-    object->names = (char**)parser->malloc_func(object->item_capacity * sizeof(*object->names), parser->malloc_userdata);
-    object->values = (JSON_Value**)parser->malloc_func(object->item_capacity * sizeof(*object->values), parser->malloc_userdata);
-    object->cell_ixs = (size_t*)parser->malloc_func(object->item_capacity * sizeof(*object->cell_ixs), parser->malloc_userdata);
-    object->hashes = (unsigned long*)parser->malloc_func(object->item_capacity * sizeof(*object->hashes), parser->malloc_userdata);
+    object->cells = (JSON_Object_Cell*)parson_malloc(parser, object->cell_capacity * sizeof(*object->cells));
+    object->names = (char**)parson_malloc(parser, object->item_capacity * sizeof(*object->names));
+    object->values = (JSON_Value**)parson_malloc(parser, object->item_capacity * sizeof(*object->values));
+    object->cell_ixs = (size_t*)parson_malloc(parser, object->item_capacity * sizeof(*object->cell_ixs));
+    object->hashes = (unsigned long*)parson_malloc(parser, object->item_capacity * sizeof(*object->hashes));
     if (object->cells == NULL
         || object->names == NULL
         || object->values == NULL
@@ -466,23 +1019,23 @@ static JSON_Status json_object_init(JSON_Parser const * parser, JSON_Object *obj
         goto error;
     }
     for (i = 0; i < object->cell_capacity; i++) {
-        object->cells[i] = OBJECT_INVALID_IX;
+        object->cells[i].item_ix = OBJECT_INVALID_IX;
     }
     return JSONSuccess;
 error:
-    parser->free_func(object->cells, parser->malloc_userdata);
-    parser->free_func(object->names, parser->malloc_userdata);
-    parser->free_func(object->values, parser->malloc_userdata);
-    parser->free_func(object->cell_ixs, parser->malloc_userdata);
-    parser->free_func(object->hashes, parser->malloc_userdata);
+    parson_free(parser, object->cells);
+    parson_free(parser, object->names);
+    parson_free(parser, object->values);
+    parson_free(parser, object->cell_ixs);
+    parson_free(parser, object->hashes);
     return JSONFailure;
 }
 
 static void json_object_deinit(JSON_Parser const * parser, JSON_Object *object, parson_bool_t free_keys, parson_bool_t free_values) {
     unsigned int i = 0;
     for (i = 0; i < object->count; i++) {
-        if (free_keys) {
-            parser->free_func(object->names[i], parser->malloc_userdata);
+        if (free_keys && object->owns_keys) {
+            parson_free(parser, object->names[i]);
         }
         if (free_values) {
             json_value_free(parser, object->values[i]);
@@ -493,11 +1046,16 @@ static void json_object_deinit(JSON_Parser const * parser, JSON_Object *object,
     object->item_capacity = 0;
     object->cell_capacity = 0;
 
-    parser->free_func(object->cells, parser->malloc_userdata);
-    parser->free_func(object->names, parser->malloc_userdata);
-    parser->free_func(object->values, parser->malloc_userdata);
-    parser->free_func(object->cell_ixs, parser->malloc_userdata);
-    parser->free_func(object->hashes, parser->malloc_userdata);
+    if (object->packed) {
+        parson_free(parser, object->cells); /* one block holds all five arrays */
+    } else {
+        parson_free(parser, object->cells);
+        parson_free(parser, object->names);
+        parson_free(parser, object->values);
+        parson_free(parser, object->cell_ixs);
+        parson_free(parser, object->hashes);
+    }
+    object->packed = PARSON_FALSE;
 
     object->cells = NULL;
     object->names = NULL;
@@ -506,25 +1064,28 @@ static void json_object_deinit(JSON_Parser const * parser, JSON_Object *object,
     object->hashes = NULL;
 }
 
-static JSON_Status json_object_grow_and_rehash(JSON_Parser const * parser, JSON_Object *object) {
+static JSON_Status json_object_rehash_to(JSON_Parser const * parser, JSON_Object *object, size_t new_capacity) {
     JSON_Value *wrapping_value = NULL;
     JSON_Object new_object;
     char *key = NULL;
     JSON_Value *value = NULL;
     unsigned int i = 0;
-    size_t new_capacity = MAX(object->cell_capacity * 2, STARTING_CAPACITY);
     JSON_Status res = json_object_init(parser, &new_object, new_capacity);
     if (res != JSONSuccess) {
         return JSONFailure;
     }
+    if (parser->stats != NULL) {
+        parser->stats->rehash_count++;
+    }
 
     wrapping_value = json_object_get_wrapping_value(object);
     new_object.wrapping_value = wrapping_value;
+    new_object.owns_keys = object->owns_keys;
 
     for (i = 0; i < object->count; i++) {
         key = object->names[i];
         value = object->values[i];
-        res = json_object_add(parser, &new_object, key, value);
+        res = json_object_add_with_hash(parser, &new_object, key, object->hashes[i], value);
         if (res != JSONSuccess) {
             json_object_deinit(parser, &new_object, PARSON_FALSE, PARSON_FALSE);
             return JSONFailure;
@@ -536,30 +1097,50 @@ static JSON_Status json_object_grow_and_rehash(JSON_Parser const * parser, JSON_
     return JSONSuccess;
 }
 
+static JSON_Status json_object_grow_and_rehash(JSON_Parser const * parser, JSON_Object *object) {
+    return json_object_rehash_to(parser, object, MAX(object->cell_capacity * 2, STARTING_CAPACITY));
+}
+
+/* Grows the table in a single rehash so 'total_count' items fit; bulk setters
+   use this to avoid the rehash-per-doubling cost of growing incrementally. */
+static JSON_Status json_object_ensure_item_capacity(JSON_Parser const * parser, JSON_Object *object, size_t total_count) {
+    size_t capacity = MAX(object->cell_capacity, STARTING_CAPACITY);
+    while (total_count > json_object_max_items(parser, capacity)) {
+        capacity *= 2;
+    }
+    if (capacity == object->cell_capacity) {
+        return JSONSuccess;
+    }
+    return json_object_rehash_to(parser, object, capacity);
+}
+
 static size_t json_object_get_cell_ix(const JSON_Object *object, const char *key, size_t key_len, unsigned long hash, parson_bool_t *out_found) {
-    size_t cell_ix = hash & (object->cell_capacity - 1);
-    size_t cell = 0;
+    size_t start_ix = hash & (object->cell_capacity - 1);
     size_t ix = 0;
     unsigned int i = 0;
-    unsigned long hash_to_check = 0;
+    const JSON_Object_Cell *cell = NULL;
     const char *key_to_check = NULL;
-    size_t key_to_check_len = 0;
 
     *out_found = PARSON_FALSE;
 
     for (i = 0; i < object->cell_capacity; i++) {
-        ix = (cell_ix + i) & (object->cell_capacity - 1);
-        cell = object->cells[ix];
-        if (cell == OBJECT_INVALID_IX) {
+        ix = (start_ix + i) & (object->cell_capacity - 1);
+        cell = &object->cells[ix];
+        if (cell->item_ix == OBJECT_INVALID_IX) {
             return ix;
         }
-        hash_to_check = object->hashes[cell];
-        if (hash != hash_to_check) {
+        if (cell->hash != hash) {
+            continue;
+        }
+        if (cell->key_len != OBJECT_CELL_KEY_TOO_LONG) { /* short keys compare inline */
+            if ((size_t)cell->key_len == key_len && memcmp(cell->key, key, key_len) == 0) {
+                *out_found = PARSON_TRUE;
+                return ix;
+            }
             continue;
         }
-        key_to_check = object->names[cell];
-        key_to_check_len = strlen(key_to_check);
-        if (key_to_check_len == key_len && strncmp(key, key_to_check, key_len) == 0) {
+        key_to_check = object->names[cell->item_ix];
+        if (strlen(key_to_check) == key_len && strncmp(key, key_to_check, key_len) == 0) {
             *out_found = PARSON_TRUE;
             return ix;
         }
@@ -567,19 +1148,97 @@ static size_t json_object_get_cell_ix(const JSON_Object *object, const char *key
     return OBJECT_INVALID_IX;
 }
 
-static JSON_Status json_object_add(JSON_Parser const * parser, JSON_Object *object, char *name, JSON_Value *value) {
-    unsigned long hash = 0;
+static void json_object_fill_cell(JSON_Object_Cell *cell, size_t item_ix, const char *key, size_t key_len, unsigned long hash) {
+    cell->item_ix = item_ix;
+    cell->hash = hash;
+    if (key_len <= OBJECT_CELL_KEY_INLINE_MAX) {
+        cell->key_len = (unsigned char)key_len;
+        memcpy(cell->key, key, key_len);
+    } else {
+        cell->key_len = OBJECT_CELL_KEY_TOO_LONG;
+    }
+}
+
+/* Rebuilds the object into a single right-sized block holding all five arrays.
+   Used by json_value_freeze; keys and values are reused, only the bookkeeping
+   arrays move. An empty object simply drops its arrays. */
+static JSON_Status json_object_pack(JSON_Parser const * parser, JSON_Object *object) {
+    size_t cell_capacity = 0;
+    size_t block_size = 0;
+    char *block = NULL;
+    JSON_Object_Cell *cells = NULL;
+    char **names = NULL;
+    JSON_Value **values = NULL;
+    size_t *cell_ixs = NULL;
+    unsigned long *hashes = NULL;
+    size_t i = 0;
+
+    if (object->packed) {
+        return JSONSuccess;
+    }
+    if (object->count == 0) {
+        json_object_deinit(parser, object, PARSON_FALSE, PARSON_FALSE);
+        return JSONSuccess;
+    }
+    cell_capacity = STARTING_CAPACITY;
+    while (object->count > json_object_max_items(parser, cell_capacity)) {
+        cell_capacity *= 2;
+    }
+    block_size = cell_capacity * sizeof(JSON_Object_Cell)
+               + object->count * (sizeof(char*) + sizeof(JSON_Value*) + sizeof(size_t) + sizeof(unsigned long));
+    block = (char*)parson_malloc(parser, block_size);
+    if (block == NULL) {
+        return JSONFailure;
+    }
+    cells = (JSON_Object_Cell*)block;
+    names = (char**)(block + cell_capacity * sizeof(JSON_Object_Cell));
+    values = (JSON_Value**)(names + object->count);
+    cell_ixs = (size_t*)(values + object->count);
+    hashes = (unsigned long*)(cell_ixs + object->count);
+
+    for (i = 0; i < cell_capacity; i++) {
+        cells[i].item_ix = OBJECT_INVALID_IX;
+    }
+    memcpy(names, object->names, object->count * sizeof(char*));
+    memcpy(values, object->values, object->count * sizeof(JSON_Value*));
+    memcpy(hashes, object->hashes, object->count * sizeof(unsigned long));
+    for (i = 0; i < object->count; i++) {
+        size_t cell_ix = hashes[i] & (cell_capacity - 1);
+        while (cells[cell_ix].item_ix != OBJECT_INVALID_IX) {
+            cell_ix = (cell_ix + 1) & (cell_capacity - 1);
+        }
+        json_object_fill_cell(&cells[cell_ix], i, names[i], strlen(names[i]), hashes[i]);
+        cell_ixs[i] = cell_ix;
+    }
+    parson_free(parser, object->cells);
+    parson_free(parser, object->names);
+    parson_free(parser, object->values);
+    parson_free(parser, object->cell_ixs);
+    parson_free(parser, object->hashes);
+    object->cells = cells;
+    object->names = names;
+    object->values = values;
+    object->cell_ixs = cell_ixs;
+    object->hashes = hashes;
+    object->cell_capacity = cell_capacity;
+    object->item_capacity = object->count;
+    object->packed = PARSON_TRUE;
+    return JSONSuccess;
+}
+
+static JSON_Status json_object_add_with_hash(JSON_Parser const * parser, JSON_Object *object, char *name, unsigned long hash, JSON_Value *value) {
     parson_bool_t found = PARSON_FALSE;
+    size_t name_len = 0;
     size_t cell_ix = 0;
     JSON_Status res = JSONFailure;
 
-    if (!object || !name || !value) {
+    if (!object || !name || !value || object->frozen) {
         return JSONFailure;
     }
 
-    hash = hash_string(name, strlen(name));
+    name_len = strlen(name);
     found = PARSON_FALSE;
-    cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
+    cell_ix = json_object_get_cell_ix(object, name, name_len, hash, &found);
     if (found) {
         return JSONFailure;
     }
@@ -589,38 +1248,72 @@ static JSON_Status json_object_add(JSON_Parser const * parser, JSON_Object *obje
         if (res != JSONSuccess) {
             return JSONFailure;
         }
-        cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
+        cell_ix = json_object_get_cell_ix(object, name, name_len, hash, &found);
+    }
+
+    if (parser->stats != NULL) {
+        size_t probe_length = (cell_ix - (size_t)hash) & (object->cell_capacity - 1);
+        if (probe_length > parser->stats->max_probe_length) {
+            parser->stats->max_probe_length = probe_length;
+        }
     }
 
     object->names[object->count] = name;
-    object->cells[cell_ix] = object->count;
+    json_object_fill_cell(&object->cells[cell_ix], object->count, name, name_len, hash);
     object->values[object->count] = value;
     object->cell_ixs[object->count] = cell_ix;
     object->hashes[object->count] = hash;
     object->count++;
     value->parent = json_object_get_wrapping_value(object);
+    json_value_invalidate_hash(object->wrapping_value);
 
     return JSONSuccess;
 }
 
-static JSON_Value * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len) {
-    unsigned long hash = 0;
+/* Makes the key pointer an object will store: the canonical interned pointer
+   when the parser has a pool attached, a copy owned by the object otherwise.
+   Callers must only free the result (on a later failure) when there is no
+   pool. */
+static char * json_object_key_copy(JSON_Parser const * parser, const char *name, size_t name_len, unsigned long hash) {
+    char *copy = NULL;
+    if (parser->intern_pool != NULL) {
+        char *interned = json_intern_pool_find(parser->intern_pool, name, name_len, hash);
+        if (interned != NULL) {
+            return interned;
+        }
+    }
+    copy = parson_strndup(parser, name, name_len);
+    if (copy == NULL) {
+        return NULL;
+    }
+    if (parser->intern_pool != NULL) {
+        return json_intern_pool_intern_owned(parser, parser->intern_pool, copy, name_len, hash);
+    }
+    return copy;
+}
+
+static JSON_Value * json_object_getn_value_with_hash(const JSON_Object *object, const char *name, size_t name_len, unsigned long hash) {
     parson_bool_t found = PARSON_FALSE;
     size_t cell_ix = 0;
     size_t item_ix = 0;
     if (!object || !name) {
         return NULL;
     }
-    hash = hash_string(name, name_len);
-    found = PARSON_FALSE;
     cell_ix = json_object_get_cell_ix(object, name, name_len, hash, &found);
     if (!found) {
         return NULL;
     }
-    item_ix = object->cells[cell_ix];
+    item_ix = object->cells[cell_ix].item_ix;
     return object->values[item_ix];
 }
 
+static JSON_Value * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len) {
+    if (!object || !name) {
+        return NULL;
+    }
+    return json_object_getn_value_with_hash(object, name, name_len, hash_string(name, name_len));
+}
+
 static JSON_Status json_object_remove_internal(JSON_Parser const * parser, JSON_Object *object, const char *name, parson_bool_t free_value) {
     unsigned long hash = 0;
     parson_bool_t found = PARSON_FALSE;
@@ -633,7 +1326,7 @@ static JSON_Status json_object_remove_internal(JSON_Parser const * parser, JSON_
     size_t k = 0;
     JSON_Value *val = NULL;
 
-    if (object == NULL) {
+    if (object == NULL || object->frozen) {
         return JSONFailure;
     }
 
@@ -644,21 +1337,23 @@ static JSON_Status json_object_remove_internal(JSON_Parser const * parser, JSON_
         return JSONFailure;
     }
 
-    item_ix = object->cells[cell];
+    item_ix = object->cells[cell].item_ix;
     if (free_value) {
         val = object->values[item_ix];
         json_value_free(parser, val);
         val = NULL;
     }
 
-    parser->free_func(object->names[item_ix], parser->malloc_userdata);
+    if (object->owns_keys) {
+        parson_free(parser, object->names[item_ix]);
+    }
     last_item_ix = object->count - 1;
     if (item_ix < last_item_ix) {
         object->names[item_ix] = object->names[last_item_ix];
         object->values[item_ix] = object->values[last_item_ix];
         object->cell_ixs[item_ix] = object->cell_ixs[last_item_ix];
         object->hashes[item_ix] = object->hashes[last_item_ix];
-        object->cells[object->cell_ixs[item_ix]] = item_ix;
+        object->cells[object->cell_ixs[item_ix]].item_ix = item_ix;
     }
     object->count--;
 
@@ -666,18 +1361,19 @@ static JSON_Status json_object_remove_internal(JSON_Parser const * parser, JSON_
     j = i;
     for (x = 0; x < (object->cell_capacity - 1); x++) {
         j = (j + 1) & (object->cell_capacity - 1);
-        if (object->cells[j] == OBJECT_INVALID_IX) {
+        if (object->cells[j].item_ix == OBJECT_INVALID_IX) {
             break;
         }
-        k = object->hashes[object->cells[j]] & (object->cell_capacity - 1);
+        k = object->cells[j].hash & (object->cell_capacity - 1);
         if ((j > i && (k <= i || k > j))
          || (j < i && (k <= i && k > j))) {
-            object->cell_ixs[object->cells[j]] = i;
+            object->cell_ixs[object->cells[j].item_ix] = i;
             object->cells[i] = object->cells[j];
             i = j;
         }
     }
-    object->cells[i] = OBJECT_INVALID_IX;
+    object->cells[i].item_ix = OBJECT_INVALID_IX;
+    json_value_invalidate_hash(object->wrapping_value);
     return JSONSuccess;
 }
 
@@ -696,25 +1392,26 @@ static JSON_Status json_object_dotremove_internal(JSON_Parser const * parser, JS
     return json_object_dotremove_internal(parser, temp_object, dot_pos + 1, free_value);
 }
 
-static void json_object_free(JSON_Parser const * parser, JSON_Object *object) {
-    json_object_deinit(parser, object, PARSON_TRUE, PARSON_TRUE);
-    parser->free_func(object, parser->malloc_userdata);
-}
-
 /* JSON Array */
 static JSON_Array * json_array_make(JSON_Parser const * parser, JSON_Value *wrapping_value) {
-    JSON_Array *new_array = (JSON_Array*)parser->malloc_func(sizeof(JSON_Array), parser->malloc_userdata);
+    JSON_Array *new_array = (JSON_Array*)parson_malloc(parser, sizeof(JSON_Array));
     if (new_array == NULL) {
         return NULL;
     }
     new_array->wrapping_value = wrapping_value;
     new_array->items = (JSON_Value**)NULL;
+    new_array->numbers = NULL;
     new_array->capacity = 0;
     new_array->count = 0;
+    new_array->frozen = PARSON_FALSE;
+    new_array->cached_hash = 0;
     return new_array;
 }
 
 static JSON_Status json_array_add(JSON_Parser const * parser, JSON_Array *array, JSON_Value *value) {
+    if (array->frozen || array->numbers != NULL) {
+        return JSONFailure;
+    }
     if (array->count >= array->capacity) {
         size_t new_capacity = MAX(array->capacity * 2, STARTING_CAPACITY);
         if (json_array_resize(parser, array, new_capacity) != JSONSuccess) {
@@ -724,66 +1421,145 @@ static JSON_Status json_array_add(JSON_Parser const * parser, JSON_Array *array,
     value->parent = json_array_get_wrapping_value(array);
     array->items[array->count] = value;
     array->count++;
+    json_value_invalidate_hash(array->wrapping_value);
     return JSONSuccess;
 }
 
 static JSON_Status json_array_resize(JSON_Parser const * parser, JSON_Array *array, size_t new_capacity) {
     JSON_Value **new_items = NULL;
-    if (new_capacity == 0) {
+    if (new_capacity == 0 || array->frozen || array->numbers != NULL) {
         return JSONFailure;
     }
-    new_items = (JSON_Value**)parser->malloc_func(new_capacity * sizeof(JSON_Value*), parser->malloc_userdata);
+    new_items = (JSON_Value**)parson_malloc(parser, new_capacity * sizeof(JSON_Value*));
     if (new_items == NULL) {
         return JSONFailure;
     }
     if (array->items != NULL && array->count > 0) {
         memcpy(new_items, array->items, array->count * sizeof(JSON_Value*));
     }
-    parser->free_func(array->items, parser->malloc_userdata);
+    parson_free(parser, array->items);
     array->items = new_items;
     array->capacity = new_capacity;
     return JSONSuccess;
 }
 
-static void json_array_free(JSON_Parser const * parser, JSON_Array *array) {
-    size_t i;
-    for (i = 0; i < array->count; i++) {
-        json_value_free(parser, array->items[i]);
-    }
-    parser->free_func(array->items, parser->malloc_userdata);
-    parser->free_func(array, parser->malloc_userdata);
-}
-
 /* JSON Value */
-static JSON_Value * json_value_init_string_no_copy(JSON_Parser const * parser, char *string, size_t length) {
-    JSON_Value *new_value = (JSON_Value*)parser->malloc_func(sizeof(JSON_Value), parser->malloc_userdata);
+static JSON_Value * json_value_init_string_no_copy(JSON_Parser const * parser, char *string, size_t length, parson_bool_t owned) {
+    JSON_Value *new_value = (JSON_Value*)parson_malloc(parser, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
     new_value->parent = NULL;
+    new_value->ref_count = 0;
     new_value->type = JSONString;
     new_value->value.string.chars = string;
     new_value->value.string.length = length;
+    new_value->value.string.owned = owned;
     return new_value;
 }
 
 /* Parser */
-static JSON_Status skip_quotes(const char **string) {
-    if (**string != '\"') {
-        return JSONFailure;
+
+/* String scanning kernel. scan_string_special returns a pointer to the first
+   byte that string processing has to look at individually: a quote, a
+   backslash, or a control character (which includes the null terminator, so
+   the scan never runs off the end of the input). The vector variants are
+   enabled with PARSON_ENABLE_SIMD and process 16 bytes per iteration. The
+   aligned loads deliberately read up to 15 bytes past the stop byte - and so
+   potentially past the end of the buffer. That never faults because an
+   aligned 16-byte load cannot cross a page boundary, and the scan stops at
+   the first special byte so the extra bytes are never interpreted, but it is
+   an out-of-bounds read as far as AddressSanitizer is concerned, which is why
+   sanitized builds take the scalar loop (PARSON_ADDRESS_SANITIZER above). */
+#if defined(PARSON_SIMD_SSE2) && !defined(PARSON_ADDRESS_SANITIZER)
+static const char * scan_string_special(const char *string) {
+    const __m128i quotes = _mm_set1_epi8('\"');
+    const __m128i backslashes = _mm_set1_epi8('\\');
+    const __m128i max_control = _mm_set1_epi8(0x1F);
+    unsigned int mask = 0;
+    while (((size_t)string & 15) != 0) {
+        unsigned char c = (unsigned char)*string;
+        if (c == '\"' || c == '\\' || c < 0x20) {
+            return string;
+        }
+        string++;
     }
-    SKIP_CHAR(string);
-    while (**string != '\"') {
-        if (**string == '\0') {
-            return JSONFailure;
-        } else if (**string == '\\') {
-            SKIP_CHAR(string);
-            if (**string == '\0') {
-                return JSONFailure;
+    for (;;) {
+        __m128i chunk = _mm_load_si128((const __m128i*)string);
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quotes),
+                          _mm_or_si128(_mm_cmpeq_epi8(chunk, backslashes),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(chunk, max_control), chunk)));
+        mask = (unsigned int)_mm_movemask_epi8(special);
+        if (mask != 0) {
+            while ((mask & 1) == 0) {
+                mask >>= 1;
+                string++;
             }
+            return string;
         }
-        SKIP_CHAR(string);
-    }
+        string += 16;
+    }
+}
+#elif defined(PARSON_SIMD_NEON) && !defined(PARSON_ADDRESS_SANITIZER)
+static const char * scan_string_special(const char *string) {
+    const uint8x16_t quotes = vdupq_n_u8('\"');
+    const uint8x16_t backslashes = vdupq_n_u8('\\');
+    const uint8x16_t min_plain = vdupq_n_u8(0x20);
+    while (((size_t)string & 15) != 0) {
+        unsigned char c = (unsigned char)*string;
+        if (c == '\"' || c == '\\' || c < 0x20) {
+            return string;
+        }
+        string++;
+    }
+    for (;;) {
+        uint8x16_t chunk = vld1q_u8((const unsigned char*)string);
+        uint8x16_t special = vorrq_u8(vceqq_u8(chunk, quotes),
+                             vorrq_u8(vceqq_u8(chunk, backslashes),
+                                      vcltq_u8(chunk, min_plain)));
+        if (vmaxvq_u8(special) != 0) {
+            for (;;) {
+                unsigned char c = (unsigned char)*string;
+                if (c == '\"' || c == '\\' || c < 0x20) {
+                    return string;
+                }
+                string++;
+            }
+        }
+        string += 16;
+    }
+}
+#else
+static const char * scan_string_special(const char *string) {
+    for (;;) {
+        unsigned char c = (unsigned char)*string;
+        if (c == '\"' || c == '\\' || c < 0x20) {
+            return string;
+        }
+        string++;
+    }
+}
+#endif
+
+static JSON_Status skip_quotes(const char **string) {
+    if (**string != '\"') {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    while (**string != '\"') {
+        *string = scan_string_special(*string);
+        if (**string == '\0') {
+            return JSONFailure;
+        } else if (**string == '\\') {
+            SKIP_CHAR(string);
+            if (**string == '\0') {
+                return JSONFailure;
+            }
+            SKIP_CHAR(string);
+        } else if (**string != '\"') {
+            SKIP_CHAR(string); /* control characters are rejected later, in process_string */
+        }
+    }
     SKIP_CHAR(string);
     return JSONSuccess;
 }
@@ -841,14 +1617,30 @@ static char* process_string(JSON_Parser const * parser, const char *input, size_
     const char *input_ptr = input;
     size_t initial_size = (input_len + 1) * sizeof(char);
     size_t final_size = 0;
+    parson_bool_t had_escape = PARSON_FALSE;
     char *output = NULL, *output_ptr = NULL, *resized_output = NULL;
-    output = (char*)parser->malloc_func(initial_size, parser->malloc_userdata);
+    output = (char*)parson_malloc(parser, initial_size);
     if (output == NULL) {
         goto error;
     }
     output_ptr = output;
     while ((*input_ptr != '\0') && (size_t)(input_ptr - input) < input_len) {
+        unsigned char current_char = (unsigned char)*input_ptr;
+        if (current_char != '\\' && current_char >= 0x20) {
+            /* bulk-copy the span up to the next escape or control character */
+            const char *span_end = scan_string_special(input_ptr);
+            size_t span_len = 0;
+            if (span_end > input + input_len) {
+                span_end = input + input_len;
+            }
+            span_len = (size_t)(span_end - input_ptr);
+            memcpy(output_ptr, input_ptr, span_len);
+            output_ptr += span_len;
+            input_ptr += span_len;
+            continue;
+        }
         if (*input_ptr == '\\') {
+            had_escape = PARSON_TRUE;
             input_ptr++;
             switch (*input_ptr) {
                 case '\"': *output_ptr = '\"'; break;
@@ -879,16 +1671,22 @@ static char* process_string(JSON_Parser const * parser, const char *input, size_
     /* resize to new length */
     final_size = (size_t)(output_ptr-output) + 1;
     /* todo: don't resize if final_size == initial_size */
-    resized_output = (char*)parser->malloc_func(final_size, parser->malloc_userdata);
+    resized_output = (char*)parson_malloc(parser, final_size);
     if (resized_output == NULL) {
         goto error;
     }
     memcpy(resized_output, output, final_size);
     *output_len = final_size - 1;
-    parser->free_func(output, parser->malloc_userdata);
+    parson_free(parser, output);
+    if (parser->stats != NULL) {
+        parser->stats->string_count++;
+        if (had_escape) {
+            parser->stats->escaped_string_count++;
+        }
+    }
     return resized_output;
 error:
-    parser->free_func(output, parser->malloc_userdata);
+    parson_free(parser, output);
     return NULL;
 }
 
@@ -905,164 +1703,339 @@ static char * get_quoted_string(JSON_Parser const * parser, const char **string,
     return process_string(parser, string_start + 1, input_string_len, output_string_len);
 }
 
-static JSON_Value * parse_value(JSON_Parser const * parser, const char **string, size_t nesting) {
-    if (nesting > MAX_NESTING) {
+/* In-situ flavour of get_quoted_string: unescapes the string inside the caller's
+   mutable buffer instead of allocating a copy. Escape sequences only ever shrink,
+   so the output never outgrows the quoted input and the closing quote slot can
+   hold the terminating null. */
+static char * get_quoted_string_inplace(const char **string, size_t *output_string_len) {
+    const char *string_start = *string;
+    const char *input_ptr = NULL, *input_end = NULL;
+    char *output = NULL, *output_ptr = NULL;
+    JSON_Status status = skip_quotes(string);
+    if (status != JSONSuccess) {
         return NULL;
     }
-    SKIP_WHITESPACES(string);
+    output = (char*)(string_start + 1);
+    input_ptr = string_start + 1;
+    input_end = *string - 1; /* closing quote */
+    output_ptr = output;
+    while (input_ptr < input_end) {
+        unsigned char current_char = (unsigned char)*input_ptr;
+        if (current_char != '\\' && current_char >= 0x20) {
+            /* bulk-skip (or shift back, once an escape shrunk the output) the
+               span up to the next escape or control character */
+            const char *span_end = scan_string_special(input_ptr);
+            size_t span_len = 0;
+            if (span_end > input_end) {
+                span_end = input_end;
+            }
+            span_len = (size_t)(span_end - input_ptr);
+            if (output_ptr != input_ptr) {
+                memmove(output_ptr, input_ptr, span_len);
+            }
+            output_ptr += span_len;
+            input_ptr += span_len;
+            continue;
+        }
+        if (*input_ptr == '\\') {
+            input_ptr++;
+            switch (*input_ptr) {
+                case '\"': *output_ptr = '\"'; break;
+                case '\\': *output_ptr = '\\'; break;
+                case '/':  *output_ptr = '/';  break;
+                case 'b':  *output_ptr = '\b'; break;
+                case 'f':  *output_ptr = '\f'; break;
+                case 'n':  *output_ptr = '\n'; break;
+                case 'r':  *output_ptr = '\r'; break;
+                case 't':  *output_ptr = '\t'; break;
+                case 'u':
+                    if (parse_utf16(&input_ptr, &output_ptr) != JSONSuccess) {
+                        return NULL;
+                    }
+                    break;
+                default:
+                    return NULL;
+            }
+        } else if ((unsigned char)*input_ptr < 0x20) {
+            return NULL; /* 0x00-0x19 are invalid characters for json string (http://www.ietf.org/rfc/rfc4627.txt) */
+        } else {
+            *output_ptr = *input_ptr;
+        }
+        output_ptr++;
+        input_ptr++;
+    }
+    *output_ptr = '\0'; /* overwrites the closing quote at the latest */
+    *output_string_len = (size_t)(output_ptr - output);
+    return output;
+}
+
+/* The parser runs the recursive descent grammar iteratively: open containers
+   live on a heap-allocated frame stack instead of the call stack, so nesting
+   depth costs a dozen bytes per level rather than a call frame and the limit
+   (parser->max_nesting) can be raised for deep machine-generated documents
+   without risking stack overflow. Containers are attached to their parent as
+   soon as they open, which keeps the error path down to freeing the outermost
+   value plus any keys still waiting for their values. */
+
+typedef struct json_parse_frame {
+    JSON_Value *value;
+    char *key; /* object frames: key parsed but its value still pending */
+    unsigned long key_hash;
+} JSON_Parse_Frame;
+
+static JSON_Value * parse_value(JSON_Parser const * parser, const char **string, parson_bool_t in_situ) {
+    JSON_Parse_Frame *stack = NULL;
+    size_t stack_count = 0;
+    size_t stack_capacity = 0;
+    JSON_Parse_Frame *top = NULL;
+    JSON_Value *root = NULL; /* outermost container, owns everything parsed so far */
+    JSON_Value *new_value = NULL;
+    JSON_Status status = JSONFailure;
+    size_t i = 0;
+
+parse_next_value:
+    if (stack_count > parser->max_nesting) {
+        goto error;
+    }
+    skip_whitespaces(parser, string);
     switch (**string) {
         case '{':
-            return parse_object_value(parser, string, nesting + 1);
-        case '[':
-            return parse_array_value(parser, string, nesting + 1);
+        case '[': {
+            parson_bool_t is_object = (**string == '{');
+            new_value = is_object ? json_value_init_object(parser) : json_value_init_array(parser);
+            if (new_value == NULL) {
+                goto error;
+            }
+            if (is_object && in_situ) {
+                json_value_get_object(new_value)->owns_keys = PARSON_FALSE;
+            }
+            if (stack_count >= stack_capacity) {
+                size_t new_capacity = stack_capacity ? stack_capacity * 2 : STARTING_CAPACITY;
+                JSON_Parse_Frame *new_stack = (JSON_Parse_Frame*)parson_malloc(parser, new_capacity * sizeof(JSON_Parse_Frame));
+                if (new_stack == NULL) {
+                    json_value_free(parser, new_value);
+                    goto error;
+                }
+                if (stack_count > 0) {
+                    memcpy(new_stack, stack, stack_count * sizeof(JSON_Parse_Frame));
+                }
+                parson_free(parser, stack);
+                stack = new_stack;
+                stack_capacity = new_capacity;
+                top = stack_count > 0 ? &stack[stack_count - 1] : NULL; /* the old stack was reallocated */
+            }
+            if (top == NULL) {
+                root = new_value;
+            } else if (json_value_get_type(top->value) == JSONArray) {
+                if (json_array_add(parser, json_value_get_array(top->value), new_value) != JSONSuccess) {
+                    json_value_free(parser, new_value);
+                    goto error;
+                }
+            } else {
+                status = json_object_add_with_hash(parser, json_value_get_object(top->value), top->key, top->key_hash, new_value);
+                if (status != JSONSuccess) {
+                    json_value_free(parser, new_value);
+                    goto error;
+                }
+                top->key = NULL; /* ownership passed to the object */
+            }
+            stack[stack_count].value = new_value;
+            stack[stack_count].key = NULL;
+            stack_count++;
+            top = &stack[stack_count - 1];
+            SKIP_CHAR(string);
+            skip_whitespaces(parser, string);
+            if (**string == (is_object ? '}' : ']')) { /* empty container */
+                SKIP_CHAR(string);
+                goto container_closed;
+            }
+            if (is_object) {
+                goto parse_key;
+            }
+            goto parse_next_value;
+        }
         case '\"':
-            return parse_string_value(parser, string);
+            new_value = parse_string_value(parser, string, in_situ);
+            break;
         case 'f': case 't':
-            return parse_boolean_value(parser, string);
+            new_value = parse_boolean_value(parser, string);
+            break;
         case '-':
         case '0': case '1': case '2': case '3': case '4':
         case '5': case '6': case '7': case '8': case '9':
-            return parse_number_value(parser, string);
+            new_value = parse_number_value(parser, string);
+            break;
         case 'n':
-            return parse_null_value(parser, string);
+            new_value = parse_null_value(parser, string);
+            break;
         default:
-            return NULL;
-    }
-}
-
-static JSON_Value * parse_object_value(JSON_Parser const * parser, const char **string, size_t nesting) {
-    JSON_Status status = JSONFailure;
-    JSON_Value *output_value = NULL, *new_value = NULL;
-    JSON_Object *output_object = NULL;
-    char *new_key = NULL;
-
-    output_value = json_value_init_object(parser);
-    if (output_value == NULL) {
-        return NULL;
+            goto error;
     }
-    if (**string != '{') {
-        json_value_free(parser, output_value);
-        return NULL;
+    if (new_value == NULL) {
+        goto error;
     }
-    output_object = json_value_get_object(output_value);
-    SKIP_CHAR(string);
-    SKIP_WHITESPACES(string);
-    if (**string == '}') { /* empty object */
-        SKIP_CHAR(string);
-        return output_value;
+    if (top == NULL) { /* the whole document is a single scalar */
+        return new_value;
     }
-    while (**string != '\0') {
-        size_t key_len = 0;
-        new_key = get_quoted_string(parser, string, &key_len);
-        /* We do not support key names with embedded \0 chars */
-        if (!new_key) {
-            json_value_free(parser, output_value);
-            return NULL;
-        }
-        if (key_len != strlen(new_key)) {
-            parser->free_func(new_key, parser->malloc_userdata);
-            json_value_free(parser, output_value);
-            return NULL;
-        }
-        SKIP_WHITESPACES(string);
-        if (**string != ':') {
-            parser->free_func(new_key, parser->malloc_userdata);
-            json_value_free(parser, output_value);
-            return NULL;
-        }
-        SKIP_CHAR(string);
-        new_value = parse_value(parser, string, nesting);
-        if (new_value == NULL) {
-            parser->free_func(new_key, parser->malloc_userdata);
-            json_value_free(parser, output_value);
-            return NULL;
+    if (json_value_get_type(top->value) == JSONArray) {
+        if (json_array_add(parser, json_value_get_array(top->value), new_value) != JSONSuccess) {
+            json_value_free(parser, new_value);
+            goto error;
         }
-        status = json_object_add(parser, output_object, new_key, new_value);
+    } else {
+        status = json_object_add_with_hash(parser, json_value_get_object(top->value), top->key, top->key_hash, new_value);
         if (status != JSONSuccess) {
-            parser->free_func(new_key, parser->malloc_userdata);
             json_value_free(parser, new_value);
-            json_value_free(parser, output_value);
-            return NULL;
-        }
-        SKIP_WHITESPACES(string);
-        if (**string != ',') {
-            break;
+            goto error;
         }
+        top->key = NULL; /* ownership passed to the object */
+    }
+    /* fall through */
+
+after_value:
+    skip_whitespaces(parser, string);
+    if (**string == ',') {
         SKIP_CHAR(string);
-        SKIP_WHITESPACES(string);
-        if (**string == '}') {
-            break;
+        skip_whitespaces(parser, string);
+        if (json_value_get_type(top->value) == JSONObject) {
+            if (**string == '}') { /* trailing comma */
+                SKIP_CHAR(string);
+                goto container_closed;
+            }
+            goto parse_key;
         }
+        if (**string == ']') { /* trailing comma */
+            SKIP_CHAR(string);
+            goto container_closed;
+        }
+        goto parse_next_value;
     }
-    SKIP_WHITESPACES(string);
-    if (**string != '}') {
-        json_value_free(parser, output_value);
-        return NULL;
+    if (**string != (json_value_get_type(top->value) == JSONObject ? '}' : ']')) {
+        goto error;
     }
     SKIP_CHAR(string);
-    return output_value;
-}
+    /* fall through */
 
-static JSON_Value * parse_array_value(JSON_Parser const * parser, const char **string, size_t nesting) {
-    JSON_Value *output_value = NULL, *new_array_value = NULL;
-    JSON_Array *output_array = NULL;
-    output_value = json_value_init_array(parser);
-    if (output_value == NULL) {
-        return NULL;
-    }
-    if (**string != '[') {
-        json_value_free(parser, output_value);
-        return NULL;
+container_closed:
+    if (json_value_get_type(top->value) == JSONArray) { /* Trim array after parsing is over */
+        JSON_Array *closed_array = json_value_get_array(top->value);
+        if (parser->pack_number_arrays) {
+            json_array_pack_numbers(parser, closed_array); /* best effort - mixed arrays stay as they are */
+        }
+        if (closed_array->numbers == NULL && json_array_get_count(closed_array) > 0 &&
+            json_array_resize(parser, closed_array, json_array_get_count(closed_array)) != JSONSuccess) {
+            goto error;
+        }
     }
-    output_array = json_value_get_array(output_value);
-    SKIP_CHAR(string);
-    SKIP_WHITESPACES(string);
-    if (**string == ']') { /* empty array */
-        SKIP_CHAR(string);
-        return output_value;
+    stack_count--;
+    if (stack_count == 0) {
+        parson_free(parser, stack);
+        return root;
     }
-    while (**string != '\0') {
-        new_array_value = parse_value(parser, string, nesting);
-        if (new_array_value == NULL) {
-            json_value_free(parser, output_value);
-            return NULL;
-        }
-        if (json_array_add(parser, output_array, new_array_value) != JSONSuccess) {
-            json_value_free(parser, new_array_value);
-            json_value_free(parser, output_value);
-            return NULL;
+    top = &stack[stack_count - 1];
+    goto after_value;
+
+parse_key:
+    {
+        size_t key_len = 0;
+        char *new_key = NULL;
+        unsigned long key_hash = 0;
+        if (parser->intern_pool != NULL && !in_situ) {
+            const char *token_start = *string;
+            const char *raw = NULL;
+            size_t raw_len = 0;
+            if (skip_quotes(string) != JSONSuccess) {
+                goto error;
+            }
+            raw = token_start + 1;
+            raw_len = (size_t)(*string - token_start) - 2;
+            if (memchr(raw, '\\', raw_len) == NULL) {
+                /* No escapes, so the raw slice is the key verbatim. A pool hit
+                   means these exact bytes were validated when first interned,
+                   letting the hot path skip process_string (and any
+                   allocation) entirely. */
+                key_hash = hash_string(raw, raw_len);
+                new_key = json_intern_pool_find(parser->intern_pool, raw, raw_len, key_hash);
+                if (new_key == NULL) {
+                    new_key = process_string(parser, raw, raw_len, &key_len);
+                    if (new_key == NULL) {
+                        goto error;
+                    }
+                    new_key = json_intern_pool_intern_owned(parser, parser->intern_pool, new_key, key_len, key_hash);
+                    if (new_key == NULL) {
+                        goto error;
+                    }
+                }
+            } else {
+                new_key = process_string(parser, raw, raw_len, &key_len);
+                if (new_key == NULL) {
+                    goto error;
+                }
+                /* We do not support key names with embedded \0 chars */
+                if (key_len != strlen(new_key)) {
+                    parson_free(parser, new_key);
+                    goto error;
+                }
+                key_hash = hash_string(new_key, key_len);
+                new_key = json_intern_pool_intern_owned(parser, parser->intern_pool, new_key, key_len, key_hash);
+                if (new_key == NULL) {
+                    goto error;
+                }
+            }
+        } else {
+            if (in_situ) {
+                new_key = get_quoted_string_inplace(string, &key_len);
+            } else {
+                new_key = get_quoted_string(parser, string, &key_len);
+            }
+            if (new_key == NULL) {
+                goto error;
+            }
+            /* We do not support key names with embedded \0 chars */
+            if (key_len != strlen(new_key)) {
+                if (!in_situ) {
+                    parson_free(parser, new_key);
+                }
+                goto error;
+            }
+            key_hash = hash_string(new_key, key_len);
         }
-        SKIP_WHITESPACES(string);
-        if (**string != ',') {
-            break;
+        top->key = new_key;
+        top->key_hash = key_hash;
+        skip_whitespaces(parser, string);
+        if (**string != ':') {
+            goto error;
         }
         SKIP_CHAR(string);
-        SKIP_WHITESPACES(string);
-        if (**string == ']') {
-            break;
-        }
+        goto parse_next_value;
     }
-    SKIP_WHITESPACES(string);
-    if (**string != ']' || /* Trim array after parsing is over */
-        json_array_resize(parser, output_array, json_array_get_count(output_array)) != JSONSuccess) {
-            json_value_free(parser, output_value);
-            return NULL;
+
+error:
+    if (!in_situ && parser->intern_pool == NULL) {
+        for (i = 0; i < stack_count; i++) {
+            parson_free(parser, stack[i].key);
+        }
     }
-    SKIP_CHAR(string);
-    return output_value;
+    parson_free(parser, stack);
+    json_value_free(parser, root);
+    return NULL;
 }
 
-static JSON_Value * parse_string_value(JSON_Parser const * parser, const char **string) {
+static JSON_Value * parse_string_value(JSON_Parser const * parser, const char **string, parson_bool_t in_situ) {
     JSON_Value *value = NULL;
     size_t new_string_len = 0;
-    char *new_string = get_quoted_string(parser, string, &new_string_len);
+    char *new_string = NULL;
+    if (in_situ) {
+        new_string = get_quoted_string_inplace(string, &new_string_len);
+    } else {
+        new_string = get_quoted_string(parser, string, &new_string_len);
+    }
     if (new_string == NULL) {
         return NULL;
     }
-    value = json_value_init_string_no_copy(parser, new_string, new_string_len);
-    if (value == NULL) {
-        parser->free_func(new_string, parser->malloc_userdata);
-        return NULL;
+    value = json_value_init_string_no_copy(parser, new_string, new_string_len, !in_situ);
+    if (value == NULL && !in_situ) {
+        parson_free(parser, new_string);
     }
     return value;
 }
@@ -1080,18 +2053,127 @@ static JSON_Value * parse_boolean_value(JSON_Parser const * parser, const char *
     return NULL;
 }
 
-static JSON_Value * parse_number_value(JSON_Parser const * parser, const char **string) {
+#ifdef PARSON_UINT64
+#define PARSON_FAST_NUMBER_MAX_DIGITS 15
+#define PARSON_FAST_NUMBER_MAX_EXP    22
+
+/* Powers of ten up to 10^22 are exactly representable as doubles. */
+static const double parson_pow10_table[PARSON_FAST_NUMBER_MAX_EXP + 1] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Clinger-style fast conversion: when the significand has at most 15
+   significant decimal digits (so it fits a double exactly) and the decimal
+   exponent is within +/-22, the value is the product or quotient of two
+   exactly representable doubles, and a single multiply or divide rounds
+   correctly. Returns PARSON_FALSE without consuming input when the token
+   does not fit these bounds or has an unusual shape; the caller then runs
+   strtod, which keeps the exact acceptance rules and errno handling of the
+   slow path. */
+static parson_bool_t parse_number_fast(const char **string, double *output) {
+    const char *s = *string;
+    const char *token_end;
+    PARSON_UINT64 significand = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    parson_bool_t is_negative = PARSON_FALSE;
+    if (*s == '-') {
+        is_negative = PARSON_TRUE;
+        s++;
+    }
+    if (!isdigit((unsigned char)*s)) {
+        return PARSON_FALSE; /* leading '.', '+' or inf/nan forms go through strtod */
+    }
+    while (isdigit((unsigned char)*s)) {
+        significand = significand * 10 + (PARSON_UINT64)(*s - '0');
+        if (significand != 0) {
+            num_digits++;
+        }
+        s++;
+    }
+    if (*s == '.') {
+        s++;
+        if (!isdigit((unsigned char)*s)) {
+            return PARSON_FALSE; /* "1." is strtod's business */
+        }
+        while (isdigit((unsigned char)*s)) {
+            significand = significand * 10 + (PARSON_UINT64)(*s - '0');
+            if (significand != 0) {
+                num_digits++;
+            }
+            exponent--;
+            s++;
+        }
+    }
+    token_end = s;
+    if (*s == 'e' || *s == 'E') {
+        const char *exp_ptr = s + 1;
+        int exp_value = 0;
+        parson_bool_t exp_negative = PARSON_FALSE;
+        if (*exp_ptr == '+' || *exp_ptr == '-') {
+            exp_negative = (*exp_ptr == '-');
+            exp_ptr++;
+        }
+        if (isdigit((unsigned char)*exp_ptr)) {
+            while (isdigit((unsigned char)*exp_ptr)) {
+                if (exp_value < 10000) { /* clamp; anything this big bails out below */
+                    exp_value = exp_value * 10 + (*exp_ptr - '0');
+                }
+                exp_ptr++;
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            token_end = exp_ptr;
+        } /* a dangling "e" is not part of the token, same as strtod */
+    }
+    if (num_digits > PARSON_FAST_NUMBER_MAX_DIGITS
+            || exponent < -PARSON_FAST_NUMBER_MAX_EXP || exponent > PARSON_FAST_NUMBER_MAX_EXP) {
+        return PARSON_FALSE;
+    }
+    if (!is_decimal(*string, (size_t)(token_end - *string))) {
+        return PARSON_FALSE; /* let the slow path report the failure */
+    }
+    {
+        double number = (double)significand;
+        if (exponent > 0) {
+            number *= parson_pow10_table[exponent];
+        } else if (exponent < 0) {
+            number /= parson_pow10_table[-exponent];
+        }
+        *output = is_negative ? -number : number;
+    }
+    *string = token_end;
+    return PARSON_TRUE;
+}
+#endif /* PARSON_UINT64 */
+
+static JSON_Status parse_number_token(const char **string, double *output) {
     char *end;
     double number = 0;
+#ifdef PARSON_UINT64
+    if (parse_number_fast(string, output)) {
+        return JSONSuccess;
+    }
+#endif
     errno = 0;
     number = strtod(*string, &end);
     if (errno == ERANGE && (number <= -HUGE_VAL || number >= HUGE_VAL)) {
-        return NULL;
+        return JSONFailure;
     }
     if ((errno && errno != ERANGE) || !is_decimal(*string, end - *string)) {
-        return NULL;
+        return JSONFailure;
     }
     *string = end;
+    *output = number;
+    return JSONSuccess;
+}
+
+static JSON_Value * parse_number_value(JSON_Parser const * parser, const char **string) {
+    double number = 0;
+    if (parse_number_token(string, &number) != JSONSuccess) {
+        return NULL;
+    }
     return json_value_init_number(parser, number);
 }
 
@@ -1104,254 +2186,1642 @@ static JSON_Value * parse_null_value(JSON_Parser const * parser, const char **st
     return NULL;
 }
 
-/* Serialization */
+/* Event (SAX-style) parser. Shares the tokenizer with the tree parser but
+   reports through callbacks instead of allocating nodes; the only allocation
+   is a scratch buffer reused for strings that contain escape sequences. */
 
-/*  APPEND_STRING() is only called on string literals.
-    It's a bit hacky because it makes plenty of assumptions about the external state
-    and should eventually be tidied up into a function (same goes for APPEND_INDENT)
- */
-#define APPEND_STRING(str) do {\
-                                written = SIZEOF_TOKEN((str));\
-                                if (buf != NULL) {\
-                                    memcpy(buf, (str), written);\
-                                    buf[written] = '\0';\
-                                    buf += written;\
-                                }\
-                                written_total += written;\
-                            } while (0)
+typedef struct json_events_state {
+    JSON_Parser const *parser;
+    const JSON_Event_Callbacks *callbacks;
+    void *userdata;
+    char *scratch;
+    size_t scratch_capacity;
+} JSON_Events_State;
 
-#define APPEND_INDENT(level) do {\
-                                int level_i = 0;\
-                                for (level_i = 0; level_i < (level); level_i++) {\
-                                    APPEND_STRING(PARSON_INDENT_STR);\
-                                }\
-                            } while (0)
+#define EVENTS_EMIT0(state, cb) ((state)->callbacks->cb ? (state)->callbacks->cb((state)->userdata) : JSONSuccess)
 
-static int json_serialize_to_buffer_r(JSON_Parser const * parser, const JSON_Value *value, char *buf, int level, parson_bool_t is_pretty, char *num_buf)
-{
-    const char *key = NULL, *string = NULL;
-    JSON_Value *temp_value = NULL;
-    JSON_Array *array = NULL;
-    JSON_Object *object = NULL;
-    size_t i = 0, count = 0;
-    double num = 0.0;
-    int written = -1, written_total = 0;
-    size_t len = 0;
+static JSON_Status events_reserve_scratch(JSON_Events_State *state, size_t size) {
+    JSON_Parser const *parser = state->parser;
+    char *new_scratch = NULL;
+    size_t new_capacity = MAX(state->scratch_capacity, STARTING_CAPACITY);
+    if (size <= state->scratch_capacity) {
+        return JSONSuccess;
+    }
+    while (new_capacity < size) {
+        new_capacity *= 2;
+    }
+    new_scratch = (char*)parson_malloc(parser, new_capacity);
+    if (new_scratch == NULL) {
+        return JSONFailure;
+    }
+    parson_free(parser, state->scratch);
+    state->scratch = new_scratch;
+    state->scratch_capacity = new_capacity;
+    return JSONSuccess;
+}
 
-    switch (json_value_get_type(value)) {
-        case JSONArray:
-            array = json_value_get_array(value);
-            count = json_array_get_count(array);
-            APPEND_STRING("[");
-            if (count > 0 && is_pretty) {
-                APPEND_STRING("\n");
+static JSON_Status events_emit_string(JSON_Events_State *state, const char **string, parson_bool_t is_key) {
+    const char *string_start = *string;
+    const char *input_ptr = NULL, *input_end = NULL, *first_special = NULL;
+    char *output_ptr = NULL;
+    size_t span_len = 0;
+    JSON_Status (*emit)(void *userdata, const char *chars, size_t len) = NULL;
+    JSON_Status status = skip_quotes(string);
+    if (status != JSONSuccess) {
+        return JSONFailure;
+    }
+    emit = is_key ? state->callbacks->on_object_key : state->callbacks->on_string;
+    input_ptr = string_start + 1;
+    input_end = *string - 1; /* closing quote */
+    span_len = (size_t)(input_end - input_ptr);
+    first_special = scan_string_special(input_ptr);
+    if (first_special >= input_end) {
+        /* no escapes or control characters, emit straight from the input */
+        if (emit == NULL) {
+            return JSONSuccess;
+        }
+        return emit(state->userdata, input_ptr, span_len);
+    }
+    if (*first_special != '\\') {
+        return JSONFailure; /* control character in string */
+    }
+    /* unescape into the scratch buffer (escapes only ever shrink the string) */
+    if (events_reserve_scratch(state, span_len + 1) != JSONSuccess) {
+        return JSONFailure;
+    }
+    output_ptr = state->scratch;
+    while (input_ptr < input_end) {
+        unsigned char current_char = (unsigned char)*input_ptr;
+        if (current_char != '\\' && current_char >= 0x20) {
+            const char *span_end = scan_string_special(input_ptr);
+            size_t clean_len = 0;
+            if (span_end > input_end) {
+                span_end = input_end;
             }
-            for (i = 0; i < count; i++) {
-                if (is_pretty) {
-                    APPEND_INDENT(level+1);
-                }
-                temp_value = json_array_get_value(array, i);
-                written = json_serialize_to_buffer_r(parser, temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+            clean_len = (size_t)(span_end - input_ptr);
+            memcpy(output_ptr, input_ptr, clean_len);
+            output_ptr += clean_len;
+            input_ptr += clean_len;
+            continue;
+        }
+        if (*input_ptr == '\\') {
+            input_ptr++;
+            switch (*input_ptr) {
+                case '\"': *output_ptr = '\"'; break;
+                case '\\': *output_ptr = '\\'; break;
+                case '/':  *output_ptr = '/';  break;
+                case 'b':  *output_ptr = '\b'; break;
+                case 'f':  *output_ptr = '\f'; break;
+                case 'n':  *output_ptr = '\n'; break;
+                case 'r':  *output_ptr = '\r'; break;
+                case 't':  *output_ptr = '\t'; break;
+                case 'u':
+                    if (parse_utf16(&input_ptr, &output_ptr) != JSONSuccess) {
+                        return JSONFailure;
+                    }
+                    break;
+                default:
+                    return JSONFailure;
+            }
+        } else {
+            return JSONFailure; /* 0x00-0x19 are invalid characters for json string (http://www.ietf.org/rfc/rfc4627.txt) */
+        }
+        output_ptr++;
+        input_ptr++;
+    }
+    if (emit == NULL) {
+        return JSONSuccess;
+    }
+    return emit(state->userdata, state->scratch, (size_t)(output_ptr - state->scratch));
+}
+
+static JSON_Status parse_events_value(JSON_Events_State *state, const char **string, size_t nesting);
+
+static JSON_Status parse_events_object(JSON_Events_State *state, const char **string, size_t nesting) {
+    if (EVENTS_EMIT0(state, on_object_start) != JSONSuccess) {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    skip_whitespaces(state->parser, string);
+    if (**string == '}') { /* empty object */
+        SKIP_CHAR(string);
+        return EVENTS_EMIT0(state, on_object_end);
+    }
+    while (**string != '\0') {
+        if (events_emit_string(state, string, PARSON_TRUE) != JSONSuccess) {
+            return JSONFailure;
+        }
+        skip_whitespaces(state->parser, string);
+        if (**string != ':') {
+            return JSONFailure;
+        }
+        SKIP_CHAR(string);
+        if (parse_events_value(state, string, nesting) != JSONSuccess) {
+            return JSONFailure;
+        }
+        skip_whitespaces(state->parser, string);
+        if (**string != ',') {
+            break;
+        }
+        SKIP_CHAR(string);
+        skip_whitespaces(state->parser, string);
+        if (**string == '}') {
+            break;
+        }
+    }
+    skip_whitespaces(state->parser, string);
+    if (**string != '}') {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    return EVENTS_EMIT0(state, on_object_end);
+}
+
+static JSON_Status parse_events_array(JSON_Events_State *state, const char **string, size_t nesting) {
+    if (EVENTS_EMIT0(state, on_array_start) != JSONSuccess) {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    skip_whitespaces(state->parser, string);
+    if (**string == ']') { /* empty array */
+        SKIP_CHAR(string);
+        return EVENTS_EMIT0(state, on_array_end);
+    }
+    while (**string != '\0') {
+        if (parse_events_value(state, string, nesting) != JSONSuccess) {
+            return JSONFailure;
+        }
+        skip_whitespaces(state->parser, string);
+        if (**string != ',') {
+            break;
+        }
+        SKIP_CHAR(string);
+        skip_whitespaces(state->parser, string);
+        if (**string == ']') {
+            break;
+        }
+    }
+    skip_whitespaces(state->parser, string);
+    if (**string != ']') {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    return EVENTS_EMIT0(state, on_array_end);
+}
+
+static JSON_Status parse_events_value(JSON_Events_State *state, const char **string, size_t nesting) {
+    double number = 0;
+    if (nesting > state->parser->max_nesting) {
+        return JSONFailure;
+    }
+    skip_whitespaces(state->parser, string);
+    switch (**string) {
+        case '{':
+            return parse_events_object(state, string, nesting + 1);
+        case '[':
+            return parse_events_array(state, string, nesting + 1);
+        case '\"':
+            return events_emit_string(state, string, PARSON_FALSE);
+        case 'f': case 't':
+            if (strncmp("true", *string, SIZEOF_TOKEN("true")) == 0) {
+                *string += SIZEOF_TOKEN("true");
+                return state->callbacks->on_boolean ? state->callbacks->on_boolean(state->userdata, 1) : JSONSuccess;
+            } else if (strncmp("false", *string, SIZEOF_TOKEN("false")) == 0) {
+                *string += SIZEOF_TOKEN("false");
+                return state->callbacks->on_boolean ? state->callbacks->on_boolean(state->userdata, 0) : JSONSuccess;
+            }
+            return JSONFailure;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            if (parse_number_token(string, &number) != JSONSuccess) {
+                return JSONFailure;
+            }
+            return state->callbacks->on_number ? state->callbacks->on_number(state->userdata, number) : JSONSuccess;
+        case 'n':
+            if (strncmp("null", *string, SIZEOF_TOKEN("null")) == 0) {
+                *string += SIZEOF_TOKEN("null");
+                return EVENTS_EMIT0(state, on_null);
+            }
+            return JSONFailure;
+        default:
+            return JSONFailure;
+    }
+}
+
+JSON_Status json_parse_events(JSON_Parser const * parser, const char *string, const JSON_Event_Callbacks *callbacks, void *userdata) {
+    JSON_Events_State state;
+    JSON_Status status = JSONFailure;
+    if (string == NULL || callbacks == NULL) {
+        return JSONFailure;
+    }
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    state.parser = parser;
+    state.callbacks = callbacks;
+    state.userdata = userdata;
+    state.scratch = NULL;
+    state.scratch_capacity = 0;
+    status = parse_events_value(&state, &string, 0);
+    parson_free(parser, state.scratch);
+    return status;
+}
+
+/* Incremental ("feed") parsing.
+   The recursive descent of parse_value can't suspend mid-document, so the feed
+   parser runs the same grammar as an explicit state machine: an array/object
+   stack replaces the call stack and a single growable buffer accumulates the
+   current scalar token, which is the only piece of input that ever has to be
+   retained across chunk boundaries. Containers are attached to their parent as
+   soon as they open, so a failure at any point is cleaned up by freeing the
+   root. */
+
+enum feed_state {
+    FEED_STATE_VALUE = 0,   /* expecting the first character of a value */
+    FEED_STATE_KEY,         /* inside an object, expecting a key or '}' */
+    FEED_STATE_COLON,       /* between a key and its value */
+    FEED_STATE_AFTER_VALUE, /* expecting ',' or a closing bracket */
+    FEED_STATE_STRING,      /* accumulating a quoted string value */
+    FEED_STATE_KEY_STRING,  /* accumulating a quoted key */
+    FEED_STATE_NUMBER,      /* accumulating a number token */
+    FEED_STATE_LITERAL,     /* accumulating true/false/null */
+    FEED_STATE_DONE,
+    FEED_STATE_ERROR
+};
+
+typedef struct json_feed_frame {
+    JSON_Value *value;
+    char *pending_key; /* object frames only: key waiting for its value */
+    unsigned long pending_key_hash;
+} JSON_Feed_Frame;
+
+struct json_feed_parser {
+    JSON_Parser parser;
+    int state;
+    JSON_Value *root;
+    JSON_Feed_Frame *stack;
+    size_t stack_count;
+    size_t stack_capacity;
+    char *token;
+    size_t token_len;
+    size_t token_capacity;
+    parson_bool_t in_escape; /* string accumulation stopped right after '\' */
+};
+
+static JSON_Status feed_fail(JSON_Feed_Parser *feed_parser) {
+    JSON_Parser const * parser = &feed_parser->parser;
+    size_t i = 0;
+    for (i = 0; i < feed_parser->stack_count; i++) {
+        if (parser->intern_pool == NULL) { /* interned keys belong to the pool */
+            parson_free(parser, feed_parser->stack[i].pending_key);
+        }
+        feed_parser->stack[i].pending_key = NULL;
+    }
+    feed_parser->stack_count = 0;
+    json_value_free(parser, feed_parser->root);
+    feed_parser->root = NULL;
+    feed_parser->state = FEED_STATE_ERROR;
+    return JSONFailure;
+}
+
+static JSON_Status feed_append_token(JSON_Feed_Parser *feed_parser, const char *bytes, size_t len) {
+    JSON_Parser const * parser = &feed_parser->parser;
+    if (feed_parser->token_len + len + 1 > feed_parser->token_capacity) {
+        size_t new_capacity = feed_parser->token_capacity ? feed_parser->token_capacity * 2 : STARTING_CAPACITY;
+        char *new_token = NULL;
+        while (new_capacity < feed_parser->token_len + len + 1) {
+            new_capacity *= 2;
+        }
+        new_token = (char*)parson_malloc(parser, new_capacity);
+        if (new_token == NULL) {
+            return feed_fail(feed_parser);
+        }
+        if (feed_parser->token_len > 0) {
+            memcpy(new_token, feed_parser->token, feed_parser->token_len);
+        }
+        parson_free(parser, feed_parser->token);
+        feed_parser->token = new_token;
+        feed_parser->token_capacity = new_capacity;
+    }
+    memcpy(feed_parser->token + feed_parser->token_len, bytes, len);
+    feed_parser->token_len += len;
+    return JSONSuccess;
+}
+
+/* Attaches a completed value to the open container (or makes it the root)
+   and advances the state machine. Frees the value on failure. */
+static JSON_Status feed_attach(JSON_Feed_Parser *feed_parser, JSON_Value *value) {
+    JSON_Parser const * parser = &feed_parser->parser;
+    JSON_Status status = JSONFailure;
+    if (value == NULL) {
+        return feed_fail(feed_parser);
+    }
+    if (feed_parser->stack_count == 0) {
+        feed_parser->root = value;
+        feed_parser->state = FEED_STATE_DONE;
+        return JSONSuccess;
+    } else {
+        JSON_Feed_Frame *top = &feed_parser->stack[feed_parser->stack_count - 1];
+        if (json_value_get_type(top->value) == JSONArray) {
+            status = json_array_add(parser, json_value_get_array(top->value), value);
+        } else {
+            status = json_object_add_with_hash(parser, json_value_get_object(top->value), top->pending_key, top->pending_key_hash, value);
+            if (status == JSONSuccess) {
+                top->pending_key = NULL; /* ownership passed to the object */
+            }
+        }
+        if (status != JSONSuccess) {
+            json_value_free(parser, value);
+            return feed_fail(feed_parser);
+        }
+        feed_parser->state = FEED_STATE_AFTER_VALUE;
+        return JSONSuccess;
+    }
+}
+
+static JSON_Status feed_push(JSON_Feed_Parser *feed_parser, JSON_Value *value) {
+    JSON_Parser const * parser = &feed_parser->parser;
+    if (feed_parser->stack_count > feed_parser->parser.max_nesting) {
+        json_value_free(parser, value);
+        return feed_fail(feed_parser);
+    }
+    if (feed_parser->stack_count >= feed_parser->stack_capacity) {
+        size_t new_capacity = feed_parser->stack_capacity ? feed_parser->stack_capacity * 2 : STARTING_CAPACITY;
+        JSON_Feed_Frame *new_stack = (JSON_Feed_Frame*)parson_malloc(parser, new_capacity * sizeof(JSON_Feed_Frame));
+        if (new_stack == NULL) {
+            json_value_free(parser, value);
+            return feed_fail(feed_parser);
+        }
+        if (feed_parser->stack_count > 0) {
+            memcpy(new_stack, feed_parser->stack, feed_parser->stack_count * sizeof(JSON_Feed_Frame));
+        }
+        parson_free(parser, feed_parser->stack);
+        feed_parser->stack = new_stack;
+        feed_parser->stack_capacity = new_capacity;
+    }
+    /* attach first so feed_fail can reach it through the root */
+    if (feed_attach(feed_parser, value) != JSONSuccess) {
+        return JSONFailure;
+    }
+    feed_parser->stack[feed_parser->stack_count].value = value;
+    feed_parser->stack[feed_parser->stack_count].pending_key = NULL;
+    feed_parser->stack_count++;
+    return JSONSuccess;
+}
+
+static JSON_Status feed_pop(JSON_Feed_Parser *feed_parser) {
+    JSON_Value *closed = feed_parser->stack[feed_parser->stack_count - 1].value;
+    if (feed_parser->parser.pack_number_arrays && json_value_get_type(closed) == JSONArray) {
+        json_array_pack_numbers(&feed_parser->parser, json_value_get_array(closed)); /* best effort - mixed arrays stay as they are */
+    }
+    feed_parser->stack_count--;
+    feed_parser->state = feed_parser->stack_count == 0 ? FEED_STATE_DONE : FEED_STATE_AFTER_VALUE;
+    return JSONSuccess;
+}
+
+/* Completes the accumulated string token. The buffer holds the raw contents
+   between the quotes; unescaping and control-character validation happen in
+   process_string, exactly as in the tree parser. */
+static JSON_Status feed_finish_string(JSON_Feed_Parser *feed_parser) {
+    JSON_Parser const * parser = &feed_parser->parser;
+    size_t processed_len = 0;
+    char *processed = NULL;
+    if (feed_append_token(feed_parser, "", 1) != JSONSuccess) { /* process_string scans NUL-terminated input */
+        return JSONFailure;
+    }
+    feed_parser->token_len--;
+    processed = process_string(parser, feed_parser->token, feed_parser->token_len, &processed_len);
+    if (processed == NULL) {
+        return feed_fail(feed_parser);
+    }
+    if (feed_parser->state == FEED_STATE_KEY_STRING) {
+        unsigned long key_hash = 0;
+        if (strlen(processed) != processed_len) { /* keys mustn't contain embedded NULs */
+            parson_free(parser, processed);
+            return feed_fail(feed_parser);
+        }
+        key_hash = hash_string(processed, processed_len);
+        if (parser->intern_pool != NULL) {
+            processed = json_intern_pool_intern_owned(parser, parser->intern_pool, processed, processed_len, key_hash);
+            if (processed == NULL) {
+                return feed_fail(feed_parser);
+            }
+        }
+        feed_parser->stack[feed_parser->stack_count - 1].pending_key = processed;
+        feed_parser->stack[feed_parser->stack_count - 1].pending_key_hash = key_hash;
+        feed_parser->state = FEED_STATE_COLON;
+        return JSONSuccess;
+    } else {
+        JSON_Value *value = json_value_init_string_no_copy(parser, processed, processed_len, PARSON_TRUE);
+        if (value == NULL) {
+            parson_free(parser, processed);
+            return feed_fail(feed_parser);
+        }
+        return feed_attach(feed_parser, value);
+    }
+}
+
+static JSON_Status feed_finish_number(JSON_Feed_Parser *feed_parser) {
+    JSON_Parser const * parser = &feed_parser->parser;
+    const char *token_ptr = NULL;
+    double number = 0.0;
+    if (feed_append_token(feed_parser, "", 1) != JSONSuccess) { /* NUL-terminate */
+        return JSONFailure;
+    }
+    feed_parser->token_len--;
+    token_ptr = feed_parser->token;
+    if (parse_number_token(&token_ptr, &number) != JSONSuccess
+        || token_ptr != feed_parser->token + feed_parser->token_len) {
+        return feed_fail(feed_parser);
+    }
+    feed_parser->token_len = 0;
+    return feed_attach(feed_parser, json_value_init_number(parser, number));
+}
+
+static JSON_Status feed_finish_literal(JSON_Feed_Parser *feed_parser) {
+    JSON_Parser const * parser = &feed_parser->parser;
+    JSON_Value *value = NULL;
+    if (feed_append_token(feed_parser, "", 1) != JSONSuccess) { /* NUL-terminate */
+        return JSONFailure;
+    }
+    feed_parser->token_len--;
+    if (strcmp(feed_parser->token, "true") == 0) {
+        value = json_value_init_boolean(parser, 1);
+    } else if (strcmp(feed_parser->token, "false") == 0) {
+        value = json_value_init_boolean(parser, 0);
+    } else if (strcmp(feed_parser->token, "null") == 0) {
+        value = json_value_init_null(parser);
+    } else {
+        return feed_fail(feed_parser);
+    }
+    feed_parser->token_len = 0;
+    return feed_attach(feed_parser, value);
+}
+
+JSON_Feed_Parser * json_feed_parser_create(JSON_Parser const * parser) {
+    JSON_Feed_Parser *feed_parser = (JSON_Feed_Parser*)parson_malloc(parser, sizeof(JSON_Feed_Parser));
+    if (feed_parser == NULL) {
+        return NULL;
+    }
+    feed_parser->parser = *parser;
+    feed_parser->state = FEED_STATE_VALUE;
+    feed_parser->root = NULL;
+    feed_parser->stack = NULL;
+    feed_parser->stack_count = 0;
+    feed_parser->stack_capacity = 0;
+    feed_parser->token = NULL;
+    feed_parser->token_len = 0;
+    feed_parser->token_capacity = 0;
+    feed_parser->in_escape = PARSON_FALSE;
+    return feed_parser;
+}
+
+JSON_Status json_feed_parser_feed(JSON_Feed_Parser *feed_parser, const char *chunk, size_t len) {
+    JSON_Parser const * parser = NULL;
+    const char *ptr = chunk;
+    const char *end = NULL;
+    if (feed_parser == NULL || (chunk == NULL && len != 0)) {
+        return JSONFailure;
+    }
+    if (feed_parser->state == FEED_STATE_ERROR) {
+        return JSONFailure;
+    }
+    parser = &feed_parser->parser;
+    end = chunk + len;
+    while (ptr < end) {
+        char current_char = *ptr;
+        switch (feed_parser->state) {
+            case FEED_STATE_STRING:
+            case FEED_STATE_KEY_STRING: {
+                const char *run_start = ptr;
+                parson_bool_t closed = PARSON_FALSE;
+                while (ptr < end) {
+                    if (feed_parser->in_escape) {
+                        feed_parser->in_escape = PARSON_FALSE;
+                        ptr++;
+                    } else if (*ptr == '\\') {
+                        feed_parser->in_escape = PARSON_TRUE;
+                        ptr++;
+                    } else if (*ptr == '\"') {
+                        closed = PARSON_TRUE;
+                        break;
+                    } else if ((unsigned char)*ptr < 0x20) {
+                        return feed_fail(feed_parser);
+                    } else {
+                        ptr++;
+                    }
                 }
-                written_total += written;
-                if (i < (count - 1)) {
-                    APPEND_STRING(",");
+                if (ptr > run_start && feed_append_token(feed_parser, run_start, (size_t)(ptr - run_start)) != JSONSuccess) {
+                    return JSONFailure;
                 }
-                if (is_pretty) {
-                    APPEND_STRING("\n");
+                if (closed) {
+                    ptr++; /* consume the closing quote */
+                    if (feed_finish_string(feed_parser) != JSONSuccess) {
+                        return JSONFailure;
+                    }
+                    feed_parser->token_len = 0;
                 }
+                break;
             }
-            if (count > 0 && is_pretty) {
-                APPEND_INDENT(level);
-            }
-            APPEND_STRING("]");
-            return written_total;
-        case JSONObject:
-            object = json_value_get_object(value);
-            count  = json_object_get_count(object);
-            APPEND_STRING("{");
-            if (count > 0 && is_pretty) {
-                APPEND_STRING("\n");
-            }
-            for (i = 0; i < count; i++) {
-                key = json_object_get_name(object, i);
-                if (key == NULL) {
-                    return -1;
+            case FEED_STATE_NUMBER: {
+                const char *run_start = ptr;
+                while (ptr < end && (isdigit((unsigned char)*ptr) || *ptr == '-' || *ptr == '+' || *ptr == '.' || *ptr == 'e' || *ptr == 'E')) {
+                    ptr++;
                 }
-                if (is_pretty) {
-                    APPEND_INDENT(level+1);
+                if (ptr > run_start && feed_append_token(feed_parser, run_start, (size_t)(ptr - run_start)) != JSONSuccess) {
+                    return JSONFailure;
                 }
-                /* We do not support key names with embedded \0 chars */
-                written = json_serialize_string(parser, key, strlen(key), buf);
-                if (written < 0) {
-                    return -1;
+                if (ptr < end) { /* delimiter reached - token is complete, delimiter is reprocessed */
+                    if (feed_finish_number(feed_parser) != JSONSuccess) {
+                        return JSONFailure;
+                    }
                 }
-                if (buf != NULL) {
-                    buf += written;
+                break;
+            }
+            case FEED_STATE_LITERAL: {
+                const char *run_start = ptr;
+                while (ptr < end && isalpha((unsigned char)*ptr)) {
+                    ptr++;
                 }
-                written_total += written;
-                APPEND_STRING(":");
-                if (is_pretty) {
-                    APPEND_STRING(" ");
+                if (ptr > run_start && feed_append_token(feed_parser, run_start, (size_t)(ptr - run_start)) != JSONSuccess) {
+                    return JSONFailure;
                 }
-                temp_value = json_object_get_value_at(object, i);
-                written = json_serialize_to_buffer_r(parser, temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
+                if (ptr < end) {
+                    if (feed_finish_literal(feed_parser) != JSONSuccess) {
+                        return JSONFailure;
+                    }
                 }
-                if (buf != NULL) {
-                    buf += written;
+                break;
+            }
+            case FEED_STATE_DONE:
+                return JSONSuccess; /* trailing bytes are ignored, like json_parse_string */
+            case FEED_STATE_VALUE:
+                if (isspace((unsigned char)current_char)) {
+                    ptr++;
+                } else if (current_char == '\"') {
+                    ptr++;
+                    feed_parser->token_len = 0;
+                    feed_parser->in_escape = PARSON_FALSE;
+                    feed_parser->state = FEED_STATE_STRING;
+                } else if (isdigit((unsigned char)current_char) || current_char == '-') {
+                    feed_parser->token_len = 0;
+                    feed_parser->state = FEED_STATE_NUMBER;
+                } else if (current_char == 't' || current_char == 'f' || current_char == 'n') {
+                    feed_parser->token_len = 0;
+                    feed_parser->state = FEED_STATE_LITERAL;
+                } else if (current_char == '{') {
+                    ptr++;
+                    if (feed_push(feed_parser, json_value_init_object(parser)) != JSONSuccess) {
+                        return JSONFailure;
+                    }
+                    feed_parser->state = FEED_STATE_KEY;
+                } else if (current_char == '[') {
+                    ptr++;
+                    if (feed_push(feed_parser, json_value_init_array(parser)) != JSONSuccess) {
+                        return JSONFailure;
+                    }
+                    feed_parser->state = FEED_STATE_VALUE;
+                } else if (current_char == ']' && feed_parser->stack_count > 0
+                           && json_value_get_type(feed_parser->stack[feed_parser->stack_count - 1].value) == JSONArray) {
+                    ptr++; /* empty array, or trailing comma before ']' */
+                    feed_pop(feed_parser);
+                } else {
+                    return feed_fail(feed_parser);
                 }
-                written_total += written;
-                if (i < (count - 1)) {
-                    APPEND_STRING(",");
+                break;
+            case FEED_STATE_KEY:
+                if (isspace((unsigned char)current_char)) {
+                    ptr++;
+                } else if (current_char == '\"') {
+                    ptr++;
+                    feed_parser->token_len = 0;
+                    feed_parser->in_escape = PARSON_FALSE;
+                    feed_parser->state = FEED_STATE_KEY_STRING;
+                } else if (current_char == '}') {
+                    ptr++; /* empty object, or trailing comma before '}' */
+                    feed_pop(feed_parser);
+                } else {
+                    return feed_fail(feed_parser);
                 }
-                if (is_pretty) {
-                    APPEND_STRING("\n");
+                break;
+            case FEED_STATE_COLON:
+                if (isspace((unsigned char)current_char)) {
+                    ptr++;
+                } else if (current_char == ':') {
+                    ptr++;
+                    feed_parser->state = FEED_STATE_VALUE;
+                } else {
+                    return feed_fail(feed_parser);
                 }
+                break;
+            case FEED_STATE_AFTER_VALUE: {
+                JSON_Value_Type top_type = json_value_get_type(feed_parser->stack[feed_parser->stack_count - 1].value);
+                if (isspace((unsigned char)current_char)) {
+                    ptr++;
+                } else if (current_char == ',') {
+                    ptr++;
+                    feed_parser->state = top_type == JSONObject ? FEED_STATE_KEY : FEED_STATE_VALUE;
+                } else if (current_char == ']' && top_type == JSONArray) {
+                    ptr++;
+                    feed_pop(feed_parser);
+                } else if (current_char == '}' && top_type == JSONObject) {
+                    ptr++;
+                    feed_pop(feed_parser);
+                } else {
+                    return feed_fail(feed_parser);
+                }
+                break;
             }
-            if (count > 0 && is_pretty) {
-                APPEND_INDENT(level);
+            default:
+                return feed_fail(feed_parser);
+        }
+    }
+    return JSONSuccess;
+}
+
+JSON_Value * json_feed_parser_finish(JSON_Feed_Parser *feed_parser) {
+    JSON_Value *result = NULL;
+    if (feed_parser == NULL) {
+        return NULL;
+    }
+    /* numbers and literals are only delimited by end of input at top level */
+    if (feed_parser->state == FEED_STATE_NUMBER) {
+        feed_finish_number(feed_parser);
+    } else if (feed_parser->state == FEED_STATE_LITERAL) {
+        feed_finish_literal(feed_parser);
+    }
+    if (feed_parser->state == FEED_STATE_DONE) {
+        result = feed_parser->root;
+        feed_parser->root = NULL;
+    } else {
+        feed_fail(feed_parser); /* incomplete or malformed document */
+    }
+    /* reset for the next document; accumulation buffers are kept */
+    feed_parser->state = FEED_STATE_VALUE;
+    feed_parser->stack_count = 0;
+    feed_parser->token_len = 0;
+    feed_parser->in_escape = PARSON_FALSE;
+    return result;
+}
+
+void json_feed_parser_destroy(JSON_Feed_Parser *feed_parser) {
+    JSON_Parser const * parser = NULL;
+    if (feed_parser == NULL) {
+        return;
+    }
+    parser = &feed_parser->parser;
+    feed_fail(feed_parser); /* releases the partial tree and pending keys */
+    parson_free(parser, feed_parser->stack);
+    parson_free(parser, feed_parser->token);
+    parson_free(parser, feed_parser);
+}
+
+/* Serialization */
+
+/* Built-in double-to-string formatter (Grisu2). Produces the shortest decimal
+   representation that round-trips through strtod, instead of the fixed 17
+   significant digits of sprintf's "%1.17g" - both shorter output and several
+   times faster, which matters for number-heavy payloads. Whole numbers within
+   the exactly-representable range take an integer fast path. Used when neither
+   float_fmt_str nor number_serialization_func is set on the parser; without a
+   64-bit type (see PARSON_UINT64) it falls back to sprintf. */
+#ifdef PARSON_UINT64
+
+#define PARSON_DP_SIGNIFICAND_MASK PARSON_U64_C(0x000FFFFF, 0xFFFFFFFF)
+#define PARSON_DP_EXPONENT_MASK    PARSON_U64_C(0x7FF00000, 0x00000000)
+#define PARSON_DP_HIDDEN_BIT       PARSON_U64_C(0x00100000, 0x00000000)
+
+typedef struct parson_diy_fp {
+    PARSON_UINT64 f;
+    int e;
+} parson_diy_fp;
+
+static PARSON_UINT64 parson_double_bits(double d) {
+    PARSON_UINT64 u;
+    memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+static parson_diy_fp parson_diy_fp_multiply(parson_diy_fp x, parson_diy_fp y) {
+    PARSON_UINT64 M32 = PARSON_U64_C(0, 0xFFFFFFFF);
+    PARSON_UINT64 a = x.f >> 32, b = x.f & M32, c = y.f >> 32, d = y.f & M32;
+    PARSON_UINT64 ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    PARSON_UINT64 tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    parson_diy_fp r;
+    tmp += (PARSON_UINT64)1 << 31; /* round */
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+/* Normalized powers of 10^(-348 + 8i), generated with arbitrary-precision
+   arithmetic; the bracketing scheme is the one from the Grisu paper. */
+static const parson_diy_fp parson_cached_powers[] = {
+    { PARSON_U64_C(0xFA8FD5A0, 0x081C0288), -1220 }, { PARSON_U64_C(0xBAAEE17F, 0xA23EBF76), -1193 }, { PARSON_U64_C(0x8B16FB20, 0x3055AC76), -1166 },
+    { PARSON_U64_C(0xCF42894A, 0x5DCE35EA), -1140 }, { PARSON_U64_C(0x9A6BB0AA, 0x55653B2D), -1113 }, { PARSON_U64_C(0xE61ACF03, 0x3D1A45DF), -1087 },
+    { PARSON_U64_C(0xAB70FE17, 0xC79AC6CA), -1060 }, { PARSON_U64_C(0xFF77B1FC, 0xBEBCDC4F), -1034 }, { PARSON_U64_C(0xBE5691EF, 0x416BD60C), -1007 },
+    { PARSON_U64_C(0x8DD01FAD, 0x907FFC3C), -980 }, { PARSON_U64_C(0xD3515C28, 0x31559A83), -954 }, { PARSON_U64_C(0x9D71AC8F, 0xADA6C9B5), -927 },
+    { PARSON_U64_C(0xEA9C2277, 0x23EE8BCB), -901 }, { PARSON_U64_C(0xAECC4991, 0x4078536D), -874 }, { PARSON_U64_C(0x823C1279, 0x5DB6CE57), -847 },
+    { PARSON_U64_C(0xC2109436, 0x4DFB5637), -821 }, { PARSON_U64_C(0x9096EA6F, 0x3848984F), -794 }, { PARSON_U64_C(0xD77485CB, 0x25823AC7), -768 },
+    { PARSON_U64_C(0xA086CFCD, 0x97BF97F4), -741 }, { PARSON_U64_C(0xEF340A98, 0x172AACE5), -715 }, { PARSON_U64_C(0xB23867FB, 0x2A35B28E), -688 },
+    { PARSON_U64_C(0x84C8D4DF, 0xD2C63F3B), -661 }, { PARSON_U64_C(0xC5DD4427, 0x1AD3CDBA), -635 }, { PARSON_U64_C(0x936B9FCE, 0xBB25C996), -608 },
+    { PARSON_U64_C(0xDBAC6C24, 0x7D62A584), -582 }, { PARSON_U64_C(0xA3AB6658, 0x0D5FDAF6), -555 }, { PARSON_U64_C(0xF3E2F893, 0xDEC3F126), -529 },
+    { PARSON_U64_C(0xB5B5ADA8, 0xAAFF80B8), -502 }, { PARSON_U64_C(0x87625F05, 0x6C7C4A8B), -475 }, { PARSON_U64_C(0xC9BCFF60, 0x34C13053), -449 },
+    { PARSON_U64_C(0x964E858C, 0x91BA2655), -422 }, { PARSON_U64_C(0xDFF97724, 0x70297EBD), -396 }, { PARSON_U64_C(0xA6DFBD9F, 0xB8E5B88F), -369 },
+    { PARSON_U64_C(0xF8A95FCF, 0x88747D94), -343 }, { PARSON_U64_C(0xB9447093, 0x8FA89BCF), -316 }, { PARSON_U64_C(0x8A08F0F8, 0xBF0F156B), -289 },
+    { PARSON_U64_C(0xCDB02555, 0x653131B6), -263 }, { PARSON_U64_C(0x993FE2C6, 0xD07B7FAC), -236 }, { PARSON_U64_C(0xE45C10C4, 0x2A2B3B06), -210 },
+    { PARSON_U64_C(0xAA242499, 0x697392D3), -183 }, { PARSON_U64_C(0xFD87B5F2, 0x8300CA0E), -157 }, { PARSON_U64_C(0xBCE50864, 0x92111AEB), -130 },
+    { PARSON_U64_C(0x8CBCCC09, 0x6F5088CC), -103 }, { PARSON_U64_C(0xD1B71758, 0xE219652C), -77 }, { PARSON_U64_C(0x9C400000, 0x00000000), -50 },
+    { PARSON_U64_C(0xE8D4A510, 0x00000000), -24 }, { PARSON_U64_C(0xAD78EBC5, 0xAC620000), 3 }, { PARSON_U64_C(0x813F3978, 0xF8940984), 30 },
+    { PARSON_U64_C(0xC097CE7B, 0xC90715B3), 56 }, { PARSON_U64_C(0x8F7E32CE, 0x7BEA5C70), 83 }, { PARSON_U64_C(0xD5D238A4, 0xABE98068), 109 },
+    { PARSON_U64_C(0x9F4F2726, 0x179A2245), 136 }, { PARSON_U64_C(0xED63A231, 0xD4C4FB27), 162 }, { PARSON_U64_C(0xB0DE6538, 0x8CC8ADA8), 189 },
+    { PARSON_U64_C(0x83C7088E, 0x1AAB65DB), 216 }, { PARSON_U64_C(0xC45D1DF9, 0x42711D9A), 242 }, { PARSON_U64_C(0x924D692C, 0xA61BE758), 269 },
+    { PARSON_U64_C(0xDA01EE64, 0x1A708DEA), 295 }, { PARSON_U64_C(0xA26DA399, 0x9AEF774A), 322 }, { PARSON_U64_C(0xF209787B, 0xB47D6B85), 348 },
+    { PARSON_U64_C(0xB454E4A1, 0x79DD1877), 375 }, { PARSON_U64_C(0x865B8692, 0x5B9BC5C2), 402 }, { PARSON_U64_C(0xC83553C5, 0xC8965D3D), 428 },
+    { PARSON_U64_C(0x952AB45C, 0xFA97A0B3), 455 }, { PARSON_U64_C(0xDE469FBD, 0x99A05FE3), 481 }, { PARSON_U64_C(0xA59BC234, 0xDB398C25), 508 },
+    { PARSON_U64_C(0xF6C69A72, 0xA3989F5C), 534 }, { PARSON_U64_C(0xB7DCBF53, 0x54E9BECE), 561 }, { PARSON_U64_C(0x88FCF317, 0xF22241E2), 588 },
+    { PARSON_U64_C(0xCC20CE9B, 0xD35C78A5), 614 }, { PARSON_U64_C(0x98165AF3, 0x7B2153DF), 641 }, { PARSON_U64_C(0xE2A0B5DC, 0x971F303A), 667 },
+    { PARSON_U64_C(0xA8D9D153, 0x5CE3B396), 694 }, { PARSON_U64_C(0xFB9B7CD9, 0xA4A7443C), 720 }, { PARSON_U64_C(0xBB764C4C, 0xA7A44410), 747 },
+    { PARSON_U64_C(0x8BAB8EEF, 0xB6409C1A), 774 }, { PARSON_U64_C(0xD01FEF10, 0xA657842C), 800 }, { PARSON_U64_C(0x9B10A4E5, 0xE9913129), 827 },
+    { PARSON_U64_C(0xE7109BFB, 0xA19C0C9D), 853 }, { PARSON_U64_C(0xAC2820D9, 0x623BF429), 880 }, { PARSON_U64_C(0x80444B5E, 0x7AA7CF85), 907 },
+    { PARSON_U64_C(0xBF21E440, 0x03ACDD2D), 933 }, { PARSON_U64_C(0x8E679C2F, 0x5E44FF8F), 960 }, { PARSON_U64_C(0xD433179D, 0x9C8CB841), 986 },
+    { PARSON_U64_C(0x9E19DB92, 0xB4E31BA9), 1013 }, { PARSON_U64_C(0xEB96BF6E, 0xBADF77D9), 1039 }, { PARSON_U64_C(0xAF87023B, 0x9BF0EE6B), 1066 }
+};
+
+static parson_diy_fp parson_cached_power(int e, int *K) {
+    /* k = ceil((alpha - e - 63) * log10(2)), mapped onto the step-8 table */
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    unsigned int index;
+    if (dk - k > 0.0) {
+        k++;
+    }
+    index = (unsigned int)((k >> 3) + 1);
+    *K = -(-348 + (int)(index << 3));
+    return parson_cached_powers[index];
+}
+
+static void parson_grisu_round(char *digits, int len, PARSON_UINT64 delta, PARSON_UINT64 rest, PARSON_UINT64 ten_kappa, PARSON_UINT64 wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        digits[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static void parson_digit_gen(parson_diy_fp W, parson_diy_fp Mp, PARSON_UINT64 delta, char *digits, int *len, int *K) {
+    static const unsigned int pow10_32[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    PARSON_UINT64 one_f = (PARSON_UINT64)1 << -Mp.e;
+    PARSON_UINT64 wp_w = Mp.f - W.f;
+    unsigned int p1 = (unsigned int)(Mp.f >> -Mp.e);
+    PARSON_UINT64 p2 = Mp.f & (one_f - 1);
+    int kappa = 1;
+    while (kappa < 10 && p1 >= pow10_32[kappa]) {
+        kappa++;
+    }
+    *len = 0;
+    while (kappa > 0) {
+        unsigned int d = p1 / pow10_32[kappa - 1];
+        PARSON_UINT64 tmp;
+        p1 %= pow10_32[kappa - 1];
+        kappa--;
+        if (*len > 0 || d != 0) {
+            digits[(*len)++] = (char)('0' + d);
+        }
+        tmp = ((PARSON_UINT64)p1 << -Mp.e) + p2;
+        if (tmp <= delta) {
+            *K += kappa;
+            parson_grisu_round(digits, *len, delta, tmp, (PARSON_UINT64)pow10_32[kappa] << -Mp.e, wp_w);
+            return;
+        }
+    }
+    for (;;) {
+        unsigned int d;
+        p2 *= 10;
+        delta *= 10;
+        d = (unsigned int)(p2 >> -Mp.e);
+        if (*len > 0 || d != 0) {
+            digits[(*len)++] = (char)('0' + d);
+        }
+        p2 &= one_f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *K += kappa;
+            /* once the scale factor no longer fits 64 bits, skip the
+               correction toward w; the result is still in the interval */
+            parson_grisu_round(digits, *len, delta, p2, one_f,
+                               -kappa < 10 ? wp_w * pow10_32[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+static void parson_grisu2(double value, char *digits, int *len, int *K) {
+    PARSON_UINT64 bits = parson_double_bits(value);
+    PARSON_UINT64 significand = bits & PARSON_DP_SIGNIFICAND_MASK;
+    int biased_e = (int)((bits & PARSON_DP_EXPONENT_MASK) >> 52);
+    parson_diy_fp v, w_p, w_m, c_mk, W, Wp, Wm;
+    if (biased_e != 0) {
+        v.f = significand + PARSON_DP_HIDDEN_BIT;
+        v.e = biased_e - 1075; /* exponent bias + significand size */
+    } else {
+        v.f = significand;
+        v.e = -1074;
+    }
+    /* normalized boundaries of the rounding interval around value */
+    w_p.f = (v.f << 1) + 1;
+    w_p.e = v.e - 1;
+    while (!(w_p.f & (PARSON_DP_HIDDEN_BIT << 1))) {
+        w_p.f <<= 1;
+        w_p.e--;
+    }
+    w_p.f <<= 10; /* 64 - 52 - 2 */
+    w_p.e -= 10;
+    if (v.f == PARSON_DP_HIDDEN_BIT) {
+        w_m.f = (v.f << 2) - 1;
+        w_m.e = v.e - 2;
+    } else {
+        w_m.f = (v.f << 1) - 1;
+        w_m.e = v.e - 1;
+    }
+    w_m.f <<= w_m.e - w_p.e;
+    w_m.e = w_p.e;
+    while (!(v.f & ((PARSON_UINT64)1 << 63))) {
+        v.f <<= 1;
+        v.e--;
+    }
+    *K = 0;
+    c_mk = parson_cached_power(w_p.e, K);
+    W = parson_diy_fp_multiply(v, c_mk);
+    Wp = parson_diy_fp_multiply(w_p, c_mk);
+    Wm = parson_diy_fp_multiply(w_m, c_mk);
+    Wm.f++;
+    Wp.f--;
+    parson_digit_gen(W, Wp, Wp.f - Wm.f, digits, len, K);
+}
+
+/* Lays the digits out like %g would: plain decimal while the exponent is
+   moderate, d.ddde+xx otherwise. Both forms parse back through strtod. */
+static int parson_emit_digits(char *buf, const char *digits, int len, int K) {
+    int kk = len + K; /* value = 0.digits * 10^kk */
+    int i, pos = 0;
+    if (K >= 0 && kk <= 21) { /* dddd0000 */
+        for (i = 0; i < len; i++) {
+            buf[pos++] = digits[i];
+        }
+        for (i = len; i < kk; i++) {
+            buf[pos++] = '0';
+        }
+    } else if (0 < kk && kk <= 21) { /* dd.dddd */
+        for (i = 0; i < kk; i++) {
+            buf[pos++] = digits[i];
+        }
+        buf[pos++] = '.';
+        for (i = kk; i < len; i++) {
+            buf[pos++] = digits[i];
+        }
+    } else if (-6 < kk && kk <= 0) { /* 0.000dddd */
+        buf[pos++] = '0';
+        buf[pos++] = '.';
+        for (i = 0; i < -kk; i++) {
+            buf[pos++] = '0';
+        }
+        for (i = 0; i < len; i++) {
+            buf[pos++] = digits[i];
+        }
+    } else { /* d.ddde+xx */
+        int e = kk - 1;
+        buf[pos++] = digits[0];
+        if (len > 1) {
+            buf[pos++] = '.';
+            for (i = 1; i < len; i++) {
+                buf[pos++] = digits[i];
             }
-            APPEND_STRING("}");
-            return written_total;
+        }
+        buf[pos++] = 'e';
+        if (e < 0) {
+            buf[pos++] = '-';
+            e = -e;
+        }
+        if (e >= 100) {
+            buf[pos++] = (char)('0' + e / 100);
+            e %= 100;
+            buf[pos++] = (char)('0' + e / 10);
+            buf[pos++] = (char)('0' + e % 10);
+        } else if (e >= 10) {
+            buf[pos++] = (char)('0' + e / 10);
+            buf[pos++] = (char)('0' + e % 10);
+        } else {
+            buf[pos++] = (char)('0' + e);
+        }
+    }
+    return pos;
+}
+
+static int parson_serialize_number_shortest(double num, char *buf) {
+    char digits[20];
+    int len = 0, K = 0, pos = 0;
+    PARSON_UINT64 bits = parson_double_bits(num);
+    if ((bits & PARSON_DP_EXPONENT_MASK) == PARSON_DP_EXPONENT_MASK) {
+        /* NaN or infinity - not valid JSON either way, keep sprintf's output */
+        return sprintf(buf, PARSON_DEFAULT_FLOAT_FORMAT, num);
+    }
+    if (bits >> 63) {
+        buf[pos++] = '-';
+        num = -num;
+    }
+    if (num == 0.0) {
+        buf[pos++] = '0';
+        buf[pos] = '\0';
+        return pos;
+    }
+    if (num < 9007199254740992.0 && floor(num) == num) { /* whole numbers below 2^53 */
+        PARSON_UINT64 n = (PARSON_UINT64)num;
+        char tmp[20];
+        int t = 0;
+        while (n > 0) {
+            tmp[t++] = (char)('0' + (int)(n % 10));
+            n /= 10;
+        }
+        while (t > 0) {
+            buf[pos++] = tmp[--t];
+        }
+        buf[pos] = '\0';
+        return pos;
+    }
+    parson_grisu2(num, digits, &len, &K);
+    pos += parson_emit_digits(buf + pos, digits, len, K);
+    buf[pos] = '\0';
+    return pos;
+}
+
+#else /* no 64-bit type available */
+
+static int parson_serialize_number_shortest(double num, char *buf) {
+    return sprintf(buf, PARSON_DEFAULT_FLOAT_FORMAT, num);
+}
+
+#endif /* PARSON_UINT64 */
+
+/* Output goes through a JSON_Writer, which comes in four flavors:
+   counting (buf == NULL, only advances pos - used to compute exact sizes),
+   fixed (caller-sized buffer, unchecked writes, same contract as before),
+   growable (amortized doubling through the parser's allocator) and streaming
+   (fixed buffer flushed through write_func as it fills, so memory stays
+   bounded). The growable flavor lets json_serialize_to_string emit in a
+   single tree traversal instead of a sizing pass followed by a writing pass. */
+struct json_writer {
+    JSON_Parser const *parser; /* allocator for the growable flavor */
+    char *buf;                 /* NULL when only counting */
+    size_t pos;
+    size_t capacity;           /* tracked only when growable or streaming */
+    parson_bool_t growable;
+    parson_bool_t failed;
+    JSON_Stream_Write_Function write_func; /* non-NULL for the streaming flavor */
+    void *write_userdata;
+};
+
+static void json_writer_flush(JSON_Writer *writer) {
+    if (writer->pos > 0 && !writer->failed) {
+        if (writer->write_func(writer->buf, writer->pos, writer->write_userdata) != writer->pos) {
+            writer->failed = PARSON_TRUE;
+        }
+        writer->pos = 0;
+    }
+}
+
+/* Returns the write position after making room for 'bytes' more characters
+   plus a terminating NUL, or NULL for counting writers and on failure.
+   Fixed writers have room by contract - the caller sized the buffer. */
+static char * json_writer_reserve(JSON_Writer *writer, size_t bytes) {
+    if (writer->failed) {
+        return NULL;
+    }
+    if (writer->write_func && writer->pos + bytes + 1 > writer->capacity) {
+        json_writer_flush(writer);
+        if (writer->failed || bytes + 1 > writer->capacity) {
+            writer->failed = PARSON_TRUE; /* a single token larger than the buffer */
+            return NULL;
+        }
+    }
+    if (writer->growable && writer->pos + bytes + 1 > writer->capacity) {
+        size_t new_capacity = writer->capacity ? writer->capacity * 2 : STARTING_CAPACITY;
+        char *new_buf = NULL;
+        while (new_capacity < writer->pos + bytes + 1) {
+            new_capacity *= 2;
+        }
+        new_buf = (char*)parson_malloc(writer->parser, new_capacity);
+        if (new_buf == NULL) {
+            writer->failed = PARSON_TRUE;
+            return NULL;
+        }
+        if (writer->pos > 0) {
+            memcpy(new_buf, writer->buf, writer->pos);
+        }
+        parson_free(writer->parser, writer->buf);
+        writer->buf = new_buf;
+        writer->capacity = new_capacity;
+    }
+    return writer->buf ? writer->buf + writer->pos : NULL;
+}
+
+static void json_writer_append(JSON_Writer *writer, const char *bytes, size_t len) {
+    char *dst = json_writer_reserve(writer, len);
+    if (dst != NULL) {
+        memcpy(dst, bytes, len);
+    }
+    if (!writer->failed) {
+        writer->pos += len;
+    }
+}
+
+/* APPEND_STRING() is only called on string literals. */
+#define APPEND_STRING(str) json_writer_append(writer, (str), SIZEOF_TOKEN((str)))
+
+#define APPEND_INDENT(level) do {\
+                                int level_i = 0;\
+                                for (level_i = 0; level_i < (level); level_i++) {\
+                                    APPEND_STRING(PARSON_INDENT_STR);\
+                                }\
+                            } while (0)
+
+static JSON_Status json_serialize_scalar(JSON_Parser const * parser, const JSON_Value *value, JSON_Writer *writer, char *num_buf) {
+    const char *string = NULL;
+    double num = 0.0;
+    int written = -1;
+    size_t len = 0;
+    char *num_dst = NULL;
+
+    switch (json_value_get_type(value)) {
         case JSONString:
             string = json_value_get_string(value);
             if (string == NULL) {
-                return -1;
+                return JSONFailure;
             }
             len = json_value_get_string_len(value);
-            written = json_serialize_string(parser, string, len, buf);
-            if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
-            }
-            written_total += written;
-            return written_total;
+            return json_serialize_string(parser, string, len, writer);
         case JSONBoolean:
             if (json_value_get_boolean(value)) {
                 APPEND_STRING("true");
             } else {
                 APPEND_STRING("false");
             }
-            return written_total;
+            return writer->failed ? JSONFailure : JSONSuccess;
         case JSONNumber:
             num = json_value_get_number(value);
-            if (buf != NULL) {
-                num_buf = buf;
+            num_dst = json_writer_reserve(writer, PARSON_NUM_BUF_SIZE);
+            if (writer->failed) {
+                return JSONFailure;
+            }
+            if (num_dst == NULL) {
+                num_dst = num_buf; /* counting pass formats into scratch */
             }
             if (parser->number_serialization_func) {
-                written = parser->number_serialization_func(num, num_buf);
+                written = parser->number_serialization_func(num, num_dst);
             } else if (parser->float_fmt_str) {
-                written = sprintf(num_buf, parser->float_fmt_str, num);
+                written = sprintf(num_dst, parser->float_fmt_str, num);
             } else {
-                written = sprintf(num_buf, PARSON_DEFAULT_FLOAT_FORMAT, num);
+                written = parson_serialize_number_shortest(num, num_dst);
             }
             if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
+                return JSONFailure;
             }
-            written_total += written;
-            return written_total;
+            writer->pos += written;
+            return JSONSuccess;
         case JSONNull:
             APPEND_STRING("null");
-            return written_total;
+            return writer->failed ? JSONFailure : JSONSuccess;
         case JSONError:
-            return -1;
         default:
-            return -1;
+            return JSONFailure;
     }
 }
 
-static int json_serialize_string(JSON_Parser const * parser, const char *string, size_t len, char *buf) {
-    size_t i = 0;
-    char c = '\0';
-    int written = -1, written_total = 0;
-    APPEND_STRING("\"");
-    for (i = 0; i < len; i++) {
-        c = string[i];
-        switch (c) {
-            case '\"': APPEND_STRING("\\\""); break;
-            case '\\': APPEND_STRING("\\\\"); break;
-            case '\b': APPEND_STRING("\\b"); break;
-            case '\f': APPEND_STRING("\\f"); break;
-            case '\n': APPEND_STRING("\\n"); break;
-            case '\r': APPEND_STRING("\\r"); break;
-            case '\t': APPEND_STRING("\\t"); break;
-            case '\x00': APPEND_STRING("\\u0000"); break;
-            case '\x01': APPEND_STRING("\\u0001"); break;
-            case '\x02': APPEND_STRING("\\u0002"); break;
-            case '\x03': APPEND_STRING("\\u0003"); break;
-            case '\x04': APPEND_STRING("\\u0004"); break;
-            case '\x05': APPEND_STRING("\\u0005"); break;
-            case '\x06': APPEND_STRING("\\u0006"); break;
-            case '\x07': APPEND_STRING("\\u0007"); break;
-            /* '\x08' duplicate: '\b' */
-            /* '\x09' duplicate: '\t' */
-            /* '\x0a' duplicate: '\n' */
-            case '\x0b': APPEND_STRING("\\u000b"); break;
-            /* '\x0c' duplicate: '\f' */
-            /* '\x0d' duplicate: '\r' */
-            case '\x0e': APPEND_STRING("\\u000e"); break;
-            case '\x0f': APPEND_STRING("\\u000f"); break;
-            case '\x10': APPEND_STRING("\\u0010"); break;
-            case '\x11': APPEND_STRING("\\u0011"); break;
-            case '\x12': APPEND_STRING("\\u0012"); break;
-            case '\x13': APPEND_STRING("\\u0013"); break;
-            case '\x14': APPEND_STRING("\\u0014"); break;
-            case '\x15': APPEND_STRING("\\u0015"); break;
-            case '\x16': APPEND_STRING("\\u0016"); break;
-            case '\x17': APPEND_STRING("\\u0017"); break;
-            case '\x18': APPEND_STRING("\\u0018"); break;
-            case '\x19': APPEND_STRING("\\u0019"); break;
-            case '\x1a': APPEND_STRING("\\u001a"); break;
-            case '\x1b': APPEND_STRING("\\u001b"); break;
-            case '\x1c': APPEND_STRING("\\u001c"); break;
-            case '\x1d': APPEND_STRING("\\u001d"); break;
-            case '\x1e': APPEND_STRING("\\u001e"); break;
-            case '\x1f': APPEND_STRING("\\u001f"); break;
-            case '/':
-                if (parser->escape_slashes) {
-                    APPEND_STRING("\\/");  /* to make json embeddable in xml\/html */
+/* One frame per open container: like the parser, the serializer walks through
+   an explicit heap stack, so the nesting a raised max_nesting lets through is
+   bounded by memory rather than the thread stack. */
+typedef struct json_serialize_frame {
+    const JSON_Value *value;
+    size_t index; /* children emitted so far */
+} JSON_Serialize_Frame;
+
+static JSON_Status json_serialize_to_buffer_r(JSON_Parser const * parser, const JSON_Value *value, JSON_Writer *writer, int level, parson_bool_t is_pretty, char *num_buf)
+{
+    JSON_Serialize_Frame *stack = NULL;
+    size_t stack_count = 0;
+    size_t stack_capacity = 0;
+    const JSON_Value *current = value;
+    JSON_Value number_value;
+    JSON_Status status = JSONFailure;
+    const int base_level = level;
+
+    for (;;) {
+        JSON_Value_Type type = json_value_get_type(current);
+        if (writer->failed) {
+            goto error;
+        }
+        if (type == JSONArray || type == JSONObject) {
+            size_t child_count = type == JSONArray ? json_array_get_count(json_value_get_array(current))
+                                                   : json_object_get_count(json_value_get_object(current));
+            if (stack_count >= stack_capacity) {
+                size_t new_capacity = stack_capacity ? stack_capacity * 2 : STARTING_CAPACITY;
+                JSON_Serialize_Frame *new_stack = (JSON_Serialize_Frame*)parson_malloc(parser, new_capacity * sizeof(JSON_Serialize_Frame));
+                if (new_stack == NULL) {
+                    goto error;
+                }
+                if (stack_count > 0) {
+                    memcpy(new_stack, stack, stack_count * sizeof(JSON_Serialize_Frame));
+                }
+                parson_free(parser, stack);
+                stack = new_stack;
+                stack_capacity = new_capacity;
+            }
+            stack[stack_count].value = current;
+            stack[stack_count].index = 0;
+            stack_count++;
+            json_writer_append(writer, type == JSONArray ? "[" : "{", 1);
+            if (child_count > 0 && is_pretty) {
+                APPEND_STRING("\n");
+            }
+        } else {
+            if (json_serialize_scalar(parser, current, writer, num_buf) != JSONSuccess) {
+                goto error;
+            }
+        }
+        /* ascend: finish the value just emitted - separators, then either the
+           next child of the enclosing container or its closing bracket */
+        for (;;) {
+            JSON_Serialize_Frame *frame = NULL;
+            JSON_Array *array = NULL;
+            JSON_Object *object = NULL;
+            size_t child_count = 0;
+            if (stack_count == 0) {
+                status = writer->failed ? JSONFailure : JSONSuccess;
+                goto done;
+            }
+            frame = &stack[stack_count - 1];
+            level = base_level + (int)stack_count - 1;
+            if (json_value_get_type(frame->value) == JSONArray) {
+                array = json_value_get_array(frame->value);
+                child_count = json_array_get_count(array);
+            } else {
+                object = json_value_get_object(frame->value);
+                child_count = json_object_get_count(object);
+            }
+            if (frame->index > 0) { /* a child just finished */
+                if (frame->index < child_count) {
+                    APPEND_STRING(",");
+                }
+                if (is_pretty) {
+                    APPEND_STRING("\n");
+                }
+            }
+            if (frame->index < child_count) {
+                if (is_pretty) {
+                    APPEND_INDENT(level + 1);
+                }
+                if (object != NULL) {
+                    const char *key = json_object_get_name(object, frame->index);
+                    if (key == NULL) {
+                        goto error;
+                    }
+                    /* We do not support key names with embedded \0 chars */
+                    if (json_serialize_string(parser, key, strlen(key), writer) != JSONSuccess) {
+                        goto error;
+                    }
+                    APPEND_STRING(":");
+                    if (is_pretty) {
+                        APPEND_STRING(" ");
+                    }
+                    current = json_object_get_value_at(object, frame->index);
+                } else if (array->numbers != NULL) {
+                    /* packed arrays store bare doubles; wrap each in a stack
+                       value so the number formatting path below is shared */
+                    number_value.parent = NULL;
+                    number_value.ref_count = 0;
+                    number_value.type = JSONNumber;
+                    number_value.value.number = array->numbers[frame->index];
+                    current = &number_value;
                 } else {
-                    APPEND_STRING("/");
+                    current = json_array_get_value(array, frame->index);
                 }
-                break;
-            default:
-                if (buf != NULL) {
-                    buf[0] = c;
-                    buf += 1;
+                frame->index++;
+                break; /* emit 'current' */
+            }
+            if (child_count > 0 && is_pretty) {
+                APPEND_INDENT(level);
+            }
+            json_writer_append(writer, array != NULL ? "]" : "}", 1);
+            stack_count--;
+        }
+    }
+done:
+    parson_free(parser, stack);
+    return status;
+error:
+    parson_free(parser, stack);
+    return JSONFailure;
+}
+
+/* Escape classification for json_serialize_string: NULL marks bytes that are
+   emitted verbatim, everything else is the sequence to append in its place.
+   '/' stays NULL here because escaping it is a parser option. */
+static const char * const parson_escape_table[256] = {
+    "\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+    "\\b", "\\t", "\\n", "\\u000b", "\\f", "\\r", "\\u000e", "\\u000f",
+    "\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+    "\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f",
+    NULL, NULL, "\\\"", NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, "\\\\", NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+static JSON_Status json_serialize_string(JSON_Parser const * parser, const char *string, size_t len, JSON_Writer *writer) {
+    size_t i = 0;
+    APPEND_STRING("\"");
+    while (i < len) {
+        const char *run = string + i;
+        const char *run_end = NULL;
+        size_t run_len = 0;
+        unsigned char c = 0;
+        const char *escaped = NULL;
+        if (parser->escape_slashes) {
+            /* '/' joins the stop set, which the shared kernel doesn't know
+               about, so this mode classifies through the table directly */
+            run_end = run;
+            while ((size_t)(run_end - string) < len) {
+                c = (unsigned char)*run_end;
+                if (parson_escape_table[c] != NULL || c == '/') {
+                    break;
                 }
-                written_total += 1;
-                break;
+                run_end++;
+            }
+        } else {
+            /* same stop set as string parsing (quote, backslash, controls),
+               so the scan shares the parser's vector kernel; the terminating
+               or embedded NUL is a control byte, which bounds the scan */
+            run_end = scan_string_special(run);
+        }
+        run_len = (size_t)(run_end - run);
+        if (run_len > 0) {
+            json_writer_append(writer, run, run_len);
+            i += run_len;
+            continue;
         }
+        c = (unsigned char)string[i];
+        if (c == '/') {
+            APPEND_STRING("\\/"); /* to make json embeddable in xml\/html */
+        } else {
+            escaped = parson_escape_table[c];
+            json_writer_append(writer, escaped, escaped[1] == 'u' ? 6 : 2);
+        }
+        i++;
     }
     APPEND_STRING("\"");
-    return written_total;
+    return writer->failed ? JSONFailure : JSONSuccess;
 }
 
 #undef APPEND_STRING
 #undef APPEND_INDENT
 
 /* Parser API */
+#ifdef PARSON_ENABLE_PARALLEL
+
+typedef struct json_parallel_slice {
+    JSON_Parser parser;  /* worker copy: stats and intern pool detached, neither is thread-safe */
+    const char *input;
+    const size_t *offsets;
+    size_t first;
+    size_t count;
+    JSON_Value **slots;  /* disjoint range of the result array's items */
+    JSON_Value *parent;
+    parson_bool_t threaded;
+    JSON_Status status;
+} JSON_Parallel_Slice;
+
+static void json_parallel_parse_slice(JSON_Parallel_Slice *slice) {
+    size_t i = 0;
+    JSON_Parser const * parser = &slice->parser;
+    slice->status = JSONSuccess;
+    for (i = 0; i < slice->count; i++) {
+        const char *element = slice->input + slice->offsets[slice->first + i];
+        JSON_Value *value = parse_value(parser, &element, PARSON_FALSE);
+        if (value != NULL) {
+            /* the element must end exactly at the next separator, as it would
+               when the sequential parser continued from here */
+            skip_whitespaces(parser, &element);
+            if (*element != ',' && *element != ']') {
+                json_value_free(parser, value);
+                value = NULL;
+            }
+        }
+        if (value == NULL) {
+            slice->status = JSONFailure;
+            while (i > 0) {
+                i--;
+                json_value_free(parser, slice->slots[slice->first + i]);
+                slice->slots[slice->first + i] = NULL;
+            }
+            return;
+        }
+        value->parent = slice->parent;
+        slice->slots[slice->first + i] = value;
+    }
+}
+
+#if defined(PARSON_PARALLEL_WIN32)
+typedef HANDLE JSON_Parallel_Thread;
+static DWORD WINAPI json_parallel_thread_main(LPVOID arg) {
+    json_parallel_parse_slice((JSON_Parallel_Slice*)arg);
+    return 0;
+}
+static parson_bool_t json_parallel_thread_start(JSON_Parallel_Thread *thread, LPTHREAD_START_ROUTINE main_func, void *arg) {
+    *thread = CreateThread(NULL, 0, main_func, arg, 0, NULL);
+    return *thread != NULL;
+}
+static void json_parallel_thread_join(JSON_Parallel_Thread *thread) {
+    WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+}
+#else
+typedef pthread_t JSON_Parallel_Thread;
+static void * json_parallel_thread_main(void *arg) {
+    json_parallel_parse_slice((JSON_Parallel_Slice*)arg);
+    return NULL;
+}
+static parson_bool_t json_parallel_thread_start(JSON_Parallel_Thread *thread, void * (*main_func)(void*), void *arg) {
+    return pthread_create(thread, NULL, main_func, arg) == 0;
+}
+static void json_parallel_thread_join(JSON_Parallel_Thread *thread) {
+    pthread_join(*thread, NULL);
+}
+#endif
+
+/* Structural pre-scan of a top-level array: records the offset of every
+   element boundary without interpreting element contents beyond string and
+   bracket structure. Returns the element count, or (size_t)-1 when the shell
+   is not well formed (the sequential parser then reports the error). */
+static size_t json_parallel_scan_elements(JSON_Parser const * parser, const char *string, size_t **out_offsets) {
+    size_t *offsets = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t depth = 1;
+    parson_bool_t in_string = PARSON_FALSE;
+    parson_bool_t pending_element = PARSON_TRUE;
+    const char *p = string + 1; /* the caller checked the '[' */
+    while (*p != '\0') {
+        char c = *p;
+        if (in_string) {
+            if (c == '\\') {
+                p++;
+                if (*p == '\0') {
+                    break;
+                }
+            } else if (c == '\"') {
+                in_string = PARSON_FALSE;
+            }
+            p++;
+            continue;
+        }
+        if (depth == 1) {
+            if (c == ',') {
+                if (pending_element) {
+                    goto malformed;
+                }
+                pending_element = PARSON_TRUE;
+            } else if (pending_element && c != ']' && !isspace((unsigned char)c)) {
+                if (count >= capacity) {
+                    size_t new_capacity = capacity ? capacity * 2 : STARTING_CAPACITY;
+                    size_t *new_offsets = (size_t*)parson_malloc(parser, new_capacity * sizeof(size_t));
+                    if (new_offsets == NULL) {
+                        goto malformed;
+                    }
+                    if (count > 0) {
+                        memcpy(new_offsets, offsets, count * sizeof(size_t));
+                    }
+                    parson_free(parser, offsets);
+                    offsets = new_offsets;
+                    capacity = new_capacity;
+                }
+                offsets[count++] = (size_t)(p - string);
+                pending_element = PARSON_FALSE;
+            }
+        }
+        switch (c) {
+            case '\"':
+                in_string = PARSON_TRUE;
+                break;
+            case '{': case '[':
+                depth++;
+                break;
+            case '}': case ']':
+                if (depth == 1 && c == '}') {
+                    goto malformed;
+                }
+                depth--;
+                if (depth == 0) {
+                    *out_offsets = offsets;
+                    return count;
+                }
+                break;
+            default:
+                break;
+        }
+        p++;
+    }
+malformed:
+    parson_free(parser, offsets);
+    return (size_t)-1;
+}
+
+/* Splits a top-level array at element boundaries and parses the slices on
+   parse_thread_count threads, each writing into its disjoint range of the
+   result array's items. Sets *out_attempted when its outcome is
+   authoritative; otherwise the caller falls back to the sequential path
+   (non-array input, malformed shell, comments enabled, too little work). */
+static JSON_Value * json_parse_string_parallel(JSON_Parser const * parser, const char *string, parson_bool_t *out_attempted) {
+    const char *start = string;
+    size_t *offsets = NULL;
+    size_t count = 0;
+    size_t thread_count = 0;
+    size_t chunk = 0, extra = 0, first = 0;
+    JSON_Value *root = NULL;
+    JSON_Array *array = NULL;
+    JSON_Parallel_Slice *slices = NULL;
+    JSON_Parallel_Thread *threads = NULL;
+    size_t i = 0;
+    parson_bool_t failed = PARSON_FALSE;
+
+    *out_attempted = PARSON_FALSE;
+    if (parser->allow_comments) {
+        return NULL; /* the structural pre-scan does not understand comments */
+    }
+    skip_whitespaces(parser, &start);
+    if (*start != '[') {
+        return NULL;
+    }
+    count = json_parallel_scan_elements(parser, start, &offsets);
+    if (count == (size_t)-1) {
+        return NULL;
+    }
+    thread_count = parser->parse_thread_count;
+    if (thread_count > count) {
+        thread_count = count;
+    }
+    if (thread_count < 2) {
+        parson_free(parser, offsets);
+        return NULL; /* too little work to be worth threading */
+    }
+    *out_attempted = PARSON_TRUE;
+
+    root = json_value_init_array(parser);
+    if (root == NULL) {
+        goto error;
+    }
+    array = json_value_get_array(root);
+    if (json_array_resize(parser, array, count) != JSONSuccess) {
+        goto error;
+    }
+    memset(array->items, 0, count * sizeof(JSON_Value*)); /* error path scans for filled slots */
+    slices = (JSON_Parallel_Slice*)parson_malloc(parser, thread_count * sizeof(JSON_Parallel_Slice));
+    threads = (JSON_Parallel_Thread*)parson_malloc(parser, thread_count * sizeof(JSON_Parallel_Thread));
+    if (slices == NULL || threads == NULL) {
+        goto error;
+    }
+    chunk = count / thread_count;
+    extra = count % thread_count;
+    for (i = 0; i < thread_count; i++) {
+        JSON_Parallel_Slice *slice = &slices[i];
+        slice->parser = *parser;
+        slice->parser.stats = NULL;
+        slice->parser.intern_pool = NULL;
+        slice->input = start;
+        slice->offsets = offsets;
+        slice->first = first;
+        slice->count = chunk + (i < extra ? 1 : 0);
+        slice->slots = array->items;
+        slice->parent = root;
+        slice->threaded = PARSON_FALSE;
+        slice->status = JSONFailure;
+        first += slice->count;
+    }
+    for (i = 0; i + 1 < thread_count; i++) {
+        slices[i].threaded = json_parallel_thread_start(&threads[i], json_parallel_thread_main, &slices[i]);
+        if (!slices[i].threaded) {
+            json_parallel_parse_slice(&slices[i]); /* couldn't spawn - do it here */
+        }
+    }
+    json_parallel_parse_slice(&slices[thread_count - 1]); /* last slice runs on the caller */
+    for (i = 0; i + 1 < thread_count; i++) {
+        if (slices[i].threaded) {
+            json_parallel_thread_join(&threads[i]);
+        }
+    }
+    for (i = 0; i < thread_count; i++) {
+        if (slices[i].status != JSONSuccess) {
+            failed = PARSON_TRUE;
+        }
+    }
+    if (failed) {
+        goto error; /* failed slices freed their own values already */
+    }
+    array->count = count;
+    if (parser->pack_number_arrays) {
+        json_array_pack_numbers(parser, array); /* best effort, as at sequential container close */
+    }
+    parson_free(parser, slices);
+    parson_free(parser, threads);
+    parson_free(parser, offsets);
+    return root;
+
+error:
+    if (array != NULL && array->items != NULL) {
+        for (i = 0; i < count; i++) {
+            if (array->items[i] != NULL) {
+                array->items[i]->parent = NULL;
+                json_value_free(parser, array->items[i]);
+            }
+        }
+    }
+    json_value_free(parser, root);
+    parson_free(parser, slices);
+    parson_free(parser, threads);
+    parson_free(parser, offsets);
+    return NULL;
+}
+
+#endif /* PARSON_ENABLE_PARALLEL */
+
 JSON_Value * json_parse_file(JSON_Parser const * parser, const char *filename) {
+    char *file_contents = NULL;
+    JSON_Value *output_value = NULL;
+#if defined(PARSON_MMAP_POSIX) || defined(PARSON_MMAP_WIN32)
+    size_t file_size = 0;
+    file_contents = map_file(filename, &file_size);
+    if (file_contents != NULL) {
+        output_value = json_parse_string(parser, file_contents);
+        unmap_file(file_contents, file_size);
+        return output_value;
+    }
+    /* fall through to the stdio path, mapping can fail for reasons other than
+       a missing file (empty file, page-aligned size, exotic fs) */
+#endif
+    file_contents = read_file(parser, filename);
+    if (file_contents == NULL) {
+        return NULL;
+    }
+    output_value = json_parse_string(parser, file_contents);
+    parson_free(parser, file_contents);
+    return output_value;
+}
+
+JSON_Value * json_parse_file_mmap(JSON_Parser const * parser, const char *filename) {
+#if defined(PARSON_MMAP_POSIX) || defined(PARSON_MMAP_WIN32)
+    size_t file_size = 0;
+    char *file_contents = map_file(filename, &file_size);
+    JSON_Value *output_value = NULL;
+    if (file_contents == NULL) {
+        return NULL;
+    }
+    output_value = json_parse_string(parser, file_contents);
+    unmap_file(file_contents, file_size);
+    return output_value;
+#else
     char *file_contents = read_file(parser, filename);
     JSON_Value *output_value = NULL;
     if (file_contents == NULL) {
         return NULL;
     }
     output_value = json_parse_string(parser, file_contents);
-    parser->free_func(file_contents, parser->malloc_userdata);
+    parson_free(parser, file_contents);
     return output_value;
+#endif
 }
 
 JSON_Value * json_parse_file_with_comments(JSON_Parser const * parser, const char *filename) {
@@ -1361,33 +3831,47 @@ JSON_Value * json_parse_file_with_comments(JSON_Parser const * parser, const cha
         return NULL;
     }
     output_value = json_parse_string_with_comments(parser, file_contents);
-    parser->free_func(file_contents, parser->malloc_userdata);
+    parson_free(parser, file_contents);
     return output_value;
 }
 
-JSON_Value * json_parse_string(JSON_Parser const * parser, const char *string) {
-    if (string == NULL) {
+JSON_Value * json_parse_string(JSON_Parser const * parser, const char *string) {
+    if (string == NULL) {
+        return NULL;
+    }
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+#ifdef PARSON_ENABLE_PARALLEL
+    if (parser->parse_thread_count > 1) {
+        parson_bool_t attempted = PARSON_FALSE;
+        JSON_Value *result = json_parse_string_parallel(parser, string, &attempted);
+        if (attempted) {
+            return result;
+        }
+    }
+#endif
+    return parse_value(parser, (const char**)&string, PARSON_FALSE);
+}
+
+JSON_Value * json_parse_string_inplace(JSON_Parser const * parser, char *buffer) {
+    if (buffer == NULL) {
         return NULL;
     }
-    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
-        string = string + 3; /* Support for UTF-8 BOM */
+    if (buffer[0] == '\xEF' && buffer[1] == '\xBB' && buffer[2] == '\xBF') {
+        buffer = buffer + 3; /* Support for UTF-8 BOM */
     }
-    return parse_value(parser, (const char**)&string, 0);
+    return parse_value(parser, (const char**)&buffer, PARSON_TRUE);
 }
 
 JSON_Value * json_parse_string_with_comments(JSON_Parser const * parser, const char *string) {
-    JSON_Value *result = NULL;
-    char *string_mutable_copy = NULL, *string_mutable_copy_ptr = NULL;
-    string_mutable_copy = parson_strdup(parser, string);
-    if (string_mutable_copy == NULL) {
+    JSON_Parser comment_parser;
+    if (parser == NULL) {
         return NULL;
     }
-    remove_comments(string_mutable_copy, "/*", "*/");
-    remove_comments(string_mutable_copy, "//", "\n");
-    string_mutable_copy_ptr = string_mutable_copy;
-    result = parse_value(parser, (const char**)&string_mutable_copy_ptr, 0);
-    parser->free_func(string_mutable_copy, parser->malloc_userdata);
-    return result;
+    comment_parser = *parser;
+    comment_parser.allow_comments = 1;
+    return json_parse_string(&comment_parser, string);
 }
 
 /* JSON Object API */
@@ -1452,482 +3936,1830 @@ JSON_Array * json_object_dotget_array(const JSON_Object *object, const char *nam
     return json_value_get_array(json_object_dotget_value(object, name));
 }
 
-int json_object_dotget_boolean(const JSON_Object *object, const char *name) {
-    return json_value_get_boolean(json_object_dotget_value(object, name));
+int json_object_dotget_boolean(const JSON_Object *object, const char *name) {
+    return json_value_get_boolean(json_object_dotget_value(object, name));
+}
+
+/* JSON Path */
+
+typedef struct json_path_segment {
+    const char   *key;     /* NULL for an array index step */
+    size_t        key_len;
+    unsigned long hash;    /* precomputed key hash */
+    size_t        index;
+} JSON_Path_Segment;
+
+struct json_path {
+    JSON_Parser parser;    /* allocator for path memory, captured at compile */
+    JSON_Path_Segment *segments;
+    size_t count;
+};
+
+JSON_Path * json_path_compile(JSON_Parser const * parser, const char *dotpath) {
+    JSON_Path *path = NULL;
+    JSON_Path_Segment *segments = NULL;
+    char *key_buf = NULL;
+    const char *p = NULL;
+    size_t segment_count = 0;
+    size_t key_bytes = 0;
+    size_t seg_ix = 0;
+    int pass = 0;
+
+    if (parser == NULL || dotpath == NULL || *dotpath == '\0') {
+        return NULL;
+    }
+    /* first pass validates the path and counts segments, second pass fills
+       the single block allocated between the passes */
+    for (pass = 0; pass < 2; pass++) {
+        p = dotpath;
+        seg_ix = 0;
+        while (*p) {
+            if (*p == '[') {
+                size_t index = 0;
+                p++;
+                if (*p < '0' || *p > '9') {
+                    goto error;
+                }
+                while (*p >= '0' && *p <= '9') {
+                    index = index * 10 + (size_t)(*p - '0');
+                    p++;
+                }
+                if (*p != ']') {
+                    goto error;
+                }
+                p++;
+                if (pass == 1) {
+                    segments[seg_ix].key = NULL;
+                    segments[seg_ix].key_len = 0;
+                    segments[seg_ix].hash = 0;
+                    segments[seg_ix].index = index;
+                }
+                seg_ix++;
+            } else {
+                const char *key_start = p;
+                size_t key_len = 0;
+                while (*p && *p != '.' && *p != '[') {
+                    p++;
+                }
+                key_len = (size_t)(p - key_start);
+                if (key_len == 0) {
+                    goto error;
+                }
+                if (pass == 0) {
+                    key_bytes += key_len + 1;
+                } else {
+                    memcpy(key_buf, key_start, key_len);
+                    key_buf[key_len] = '\0';
+                    segments[seg_ix].key = key_buf;
+                    segments[seg_ix].key_len = key_len;
+                    segments[seg_ix].hash = hash_string(key_buf, key_len);
+                    segments[seg_ix].index = 0;
+                    key_buf += key_len + 1;
+                }
+                seg_ix++;
+            }
+            if (*p == '.') {
+                p++;
+                if (*p == '\0' || *p == '.' || *p == '[') {
+                    goto error; /* a dot must introduce a key */
+                }
+            }
+        }
+        if (pass == 0) {
+            segment_count = seg_ix;
+            path = (JSON_Path*)parson_malloc(parser, sizeof(JSON_Path)
+                + segment_count * sizeof(JSON_Path_Segment) + key_bytes);
+            if (path == NULL) {
+                return NULL;
+            }
+            segments = (JSON_Path_Segment*)(path + 1);
+            key_buf = (char*)(segments + segment_count);
+        }
+    }
+    path->parser = *parser;
+    path->segments = segments;
+    path->count = segment_count;
+    return path;
+error:
+    if (path != NULL) {
+        parson_free(parser, path);
+    }
+    return NULL;
+}
+
+void json_path_free(JSON_Path *path) {
+    if (path == NULL) {
+        return;
+    }
+    parson_free(&path->parser, path);
+}
+
+JSON_Value * json_path_get_value(const JSON_Path *path, const JSON_Object *object) {
+    JSON_Value *value = NULL;
+    size_t i = 0;
+    if (path == NULL || object == NULL || path->count == 0) {
+        return NULL;
+    }
+    for (i = 0; i < path->count; i++) {
+        const JSON_Path_Segment *segment = &path->segments[i];
+        if (i > 0) {
+            object = json_value_get_object(value); /* NULL unless value is an object */
+        }
+        if (segment->key != NULL) {
+            value = json_object_getn_value_with_hash(object, segment->key, segment->key_len, segment->hash);
+        } else {
+            value = json_array_get_value(json_value_get_array(value), segment->index);
+        }
+        if (value == NULL) {
+            return NULL;
+        }
+    }
+    return value;
+}
+
+size_t json_object_get_count(const JSON_Object *object) {
+    return object ? object->count : 0;
+}
+
+const char * json_object_get_name(const JSON_Object *object, size_t index) {
+    if (object == NULL || index >= json_object_get_count(object)) {
+        return NULL;
+    }
+    return object->names[index];
+}
+
+JSON_Value * json_object_get_value_at(const JSON_Object *object, size_t index) {
+    if (object == NULL || index >= json_object_get_count(object)) {
+        return NULL;
+    }
+    return object->values[index];
+}
+
+JSON_Value *json_object_get_wrapping_value(const JSON_Object *object) {
+    if (!object) {
+        return NULL;
+    }
+    return object->wrapping_value;
+}
+
+int json_object_has_value (const JSON_Object *object, const char *name) {
+    return json_object_get_value(object, name) != NULL;
+}
+
+int json_object_has_value_of_type(const JSON_Object *object, const char *name, JSON_Value_Type type) {
+    JSON_Value *val = json_object_get_value(object, name);
+    return val != NULL && json_value_get_type(val) == type;
+}
+
+int json_object_dothas_value (const JSON_Object *object, const char *name) {
+    return json_object_dotget_value(object, name) != NULL;
+}
+
+int json_object_dothas_value_of_type(const JSON_Object *object, const char *name, JSON_Value_Type type) {
+    JSON_Value *val = json_object_dotget_value(object, name);
+    return val != NULL && json_value_get_type(val) == type;
+}
+
+/* JSON Array API */
+JSON_Value * json_array_get_value(const JSON_Array *array, size_t index) {
+    if (array == NULL || array->numbers != NULL || index >= json_array_get_count(array)) {
+        return NULL; /* packed arrays have no per-element values */
+    }
+    return array->items[index];
+}
+
+const char * json_array_get_string(const JSON_Array *array, size_t index) {
+    return json_value_get_string(json_array_get_value(array, index));
+}
+
+size_t json_array_get_string_len(const JSON_Array *array, size_t index) {
+    return json_value_get_string_len(json_array_get_value(array, index));
+}
+
+double json_array_get_number(const JSON_Array *array, size_t index) {
+    if (array != NULL && array->numbers != NULL) {
+        return index < array->count ? array->numbers[index] : 0;
+    }
+    return json_value_get_number(json_array_get_value(array, index));
+}
+
+JSON_Object * json_array_get_object(const JSON_Array *array, size_t index) {
+    return json_value_get_object(json_array_get_value(array, index));
+}
+
+JSON_Array * json_array_get_array(const JSON_Array *array, size_t index) {
+    return json_value_get_array(json_array_get_value(array, index));
+}
+
+int json_array_get_boolean(const JSON_Array *array, size_t index) {
+    return json_value_get_boolean(json_array_get_value(array, index));
+}
+
+size_t json_array_get_count(const JSON_Array *array) {
+    return array ? array->count : 0;
+}
+
+JSON_Value * json_array_get_wrapping_value(const JSON_Array *array) {
+    if (!array) {
+        return NULL;
+    }
+    return array->wrapping_value;
+}
+
+/* JSON Value API */
+JSON_Value_Type json_value_get_type(const JSON_Value *value) {
+    return value ? value->type : JSONError;
+}
+
+JSON_Object * json_value_get_object(const JSON_Value *value) {
+    return json_value_get_type(value) == JSONObject ? value->value.object : NULL;
+}
+
+JSON_Array * json_value_get_array(const JSON_Value *value) {
+    return json_value_get_type(value) == JSONArray ? value->value.array : NULL;
+}
+
+static const JSON_String * json_value_get_string_desc(const JSON_Value *value) {
+    return json_value_get_type(value) == JSONString ? &value->value.string : NULL;
+}
+
+const char * json_value_get_string(const JSON_Value *value) {
+    const JSON_String *str = json_value_get_string_desc(value);
+    return str ? str->chars : NULL;
+}
+
+size_t json_value_get_string_len(const JSON_Value *value) {
+    const JSON_String *str = json_value_get_string_desc(value);
+    return str ? str->length : 0;
+}
+
+double json_value_get_number(const JSON_Value *value) {
+    return json_value_get_type(value) == JSONNumber ? value->value.number : 0;
+}
+
+int json_value_get_boolean(const JSON_Value *value) {
+    return json_value_get_type(value) == JSONBoolean ? value->value.boolean : -1;
+}
+
+JSON_Value * json_value_get_parent (const JSON_Value *value) {
+    return value ? value->parent : NULL;
+}
+
+/* Teardown is iterative: children are queued on a heap-allocated work list
+   instead of being freed through recursion, so arbitrarily deep trees don't
+   risk stack overflow. If growing the work list fails, the offending child is
+   freed through a re-entrant call, which degrades gracefully towards the old
+   recursive behavior under memory pressure. */
+void json_value_free(JSON_Parser const * parser, JSON_Value *value) {
+    JSON_Value **work = NULL;
+    size_t work_count = 0;
+    size_t work_capacity = 0;
+    JSON_Value *current = value;
+    while (current != NULL) {
+        size_t i = 0, child_count = 0;
+        JSON_Value **children = NULL;
+        switch (json_value_get_type(current)) {
+            case JSONObject:
+                child_count = current->value.object->count;
+                children = current->value.object->values;
+                break;
+            case JSONArray:
+                if (current->value.array->numbers == NULL) {
+                    child_count = current->value.array->count;
+                    children = current->value.array->items;
+                }
+                break;
+            case JSONString:
+                if (current->value.string.owned) {
+                    parson_free(parser, current->value.string.chars);
+                }
+                break;
+            default:
+                break;
+        }
+        for (i = 0; i < child_count; i++) {
+            if (work_count >= work_capacity) {
+                size_t new_capacity = work_capacity ? work_capacity * 2 : STARTING_CAPACITY;
+                JSON_Value **new_work = (JSON_Value**)parson_malloc(parser, new_capacity * sizeof(JSON_Value*));
+                if (new_work == NULL) {
+                    json_value_free(parser, children[i]); /* can't queue it - free it now */
+                    continue;
+                }
+                if (work_count > 0) {
+                    memcpy(new_work, work, work_count * sizeof(JSON_Value*));
+                }
+                parson_free(parser, work);
+                work = new_work;
+                work_capacity = new_capacity;
+            }
+            work[work_count++] = children[i];
+        }
+        switch (json_value_get_type(current)) {
+            case JSONObject:
+                json_object_deinit(parser, current->value.object, PARSON_TRUE, PARSON_FALSE);
+                parson_free(parser, current->value.object);
+                break;
+            case JSONArray:
+                parson_free(parser, current->value.array->items);
+                parson_free(parser, current->value.array->numbers);
+                parson_free(parser, current->value.array);
+                break;
+            default:
+                break;
+        }
+        parson_free(parser, current);
+        current = work_count > 0 ? work[--work_count] : NULL;
+    }
+    parson_free(parser, work);
+}
+
+JSON_Status json_value_freeze(JSON_Parser const * parser, JSON_Value *value) {
+    JSON_Value **work = NULL;
+    size_t work_count = 0;
+    size_t work_capacity = 0;
+    JSON_Value *current = value;
+    JSON_Status res = JSONSuccess;
+    if (value == NULL) {
+        return JSONFailure;
+    }
+    while (current != NULL) {
+        size_t i = 0, child_count = 0;
+        JSON_Value **children = NULL;
+        switch (json_value_get_type(current)) {
+            case JSONObject: {
+                JSON_Object *object = current->value.object;
+                if (json_object_pack(parser, object) != JSONSuccess) {
+                    res = JSONFailure; /* object keeps its spare capacity but is still frozen */
+                }
+                object->frozen = PARSON_TRUE;
+                child_count = object->count;
+                children = object->values;
+                break;
+            }
+            case JSONArray: {
+                JSON_Array *array = current->value.array;
+                if (array->numbers != NULL) {
+                    array->frozen = PARSON_TRUE; /* packed arrays are already trimmed and have no child values */
+                    break;
+                }
+                if (array->count > 0 && array->capacity > array->count) {
+                    if (json_array_resize(parser, array, array->count) != JSONSuccess) {
+                        res = JSONFailure;
+                    }
+                } else if (array->count == 0 && array->items != NULL) {
+                    parson_free(parser, array->items);
+                    array->items = NULL;
+                    array->capacity = 0;
+                }
+                array->frozen = PARSON_TRUE;
+                child_count = array->count;
+                children = array->items;
+                break;
+            }
+            default:
+                break;
+        }
+        for (i = 0; i < child_count; i++) {
+            if (work_count >= work_capacity) {
+                size_t new_capacity = work_capacity ? work_capacity * 2 : STARTING_CAPACITY;
+                JSON_Value **new_work = (JSON_Value**)parson_malloc(parser, new_capacity * sizeof(JSON_Value*));
+                if (new_work == NULL) {
+                    if (json_value_freeze(parser, children[i]) != JSONSuccess) { /* can't queue it - recurse */
+                        res = JSONFailure;
+                    }
+                    continue;
+                }
+                if (work_count > 0) {
+                    memcpy(new_work, work, work_count * sizeof(JSON_Value*));
+                }
+                parson_free(parser, work);
+                work = new_work;
+                work_capacity = new_capacity;
+            }
+            work[work_count++] = children[i];
+        }
+        current = work_count > 0 ? work[--work_count] : NULL;
+    }
+    parson_free(parser, work);
+    return res;
+}
+
+JSON_Status json_value_ref(JSON_Value *value) {
+    if (value == NULL || value->parent != NULL) {
+        return JSONFailure;
+    }
+    parson_atomic_add(&value->ref_count, 1);
+    return JSONSuccess;
+}
+
+JSON_Status json_value_unref(JSON_Parser const * parser, JSON_Value *value) {
+    if (value == NULL || value->parent != NULL) {
+        return JSONFailure;
+    }
+    /* the owner that decrements past zero is the last one standing and frees;
+       the count briefly reads -1, which only that owner can observe */
+    if (parson_atomic_add(&value->ref_count, -1) < 0) {
+        json_value_free(parser, value);
+    }
+    return JSONSuccess;
+}
+
+JSON_Value * json_value_init_object(JSON_Parser const * parser) {
+    JSON_Value *new_value = (JSON_Value*)parson_malloc(parser, sizeof(JSON_Value));
+    if (!new_value) {
+        return NULL;
+    }
+    new_value->parent = NULL;
+    new_value->ref_count = 0;
+    new_value->type = JSONObject;
+    new_value->value.object = json_object_make(parser, new_value);
+    if (!new_value->value.object) {
+        parson_free(parser, new_value);
+        return NULL;
+    }
+    return new_value;
+}
+
+JSON_Value * json_value_init_array(JSON_Parser const * parser) {
+    JSON_Value *new_value = (JSON_Value*)parson_malloc(parser, sizeof(JSON_Value));
+    if (!new_value) {
+        return NULL;
+    }
+    new_value->parent = NULL;
+    new_value->ref_count = 0;
+    new_value->type = JSONArray;
+    new_value->value.array = json_array_make(parser, new_value);
+    if (!new_value->value.array) {
+        parson_free(parser, new_value);
+        return NULL;
+    }
+    return new_value;
+}
+
+JSON_Value * json_value_init_string(JSON_Parser const * parser, const char *string) {
+    if (string == NULL) {
+        return NULL;
+    }
+    return json_value_init_string_with_len(parser, string, strlen(string));
 }
 
-size_t json_object_get_count(const JSON_Object *object) {
-    return object ? object->count : 0;
+JSON_Value * json_value_init_string_with_len(JSON_Parser const * parser, const char *string, size_t length) {
+    char *copy = NULL;
+    JSON_Value *value;
+    if (string == NULL) {
+        return NULL;
+    }
+    if (!parser->skip_utf8_validation && !is_valid_utf8(string, length)) {
+        return NULL;
+    }
+    copy = parson_strndup(parser, string, length);
+    if (copy == NULL) {
+        return NULL;
+    }
+    value = json_value_init_string_no_copy(parser, copy, length, PARSON_TRUE);
+    if (value == NULL) {
+        parson_free(parser, copy);
+    }
+    return value;
 }
 
-const char * json_object_get_name(const JSON_Object *object, size_t index) {
-    if (object == NULL || index >= json_object_get_count(object)) {
+JSON_Value * json_value_init_number(JSON_Parser const * parser, double number) {
+    JSON_Value *new_value = NULL;
+    if (IS_NUMBER_INVALID(number)) {
         return NULL;
     }
-    return object->names[index];
+    new_value = (JSON_Value*)parson_malloc(parser, sizeof(JSON_Value));
+    if (new_value == NULL) {
+        return NULL;
+    }
+    new_value->parent = NULL;
+    new_value->ref_count = 0;
+    new_value->type = JSONNumber;
+    new_value->value.number = number;
+    return new_value;
 }
 
-JSON_Value * json_object_get_value_at(const JSON_Object *object, size_t index) {
-    if (object == NULL || index >= json_object_get_count(object)) {
+JSON_Value * json_value_init_boolean(JSON_Parser const * parser, int boolean) {
+    JSON_Value *new_value = (JSON_Value*)parson_malloc(parser, sizeof(JSON_Value));
+    if (!new_value) {
         return NULL;
     }
-    return object->values[index];
+    new_value->parent = NULL;
+    new_value->ref_count = 0;
+    new_value->type = JSONBoolean;
+    new_value->value.boolean = boolean ? 1 : 0;
+    return new_value;
 }
 
-JSON_Value *json_object_get_wrapping_value(const JSON_Object *object) {
-    if (!object) {
+JSON_Value * json_value_init_null(JSON_Parser const * parser) {
+    JSON_Value *new_value = (JSON_Value*)parson_malloc(parser, sizeof(JSON_Value));
+    if (!new_value) {
         return NULL;
     }
-    return object->wrapping_value;
+    new_value->parent = NULL;
+    new_value->ref_count = 0;
+    new_value->type = JSONNull;
+    return new_value;
 }
 
-int json_object_has_value (const JSON_Object *object, const char *name) {
-    return json_object_get_value(object, name) != NULL;
+static JSON_Value * json_value_copy_scalar(JSON_Parser const * parser, const JSON_Value *value) {
+    JSON_Value *return_value = NULL;
+    const JSON_String *temp_string = NULL;
+    char *temp_string_copy = NULL;
+    switch (json_value_get_type(value)) {
+        case JSONBoolean:
+            return json_value_init_boolean(parser, json_value_get_boolean(value));
+        case JSONNumber:
+            return json_value_init_number(parser, json_value_get_number(value));
+        case JSONString:
+            temp_string = json_value_get_string_desc(value);
+            if (temp_string == NULL) {
+                return NULL;
+            }
+            temp_string_copy = parson_strndup(parser, temp_string->chars, temp_string->length);
+            if (temp_string_copy == NULL) {
+                return NULL;
+            }
+            return_value = json_value_init_string_no_copy(parser, temp_string_copy, temp_string->length, PARSON_TRUE);
+            if (return_value == NULL) {
+                parson_free(parser, temp_string_copy);
+            }
+            return return_value;
+        case JSONNull:
+            return json_value_init_null(parser);
+        default: /* containers are handled by json_value_deep_copy's work stack */
+            return NULL;
+    }
 }
 
-int json_object_has_value_of_type(const JSON_Object *object, const char *name, JSON_Value_Type type) {
-    JSON_Value *val = json_object_get_value(object, name);
-    return val != NULL && json_value_get_type(val) == type;
+/* Copying walks the source iteratively with an explicit frame stack (one frame
+   per open container, resumed at the next child index), so deep trees don't
+   recurse. Copies are attached to their parent as they are created - on
+   failure only the root of the copy has to be freed. */
+typedef struct json_copy_frame {
+    const JSON_Value *src;
+    JSON_Value *dst;
+    size_t index;
+} JSON_Copy_Frame;
+
+static JSON_Status json_copy_stack_push(JSON_Parser const * parser, JSON_Copy_Frame **stack, size_t *count, size_t *capacity, const JSON_Value *src, JSON_Value *dst) {
+    if (*count >= *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : STARTING_CAPACITY;
+        JSON_Copy_Frame *new_stack = (JSON_Copy_Frame*)parson_malloc(parser, new_capacity * sizeof(JSON_Copy_Frame));
+        if (new_stack == NULL) {
+            return JSONFailure;
+        }
+        if (*count > 0) {
+            memcpy(new_stack, *stack, *count * sizeof(JSON_Copy_Frame));
+        }
+        parson_free(parser, *stack);
+        *stack = new_stack;
+        *capacity = new_capacity;
+    }
+    (*stack)[*count].src = src;
+    (*stack)[*count].dst = dst;
+    (*stack)[*count].index = 0;
+    (*count)++;
+    return JSONSuccess;
 }
 
-int json_object_dothas_value (const JSON_Object *object, const char *name) {
-    return json_object_dotget_value(object, name) != NULL;
+/* Right-sizes a freshly created container copy so filling it with the source's
+   children triggers no growth reallocation; used by the bulk deep copy. */
+static JSON_Status json_value_presize_for_copy(JSON_Parser const * parser, JSON_Value *dst, const JSON_Value *src) {
+    if (json_value_get_type(src) == JSONArray) {
+        size_t count = json_array_get_count(json_value_get_array(src));
+        if (count == 0 || json_value_get_array(src)->numbers != NULL) {
+            return JSONSuccess; /* the packed copy allocates its column exactly */
+        }
+        return json_array_resize(parser, json_value_get_array(dst), count);
+    } else {
+        size_t count = json_object_get_count(json_value_get_object(src));
+        size_t capacity = STARTING_CAPACITY;
+        if (count == 0) {
+            return JSONSuccess;
+        }
+        while (count > json_object_max_items(parser, capacity)) {
+            capacity *= 2;
+        }
+        return json_object_init(parser, json_value_get_object(dst), capacity);
+    }
 }
 
-int json_object_dothas_value_of_type(const JSON_Object *object, const char *name, JSON_Value_Type type) {
-    JSON_Value *val = json_object_dotget_value(object, name);
-    return val != NULL && json_value_get_type(val) == type;
+/* Clones a packed number column (see json_array_pack_numbers). */
+static JSON_Status json_array_copy_packed(JSON_Parser const * parser, JSON_Array *dst, const JSON_Array *src) {
+    double *numbers = (double*)parson_malloc(parser, src->count * sizeof(double));
+    if (numbers == NULL) {
+        return JSONFailure;
+    }
+    memcpy(numbers, src->numbers, src->count * sizeof(double));
+    dst->numbers = numbers;
+    dst->count = src->count;
+    dst->capacity = src->count;
+    return JSONSuccess;
 }
 
-/* JSON Array API */
-JSON_Value * json_array_get_value(const JSON_Array *array, size_t index) {
-    if (array == NULL || index >= json_array_get_count(array)) {
+/* 'scratch_parser' only allocates the temporary frame stack, so a bulk copy
+   into an arena does not leak its scratch space into the arena. */
+static JSON_Value * json_value_deep_copy_internal(JSON_Parser const * parser, JSON_Parser const * scratch_parser, const JSON_Value *value, parson_bool_t presize) {
+    JSON_Copy_Frame *stack = NULL;
+    size_t stack_count = 0;
+    size_t stack_capacity = 0;
+    JSON_Value *root_copy = NULL;
+    JSON_Value_Type type = json_value_get_type(value);
+
+    if (type != JSONArray && type != JSONObject) {
+        return json_value_copy_scalar(parser, value);
+    }
+    root_copy = (type == JSONArray) ? json_value_init_array(parser) : json_value_init_object(parser);
+    if (root_copy == NULL) {
         return NULL;
     }
-    return array->items[index];
+    if (presize && json_value_presize_for_copy(parser, root_copy, value) != JSONSuccess) {
+        json_value_free(parser, root_copy);
+        return NULL;
+    }
+    if (type == JSONArray && value->value.array->numbers != NULL) {
+        if (json_array_copy_packed(parser, root_copy->value.array, value->value.array) != JSONSuccess) {
+            json_value_free(parser, root_copy);
+            return NULL;
+        }
+        return root_copy;
+    }
+    if (json_copy_stack_push(scratch_parser, &stack, &stack_count, &stack_capacity, value, root_copy) != JSONSuccess) {
+        json_value_free(parser, root_copy);
+        return NULL;
+    }
+    while (stack_count > 0) {
+        JSON_Copy_Frame *top = &stack[stack_count - 1];
+        const JSON_Value *src_child = NULL;
+        JSON_Value *dst_child = NULL;
+        const char *temp_key = NULL;
+        char *key_copy = NULL;
+        JSON_Value_Type child_type;
+        parson_bool_t child_packed = PARSON_FALSE;
+        parson_bool_t src_is_array = (json_value_get_type(top->src) == JSONArray);
+
+        if (src_is_array) {
+            JSON_Array *src_array = json_value_get_array(top->src);
+            if (top->index >= json_array_get_count(src_array)) {
+                stack_count--;
+                continue;
+            }
+            src_child = json_array_get_value(src_array, top->index);
+        } else {
+            JSON_Object *src_object = json_value_get_object(top->src);
+            if (top->index >= json_object_get_count(src_object)) {
+                stack_count--;
+                continue;
+            }
+            temp_key = json_object_get_name(src_object, top->index);
+            src_child = json_object_get_value_at(src_object, top->index);
+        }
+        top->index++;
+
+        child_type = json_value_get_type(src_child);
+        if (child_type == JSONArray && src_child->value.array->numbers != NULL) {
+            child_packed = PARSON_TRUE;
+            dst_child = json_value_init_array(parser);
+            if (dst_child != NULL && json_array_copy_packed(parser, dst_child->value.array, src_child->value.array) != JSONSuccess) {
+                json_value_free(parser, dst_child);
+                dst_child = NULL;
+            }
+        } else if (child_type == JSONArray || child_type == JSONObject) {
+            dst_child = (child_type == JSONArray) ? json_value_init_array(parser) : json_value_init_object(parser);
+            if (dst_child != NULL && presize && json_value_presize_for_copy(parser, dst_child, src_child) != JSONSuccess) {
+                json_value_free(parser, dst_child);
+                dst_child = NULL;
+            }
+        } else {
+            dst_child = json_value_copy_scalar(parser, src_child);
+        }
+        if (dst_child == NULL) {
+            goto error;
+        }
+        if (src_is_array) {
+            if (json_array_add(parser, json_value_get_array(top->dst), dst_child) != JSONSuccess) {
+                json_value_free(parser, dst_child);
+                goto error;
+            }
+        } else {
+            unsigned long key_hash = hash_string(temp_key, strlen(temp_key));
+            key_copy = json_object_key_copy(parser, temp_key, strlen(temp_key), key_hash);
+            if (key_copy == NULL) {
+                json_value_free(parser, dst_child);
+                goto error;
+            }
+            if (json_object_add_with_hash(parser, json_value_get_object(top->dst), key_copy, key_hash, dst_child) != JSONSuccess) {
+                if (parser->intern_pool == NULL) {
+                    parson_free(parser, key_copy);
+                }
+                json_value_free(parser, dst_child);
+                goto error;
+            }
+        }
+        if (!child_packed && (child_type == JSONArray || child_type == JSONObject)) {
+            /* dst_child is already reachable from root_copy, so a failed push
+               only needs the generic cleanup */
+            if (json_copy_stack_push(scratch_parser, &stack, &stack_count, &stack_capacity, src_child, dst_child) != JSONSuccess) {
+                goto error;
+            }
+        }
+    }
+    parson_free(scratch_parser, stack);
+    return root_copy;
+error:
+    parson_free(scratch_parser, stack);
+    json_value_free(parser, root_copy);
+    return NULL;
 }
 
-const char * json_array_get_string(const JSON_Array *array, size_t index) {
-    return json_value_get_string(json_array_get_value(array, index));
+JSON_Value * json_value_deep_copy(JSON_Parser const * parser, const JSON_Value *value) {
+    return json_value_deep_copy_internal(parser, parser, value, PARSON_FALSE);
+}
+
+/* Walks the source and sums the arena bytes its copy will take: one node per
+   value, right-sized container arrays, string and key bytes - all rounded up
+   the way arena_malloc rounds them. */
+static JSON_Status json_value_measure_copy(JSON_Parser const * parser, const JSON_Value *value, size_t *out_bytes) {
+    JSON_Value **work = NULL;
+    size_t work_count = 0;
+    size_t work_capacity = 0;
+    const JSON_Value *current = value;
+    size_t bytes = 0;
+    while (current != NULL) {
+        size_t i = 0, child_count = 0;
+        JSON_Value **children = NULL;
+        bytes += PARSON_ARENA_ALIGN_UP(sizeof(JSON_Value));
+        switch (json_value_get_type(current)) {
+            case JSONString:
+                bytes += PARSON_ARENA_ALIGN_UP(current->value.string.length + 1);
+                break;
+            case JSONObject: {
+                const JSON_Object *object = current->value.object;
+                bytes += PARSON_ARENA_ALIGN_UP(sizeof(JSON_Object));
+                if (object->count > 0) {
+                    size_t capacity = STARTING_CAPACITY;
+                    size_t item_capacity = 0;
+                    while (object->count > json_object_max_items(parser, capacity)) {
+                        capacity *= 2;
+                    }
+                    item_capacity = json_object_max_items(parser, capacity);
+                    bytes += PARSON_ARENA_ALIGN_UP(capacity * sizeof(JSON_Object_Cell));
+                    bytes += PARSON_ARENA_ALIGN_UP(item_capacity * sizeof(char*));
+                    bytes += PARSON_ARENA_ALIGN_UP(item_capacity * sizeof(JSON_Value*));
+                    bytes += PARSON_ARENA_ALIGN_UP(item_capacity * sizeof(size_t));
+                    bytes += PARSON_ARENA_ALIGN_UP(item_capacity * sizeof(unsigned long));
+                    for (i = 0; i < object->count; i++) {
+                        bytes += PARSON_ARENA_ALIGN_UP(strlen(object->names[i]) + 1);
+                    }
+                }
+                child_count = object->count;
+                children = object->values;
+                break;
+            }
+            case JSONArray: {
+                const JSON_Array *array = current->value.array;
+                bytes += PARSON_ARENA_ALIGN_UP(sizeof(JSON_Array));
+                if (array->numbers != NULL) {
+                    bytes += PARSON_ARENA_ALIGN_UP(array->count * sizeof(double));
+                    break; /* a packed array has no child values */
+                }
+                if (array->count > 0) {
+                    bytes += PARSON_ARENA_ALIGN_UP(array->count * sizeof(JSON_Value*));
+                }
+                child_count = array->count;
+                children = array->items;
+                break;
+            }
+            default:
+                break;
+        }
+        for (i = 0; i < child_count; i++) {
+            if (work_count >= work_capacity) {
+                size_t new_capacity = work_capacity ? work_capacity * 2 : STARTING_CAPACITY;
+                JSON_Value **new_work = (JSON_Value**)parson_malloc(parser, new_capacity * sizeof(JSON_Value*));
+                if (new_work == NULL) {
+                    parson_free(parser, work);
+                    return JSONFailure;
+                }
+                if (work_count > 0) {
+                    memcpy(new_work, work, work_count * sizeof(JSON_Value*));
+                }
+                parson_free(parser, work);
+                work = new_work;
+                work_capacity = new_capacity;
+            }
+            work[work_count++] = children[i];
+        }
+        current = work_count > 0 ? work[--work_count] : NULL;
+    }
+    parson_free(parser, work);
+    *out_bytes = bytes;
+    return JSONSuccess;
 }
 
-size_t json_array_get_string_len(const JSON_Array *array, size_t index) {
-    return json_value_get_string_len(json_array_get_value(array, index));
+JSON_Value * json_value_deep_copy_bulk(JSON_Arena *arena, const JSON_Value *value) {
+    JSON_Parser arena_parser;
+    size_t bytes = 0;
+    if (arena == NULL || value == NULL) {
+        return NULL;
+    }
+    if (json_value_measure_copy(&arena->base, value, &bytes) != JSONSuccess
+        || json_arena_reserve(arena, bytes) != JSONSuccess) {
+        return NULL;
+    }
+    arena_parser = json_get_arena_parser(arena);
+    return json_value_deep_copy_internal(&arena_parser, &arena->base, value, PARSON_TRUE);
 }
 
-double json_array_get_number(const JSON_Array *array, size_t index) {
-    return json_value_get_number(json_array_get_value(array, index));
+static size_t json_serialization_size_internal(JSON_Parser const * parser, const JSON_Value *value, parson_bool_t is_pretty) {
+    char num_buf[PARSON_NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
+    JSON_Writer writer;
+    writer.parser = parser;
+    writer.buf = NULL; /* counting only */
+    writer.pos = 0;
+    writer.capacity = 0;
+    writer.growable = PARSON_FALSE;
+    writer.failed = PARSON_FALSE;
+    writer.write_func = NULL;
+    writer.write_userdata = NULL;
+    if (json_serialize_to_buffer_r(parser, value, &writer, 0, is_pretty, num_buf) != JSONSuccess) {
+        return 0;
+    }
+    return writer.pos + 1;
 }
 
-JSON_Object * json_array_get_object(const JSON_Array *array, size_t index) {
-    return json_value_get_object(json_array_get_value(array, index));
+static JSON_Status json_serialize_to_fixed_buffer(JSON_Parser const * parser, const JSON_Value *value, char *buf, parson_bool_t is_pretty) {
+    JSON_Writer writer;
+    writer.parser = parser;
+    writer.buf = buf;
+    writer.pos = 0;
+    writer.capacity = 0; /* the caller sized the buffer via json_serialization_size */
+    writer.growable = PARSON_FALSE;
+    writer.failed = PARSON_FALSE;
+    writer.write_func = NULL;
+    writer.write_userdata = NULL;
+    if (json_serialize_to_buffer_r(parser, value, &writer, 0, is_pretty, NULL) != JSONSuccess) {
+        return JSONFailure;
+    }
+    buf[writer.pos] = '\0';
+    return JSONSuccess;
 }
 
-JSON_Array * json_array_get_array(const JSON_Array *array, size_t index) {
-    return json_value_get_array(json_array_get_value(array, index));
+#ifdef PARSON_ENABLE_PARALLEL
+
+typedef struct json_parallel_serialize_slice {
+    JSON_Parser parser;  /* worker copy, as in json_parse_string_parallel */
+    const JSON_Value *root;
+    size_t first;
+    size_t count;
+    size_t total_count;   /* children of the root, for the separator rule */
+    size_t *sizes;        /* sizing pass output, indexed by child */
+    char *buf;            /* NULL while sizing */
+    const size_t *offsets;
+    parson_bool_t is_pretty;
+    parson_bool_t threaded;
+    JSON_Status status;
+} JSON_Parallel_Serialize_Slice;
+
+/* Serializes one top-level child of 'root_value' - for objects the key, the
+   separator and the member value; for arrays the element - followed by the
+   comma and, when pretty, the newline that belong to it. A unit produces the
+   same bytes whether counted or written, which is what makes the precomputed
+   offsets exact. */
+static JSON_Status json_serialize_parallel_unit(JSON_Parser const * parser, const JSON_Value *root_value, size_t index, size_t total_count, JSON_Writer *writer, parson_bool_t is_pretty, char *num_buf) {
+    const JSON_Value *child = NULL;
+    JSON_Value number_value;
+    if (root_value->type == JSONObject) {
+        JSON_Object *object = root_value->value.object;
+        const char *key = json_object_get_name(object, index);
+        if (key == NULL) {
+            return JSONFailure;
+        }
+        if (is_pretty) {
+            json_writer_append(writer, PARSON_INDENT_STR, SIZEOF_TOKEN(PARSON_INDENT_STR));
+        }
+        if (json_serialize_string(parser, key, strlen(key), writer) != JSONSuccess) {
+            return JSONFailure;
+        }
+        json_writer_append(writer, is_pretty ? ": " : ":", is_pretty ? 2 : 1);
+        child = json_object_get_value_at(object, index);
+    } else {
+        JSON_Array *array = root_value->value.array;
+        if (is_pretty) {
+            json_writer_append(writer, PARSON_INDENT_STR, SIZEOF_TOKEN(PARSON_INDENT_STR));
+        }
+        if (array->numbers != NULL) {
+            number_value.parent = NULL;
+            number_value.ref_count = 0;
+            number_value.type = JSONNumber;
+            number_value.value.number = array->numbers[index];
+            child = &number_value;
+        } else {
+            child = array->items[index];
+        }
+    }
+    if (json_serialize_to_buffer_r(parser, child, writer, 1, is_pretty, num_buf) != JSONSuccess) {
+        return JSONFailure;
+    }
+    if (index < total_count - 1) {
+        json_writer_append(writer, ",", 1);
+    }
+    if (is_pretty) {
+        json_writer_append(writer, "\n", 1);
+    }
+    return writer->failed ? JSONFailure : JSONSuccess;
 }
 
-int json_array_get_boolean(const JSON_Array *array, size_t index) {
-    return json_value_get_boolean(json_array_get_value(array, index));
+static void json_parallel_serialize_slice_run(JSON_Parallel_Serialize_Slice *slice) {
+    char num_buf[PARSON_NUM_BUF_SIZE];
+    size_t i = 0;
+    slice->status = JSONSuccess;
+    for (i = 0; i < slice->count; i++) {
+        size_t index = slice->first + i;
+        JSON_Writer writer;
+        writer.parser = &slice->parser;
+        writer.buf = slice->buf ? slice->buf + slice->offsets[index] : NULL;
+        writer.pos = 0;
+        writer.capacity = 0;
+        writer.growable = PARSON_FALSE;
+        writer.failed = PARSON_FALSE;
+        writer.write_func = NULL;
+        writer.write_userdata = NULL;
+        if (json_serialize_parallel_unit(&slice->parser, slice->root, index, slice->total_count, &writer, slice->is_pretty, num_buf) != JSONSuccess) {
+            slice->status = JSONFailure;
+            return;
+        }
+        if (slice->sizes != NULL) {
+            slice->sizes[index] = writer.pos;
+        }
+    }
 }
 
-size_t json_array_get_count(const JSON_Array *array) {
-    return array ? array->count : 0;
+#if defined(PARSON_PARALLEL_WIN32)
+static DWORD WINAPI json_parallel_serialize_thread_main(LPVOID arg) {
+    json_parallel_serialize_slice_run((JSON_Parallel_Serialize_Slice*)arg);
+    return 0;
+}
+#else
+static void * json_parallel_serialize_thread_main(void *arg) {
+    json_parallel_serialize_slice_run((JSON_Parallel_Serialize_Slice*)arg);
+    return NULL;
 }
+#endif
 
-JSON_Value * json_array_get_wrapping_value(const JSON_Array *array) {
-    if (!array) {
-        return NULL;
+static JSON_Status json_parallel_serialize_run_slices(JSON_Parallel_Serialize_Slice *slices, JSON_Parallel_Thread *threads, size_t thread_count) {
+    size_t i = 0;
+    JSON_Status status = JSONSuccess;
+    for (i = 0; i + 1 < thread_count; i++) {
+        slices[i].threaded = json_parallel_thread_start(&threads[i], json_parallel_serialize_thread_main, &slices[i]);
+        if (!slices[i].threaded) {
+            json_parallel_serialize_slice_run(&slices[i]); /* couldn't spawn - do it here */
+        }
     }
-    return array->wrapping_value;
+    json_parallel_serialize_slice_run(&slices[thread_count - 1]); /* last slice runs on the caller */
+    for (i = 0; i + 1 < thread_count; i++) {
+        if (slices[i].threaded) {
+            json_parallel_thread_join(&threads[i]);
+        }
+    }
+    for (i = 0; i < thread_count; i++) {
+        if (slices[i].status != JSONSuccess) {
+            status = JSONFailure;
+        }
+    }
+    return status;
 }
 
-/* JSON Value API */
-JSON_Value_Type json_value_get_type(const JSON_Value *value) {
-    return value ? value->type : JSONError;
-}
+/* Sizes the top-level children of an array or object root on
+   serialize_thread_count threads, turns the sizes into byte offsets, then has
+   the same workers serialize each child into its disjoint range. Writes into
+   'fixed_buf' when given (failing if it is too small), otherwise allocates.
+   Sets *out_attempted when the outcome is authoritative; scalar roots and
+   too little work fall back to the sequential serializer. */
+static char * json_serialize_parallel_internal(JSON_Parser const * parser, const JSON_Value *value, char *fixed_buf, size_t fixed_buf_size, parson_bool_t is_pretty, parson_bool_t *out_attempted) {
+    size_t count = 0;
+    size_t thread_count = 0;
+    size_t chunk = 0, extra = 0, first = 0;
+    size_t header = 0, total = 0;
+    size_t *sizes = NULL;
+    JSON_Parallel_Serialize_Slice *slices = NULL;
+    JSON_Parallel_Thread *threads = NULL;
+    char *buf = NULL;
+    char open_char = '[', close_char = ']';
+    size_t i = 0;
 
-JSON_Object * json_value_get_object(const JSON_Value *value) {
-    return json_value_get_type(value) == JSONObject ? value->value.object : NULL;
-}
+    *out_attempted = PARSON_FALSE;
+    if (json_value_get_type(value) == JSONArray) {
+        count = json_array_get_count(json_value_get_array(value));
+    } else if (json_value_get_type(value) == JSONObject) {
+        count = json_object_get_count(json_value_get_object(value));
+        open_char = '{';
+        close_char = '}';
+    } else {
+        return NULL;
+    }
+    thread_count = parser->serialize_thread_count;
+    if (thread_count > count) {
+        thread_count = count;
+    }
+    if (thread_count < 2) {
+        return NULL; /* too little work to be worth threading */
+    }
+    *out_attempted = PARSON_TRUE;
 
-JSON_Array * json_value_get_array(const JSON_Value *value) {
-    return json_value_get_type(value) == JSONArray ? value->value.array : NULL;
-}
+    sizes = (size_t*)parson_malloc(parser, count * sizeof(size_t));
+    slices = (JSON_Parallel_Serialize_Slice*)parson_malloc(parser, thread_count * sizeof(JSON_Parallel_Serialize_Slice));
+    threads = (JSON_Parallel_Thread*)parson_malloc(parser, thread_count * sizeof(JSON_Parallel_Thread));
+    if (sizes == NULL || slices == NULL || threads == NULL) {
+        goto error;
+    }
+    chunk = count / thread_count;
+    extra = count % thread_count;
+    for (i = 0; i < thread_count; i++) {
+        JSON_Parallel_Serialize_Slice *slice = &slices[i];
+        slice->parser = *parser;
+        slice->parser.stats = NULL;
+        slice->parser.intern_pool = NULL;
+        slice->root = value;
+        slice->first = first;
+        slice->count = chunk + (i < extra ? 1 : 0);
+        slice->total_count = count;
+        slice->sizes = sizes;
+        slice->buf = NULL;
+        slice->offsets = NULL;
+        slice->is_pretty = is_pretty;
+        slice->threaded = PARSON_FALSE;
+        slice->status = JSONFailure;
+        first += slice->count;
+    }
+    if (json_parallel_serialize_run_slices(slices, threads, thread_count) != JSONSuccess) {
+        goto error;
+    }
 
-static const JSON_String * json_value_get_string_desc(const JSON_Value *value) {
-    return json_value_get_type(value) == JSONString ? &value->value.string : NULL;
-}
+    header = is_pretty ? 2 : 1; /* the opening bracket, plus its newline when pretty */
+    total = header;
+    for (i = 0; i < count; i++) {
+        size_t unit_size = sizes[i];
+        sizes[i] = total; /* sizes become offsets in place */
+        total += unit_size;
+    }
+    total += 2; /* the closing bracket and the NUL */
+    if (fixed_buf != NULL) {
+        if (fixed_buf_size < total) {
+            goto error;
+        }
+        buf = fixed_buf;
+    } else {
+        buf = (char*)parson_malloc(parser, total);
+        if (buf == NULL) {
+            goto error;
+        }
+    }
+    buf[0] = open_char;
+    if (is_pretty) {
+        buf[1] = '\n';
+    }
+    for (i = 0; i < thread_count; i++) {
+        slices[i].sizes = NULL;
+        slices[i].buf = buf;
+        slices[i].offsets = sizes;
+    }
+    if (json_parallel_serialize_run_slices(slices, threads, thread_count) != JSONSuccess) {
+        goto error;
+    }
+    /* written after the join: the final unit's number formatting may place a
+       scratch NUL exactly where the closing bracket goes */
+    buf[total - 2] = close_char;
+    buf[total - 1] = '\0';
+    parson_free(parser, sizes);
+    parson_free(parser, slices);
+    parson_free(parser, threads);
+    return buf;
 
-const char * json_value_get_string(const JSON_Value *value) {
-    const JSON_String *str = json_value_get_string_desc(value);
-    return str ? str->chars : NULL;
+error:
+    if (buf != NULL && buf != fixed_buf) {
+        parson_free(parser, buf);
+    }
+    parson_free(parser, sizes);
+    parson_free(parser, slices);
+    parson_free(parser, threads);
+    return NULL;
 }
 
-size_t json_value_get_string_len(const JSON_Value *value) {
-    const JSON_String *str = json_value_get_string_desc(value);
-    return str ? str->length : 0;
-}
+#endif /* PARSON_ENABLE_PARALLEL */
 
-double json_value_get_number(const JSON_Value *value) {
-    return json_value_get_type(value) == JSONNumber ? value->value.number : 0;
+/* Single-pass serialization: the tree is traversed once, writing into a
+   buffer that doubles as needed through the parser's allocator. */
+static char * json_serialize_to_string_growable(JSON_Parser const * parser, const JSON_Value *value, parson_bool_t is_pretty) {
+    JSON_Writer writer;
+#ifdef PARSON_ENABLE_PARALLEL
+    if (parser->serialize_thread_count > 1) {
+        parson_bool_t attempted = PARSON_FALSE;
+        char *result = json_serialize_parallel_internal(parser, value, NULL, 0, is_pretty, &attempted);
+        if (attempted) {
+            return result;
+        }
+    }
+#endif
+    writer.parser = parser;
+    writer.buf = NULL;
+    writer.pos = 0;
+    writer.capacity = 0;
+    writer.growable = PARSON_TRUE;
+    writer.failed = PARSON_FALSE;
+    writer.write_func = NULL;
+    writer.write_userdata = NULL;
+    if (json_serialize_to_buffer_r(parser, value, &writer, 0, is_pretty, NULL) != JSONSuccess || writer.buf == NULL) {
+        parson_free(parser, writer.buf);
+        return NULL;
+    }
+    writer.buf[writer.pos] = '\0'; /* json_writer_reserve always leaves room for the NUL */
+    return writer.buf;
 }
 
-int json_value_get_boolean(const JSON_Value *value) {
-    return json_value_get_type(value) == JSONBoolean ? value->value.boolean : -1;
+/* Streamed serialization: formats into a fixed stack buffer that is flushed
+   through 'write_func' as it fills, so memory is O(buffer) regardless of
+   document size and writes overlap with formatting. */
+static JSON_Status json_serialize_to_stream_internal(JSON_Parser const * parser, const JSON_Value *value, JSON_Stream_Write_Function write_func, void *user_data, parson_bool_t is_pretty) {
+    char buf[PARSON_STREAM_BUF_SIZE];
+    JSON_Writer writer;
+    if (write_func == NULL) {
+        return JSONFailure;
+    }
+    writer.parser = parser;
+    writer.buf = buf;
+    writer.pos = 0;
+    writer.capacity = sizeof(buf);
+    writer.growable = PARSON_FALSE;
+    writer.failed = PARSON_FALSE;
+    writer.write_func = write_func;
+    writer.write_userdata = user_data;
+    if (json_serialize_to_buffer_r(parser, value, &writer, 0, is_pretty, NULL) != JSONSuccess) {
+        return JSONFailure;
+    }
+    json_writer_flush(&writer);
+    return writer.failed ? JSONFailure : JSONSuccess;
 }
 
-JSON_Value * json_value_get_parent (const JSON_Value *value) {
-    return value ? value->parent : NULL;
+static size_t json_stream_write_file(const char *buffer, size_t len, void *user_data) {
+    return fwrite(buffer, 1, len, (FILE*)user_data);
 }
 
-void json_value_free(JSON_Parser const * parser, JSON_Value *value) {
-    switch (json_value_get_type(value)) {
-        case JSONObject:
-            json_object_free(parser, value->value.object);
-            break;
-        case JSONString:
-            parser->free_func(value->value.string.chars, parser->malloc_userdata);
-            break;
-        case JSONArray:
-            json_array_free(parser, value->value.array);
-            break;
-        default:
-            break;
-    }
-    parser->free_func(value, parser->malloc_userdata);
+size_t json_serialization_size(JSON_Parser const * parser, const JSON_Value *value) {
+    return json_serialization_size_internal(parser, value, PARSON_FALSE);
 }
 
-JSON_Value * json_value_init_object(JSON_Parser const * parser) {
-    JSON_Value *new_value = (JSON_Value*)parser->malloc_func(sizeof(JSON_Value), parser->malloc_userdata);
-    if (!new_value) {
-        return NULL;
+JSON_Status json_serialize_to_buffer(JSON_Parser const * parser, const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
+    size_t needed_size_in_bytes = 0;
+#ifdef PARSON_ENABLE_PARALLEL
+    if (parser->serialize_thread_count > 1) {
+        parson_bool_t attempted = PARSON_FALSE;
+        char *result = json_serialize_parallel_internal(parser, value, buf, buf_size_in_bytes, PARSON_FALSE, &attempted);
+        if (attempted) {
+            return result != NULL ? JSONSuccess : JSONFailure;
+        }
     }
-    new_value->parent = NULL;
-    new_value->type = JSONObject;
-    new_value->value.object = json_object_make(parser, new_value);
-    if (!new_value->value.object) {
-        parser->free_func(new_value, parser->malloc_userdata);
-        return NULL;
+#endif
+    needed_size_in_bytes = json_serialization_size(parser, value);
+    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
+        return JSONFailure;
     }
-    return new_value;
+    return json_serialize_to_fixed_buffer(parser, value, buf, PARSON_FALSE);
 }
 
-JSON_Value * json_value_init_array(JSON_Parser const * parser) {
-    JSON_Value *new_value = (JSON_Value*)parser->malloc_func(sizeof(JSON_Value), parser->malloc_userdata);
-    if (!new_value) {
-        return NULL;
+JSON_Status json_serialize_to_file(JSON_Parser const * parser, const JSON_Value *value, const char *filename) {
+    JSON_Status return_code = JSONSuccess;
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        return JSONFailure;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONArray;
-    new_value->value.array = json_array_make(parser, new_value);
-    if (!new_value->value.array) {
-        parser->free_func(new_value, parser->malloc_userdata);
-        return NULL;
+    return_code = json_serialize_to_stream_internal(parser, value, json_stream_write_file, fp, PARSON_FALSE);
+    if (fclose(fp) == EOF) {
+        return_code = JSONFailure;
     }
-    return new_value;
+    return return_code;
 }
 
-JSON_Value * json_value_init_string(JSON_Parser const * parser, const char *string) {
-    if (string == NULL) {
-        return NULL;
-    }
-    return json_value_init_string_with_len(parser, string, strlen(string));
+JSON_Status json_serialize_to_stream(JSON_Parser const * parser, const JSON_Value *value, JSON_Stream_Write_Function write_func, void *user_data) {
+    return json_serialize_to_stream_internal(parser, value, write_func, user_data, PARSON_FALSE);
 }
 
-JSON_Value * json_value_init_string_with_len(JSON_Parser const * parser, const char *string, size_t length) {
-    char *copy = NULL;
-    JSON_Value *value;
-    if (string == NULL) {
-        return NULL;
-    }
-    if (!is_valid_utf8(string, length)) {
-        return NULL;
-    }
-    copy = parson_strndup(parser, string, length);
-    if (copy == NULL) {
-        return NULL;
+char * json_serialize_to_string(JSON_Parser const * parser, const JSON_Value *value) {
+    return json_serialize_to_string_growable(parser, value, PARSON_FALSE);
+}
+
+size_t json_serialization_size_pretty(JSON_Parser const * parser, const JSON_Value *value) {
+    return json_serialization_size_internal(parser, value, PARSON_TRUE);
+}
+
+JSON_Status json_serialize_to_buffer_pretty(JSON_Parser const * parser, const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
+    size_t needed_size_in_bytes = 0;
+#ifdef PARSON_ENABLE_PARALLEL
+    if (parser->serialize_thread_count > 1) {
+        parson_bool_t attempted = PARSON_FALSE;
+        char *result = json_serialize_parallel_internal(parser, value, buf, buf_size_in_bytes, PARSON_TRUE, &attempted);
+        if (attempted) {
+            return result != NULL ? JSONSuccess : JSONFailure;
+        }
     }
-    value = json_value_init_string_no_copy(parser, copy, length);
-    if (value == NULL) {
-        parser->free_func(copy, parser->malloc_userdata);
+#endif
+    needed_size_in_bytes = json_serialization_size_pretty(parser, value);
+    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
+        return JSONFailure;
     }
-    return value;
+    return json_serialize_to_fixed_buffer(parser, value, buf, PARSON_TRUE);
 }
 
-JSON_Value * json_value_init_number(JSON_Parser const * parser, double number) {
-    JSON_Value *new_value = NULL;
-    if (IS_NUMBER_INVALID(number)) {
-        return NULL;
+JSON_Status json_serialize_to_file_pretty(JSON_Parser const * parser, const JSON_Value *value, const char *filename) {
+    JSON_Status return_code = JSONSuccess;
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        return JSONFailure;
     }
-    new_value = (JSON_Value*)parser->malloc_func(sizeof(JSON_Value), parser->malloc_userdata);
-    if (new_value == NULL) {
-        return NULL;
+    return_code = json_serialize_to_stream_internal(parser, value, json_stream_write_file, fp, PARSON_TRUE);
+    if (fclose(fp) == EOF) {
+        return_code = JSONFailure;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONNumber;
-    new_value->value.number = number;
-    return new_value;
+    return return_code;
 }
 
-JSON_Value * json_value_init_boolean(JSON_Parser const * parser, int boolean) {
-    JSON_Value *new_value = (JSON_Value*)parser->malloc_func(sizeof(JSON_Value), parser->malloc_userdata);
-    if (!new_value) {
-        return NULL;
-    }
-    new_value->parent = NULL;
-    new_value->type = JSONBoolean;
-    new_value->value.boolean = boolean ? 1 : 0;
-    return new_value;
+JSON_Status json_serialize_to_stream_pretty(JSON_Parser const * parser, const JSON_Value *value, JSON_Stream_Write_Function write_func, void *user_data) {
+    return json_serialize_to_stream_internal(parser, value, write_func, user_data, PARSON_TRUE);
 }
 
-JSON_Value * json_value_init_null(JSON_Parser const * parser) {
-    JSON_Value *new_value = (JSON_Value*)parser->malloc_func(sizeof(JSON_Value), parser->malloc_userdata);
-    if (!new_value) {
-        return NULL;
-    }
-    new_value->parent = NULL;
-    new_value->type = JSONNull;
-    return new_value;
+char * json_serialize_to_string_pretty(JSON_Parser const * parser, const JSON_Value *value) {
+    return json_serialize_to_string_growable(parser, value, PARSON_TRUE);
 }
 
-JSON_Value * json_value_deep_copy(JSON_Parser const * parser, const JSON_Value *value) {
-    size_t i = 0;
-    JSON_Value *return_value = NULL, *temp_value_copy = NULL, *temp_value = NULL;
-    const JSON_String *temp_string = NULL;
-    const char *temp_key = NULL;
-    char *temp_string_copy = NULL;
-    JSON_Array *temp_array = NULL, *temp_array_copy = NULL;
-    JSON_Object *temp_object = NULL, *temp_object_copy = NULL;
-    JSON_Status res = JSONFailure;
-    char *key_copy = NULL;
+void json_free_serialized_string(JSON_Parser const * parser, char *string) {
+    parson_free(parser, string);
+}
+
+/* JSON Snapshot */
+
+/* Snapshots store the in-memory tree (values, object hash arrays, strings) in
+   one relocatable blob where every pointer field holds an offset from the blob
+   start. Loading reads the file into a single allocation and converts offsets
+   back to pointers in one linear pass - no tokenizing, no string processing,
+   no per-node allocation. Offset 0 is the header and doubles as NULL. */
+
+#define PARSON_SNAPSHOT_VERSION 1
+#define PARSON_SNAPSHOT_ALIGN   sizeof(double) /* covers pointers and size_t too */
+
+typedef struct json_snapshot_header {
+    unsigned char magic[4];   /* "PSNP" */
+    unsigned char version;
+    unsigned char word_size;  /* sizeof(void*) of the writer */
+    unsigned char ulong_size; /* sizeof(unsigned long) - hash and cell layout depend on it */
+    unsigned char endianness; /* first byte of (unsigned int)1 on the writer */
+    size_t total_size;        /* whole blob, header included */
+} JSON_Snapshot_Header;
+
+typedef struct json_snapshot_writer {
+    JSON_Parser const *parser;
+    char *buf;
+    size_t size;
+    size_t capacity;
+    parson_bool_t failed;
+} JSON_Snapshot_Writer;
+
+/* One frame per container whose child slots still need filling. */
+typedef struct json_snapshot_frame {
+    JSON_Value * const *children; /* into the original tree */
+    size_t child_ix;
+    size_t child_count;
+    size_t value_off;             /* offset of the emitted JSON_Value */
+    size_t slots_off;             /* offset of the emitted child pointer array */
+} JSON_Snapshot_Frame;
+
+static unsigned char json_snapshot_endianness(void) {
+    unsigned int one = 1;
+    unsigned char first_byte = 0;
+    memcpy(&first_byte, &one, 1);
+    return first_byte;
+}
+
+/* Reserves aligned space in the blob, zero-filled so struct padding does not
+   leak uninitialized bytes into the file. Returns the offset, 0 on failure. */
+static size_t json_snapshot_alloc(JSON_Snapshot_Writer *writer, size_t size) {
+    size_t off = writer->size;
+    size_t aligned_size = (size + (PARSON_SNAPSHOT_ALIGN - 1)) & ~(PARSON_SNAPSHOT_ALIGN - 1);
+    if (writer->failed) {
+        return 0;
+    }
+    if (writer->size + aligned_size > writer->capacity) {
+        size_t new_capacity = writer->capacity ? writer->capacity * 2 : 4096;
+        char *new_buf = NULL;
+        while (new_capacity < writer->size + aligned_size) {
+            new_capacity *= 2;
+        }
+        new_buf = (char*)parson_malloc(writer->parser, new_capacity);
+        if (new_buf == NULL) {
+            writer->failed = PARSON_TRUE;
+            return 0;
+        }
+        if (writer->size > 0) {
+            memcpy(new_buf, writer->buf, writer->size);
+        }
+        parson_free(writer->parser, writer->buf);
+        writer->buf = new_buf;
+        writer->capacity = new_capacity;
+    }
+    memset(writer->buf + off, 0, aligned_size);
+    writer->size += aligned_size;
+    return off;
+}
 
-    switch (json_value_get_type(value)) {
-        case JSONArray:
-            temp_array = json_value_get_array(value);
-            return_value = json_value_init_array(parser);
-            if (return_value == NULL) {
-                return NULL;
+/* Emits one value (and its non-child payload) with pointer fields stored as
+   offsets; child value slots are left zero for the frame loop to fill. */
+static size_t json_snapshot_emit_value(JSON_Snapshot_Writer *writer, const JSON_Value *value, size_t parent_off, JSON_Snapshot_Frame *out_frame) {
+    JSON_Value stored;
+    size_t value_off = json_snapshot_alloc(writer, sizeof(JSON_Value));
+    if (value_off == 0) {
+        return 0;
+    }
+    memset(&stored, 0, sizeof(stored));
+    stored.parent = (JSON_Value*)parent_off;
+    stored.type = value->type;
+    out_frame->children = NULL;
+    out_frame->child_ix = 0;
+    out_frame->child_count = 0;
+    out_frame->value_off = value_off;
+    out_frame->slots_off = 0;
+    switch (value->type) {
+        case JSONString: {
+            size_t chars_off = json_snapshot_alloc(writer, value->value.string.length + 1);
+            if (chars_off == 0) {
+                return 0;
             }
-            temp_array_copy = json_value_get_array(return_value);
-            for (i = 0; i < json_array_get_count(temp_array); i++) {
-                temp_value = json_array_get_value(temp_array, i);
-                temp_value_copy = json_value_deep_copy(parser, temp_value);
-                if (temp_value_copy == NULL) {
-                    json_value_free(parser, return_value);
-                    return NULL;
+            memcpy(writer->buf + chars_off, value->value.string.chars, value->value.string.length + 1);
+            stored.value.string.chars = (char*)chars_off;
+            stored.value.string.length = value->value.string.length;
+            stored.value.string.owned = PARSON_FALSE;
+            break;
+        }
+        case JSONObject: {
+            const JSON_Object *object = value->value.object;
+            JSON_Object stored_object;
+            size_t object_off = json_snapshot_alloc(writer, sizeof(JSON_Object));
+            size_t cells_off = 0, names_off = 0, values_off = 0, cell_ixs_off = 0, hashes_off = 0;
+            size_t i = 0;
+            if (object_off == 0) {
+                return 0;
+            }
+            if (object->cell_capacity > 0) {
+                cells_off = json_snapshot_alloc(writer, object->cell_capacity * sizeof(JSON_Object_Cell));
+                if (cells_off == 0) {
+                    return 0;
                 }
-                if (json_array_add(parser, temp_array_copy, temp_value_copy) != JSONSuccess) {
-                    json_value_free(parser, return_value);
-                    json_value_free(parser, temp_value_copy);
-                    return NULL;
+                memcpy(writer->buf + cells_off, object->cells, object->cell_capacity * sizeof(JSON_Object_Cell));
+            }
+            if (object->count > 0) {
+                names_off = json_snapshot_alloc(writer, object->count * sizeof(char*));
+                values_off = json_snapshot_alloc(writer, object->count * sizeof(JSON_Value*));
+                cell_ixs_off = json_snapshot_alloc(writer, object->count * sizeof(size_t));
+                hashes_off = json_snapshot_alloc(writer, object->count * sizeof(unsigned long));
+                if (names_off == 0 || values_off == 0 || cell_ixs_off == 0 || hashes_off == 0) {
+                    return 0;
+                }
+                memcpy(writer->buf + cell_ixs_off, object->cell_ixs, object->count * sizeof(size_t));
+                memcpy(writer->buf + hashes_off, object->hashes, object->count * sizeof(unsigned long));
+                for (i = 0; i < object->count; i++) {
+                    size_t key_len = strlen(object->names[i]);
+                    size_t key_off = json_snapshot_alloc(writer, key_len + 1);
+                    if (key_off == 0) {
+                        return 0;
+                    }
+                    memcpy(writer->buf + key_off, object->names[i], key_len + 1);
+                    ((size_t*)(writer->buf + names_off))[i] = key_off;
                 }
             }
-            return return_value;
-        case JSONObject:
-            temp_object = json_value_get_object(value);
-            return_value = json_value_init_object(parser);
-            if (!return_value) {
-                return NULL;
+            memset(&stored_object, 0, sizeof(stored_object));
+            stored_object.wrapping_value = (JSON_Value*)value_off;
+            stored_object.cells = (JSON_Object_Cell*)cells_off;
+            stored_object.names = (char**)names_off;
+            stored_object.values = (JSON_Value**)values_off;
+            stored_object.cell_ixs = (size_t*)cell_ixs_off;
+            stored_object.hashes = (unsigned long*)hashes_off;
+            stored_object.count = object->count;
+            stored_object.item_capacity = object->count;
+            stored_object.cell_capacity = object->cell_capacity;
+            stored_object.owns_keys = PARSON_FALSE;
+            stored_object.frozen = PARSON_TRUE;
+            stored_object.packed = PARSON_FALSE;
+            memcpy(writer->buf + object_off, &stored_object, sizeof(stored_object));
+            stored.value.object = (JSON_Object*)object_off;
+            out_frame->children = object->values;
+            out_frame->child_count = object->count;
+            out_frame->slots_off = values_off;
+            break;
+        }
+        case JSONArray: {
+            const JSON_Array *array = value->value.array;
+            JSON_Array stored_array;
+            size_t array_off = json_snapshot_alloc(writer, sizeof(JSON_Array));
+            size_t items_off = 0;
+            size_t numbers_off = 0;
+            if (array_off == 0) {
+                return 0;
             }
-            temp_object_copy = json_value_get_object(return_value);
-            for (i = 0; i < json_object_get_count(temp_object); i++) {
-                temp_key = json_object_get_name(temp_object, i);
-                temp_value = json_object_get_value(temp_object, temp_key);
-                temp_value_copy = json_value_deep_copy(parser, temp_value);
-                if (!temp_value_copy) {
-                    json_value_free(parser, return_value);
-                    return NULL;
-                }
-                key_copy = parson_strdup(parser, temp_key);
-                if (!key_copy) {
-                    json_value_free(parser, temp_value_copy);
-                    json_value_free(parser, return_value);
-                    return NULL;
+            if (array->numbers != NULL) {
+                numbers_off = json_snapshot_alloc(writer, array->count * sizeof(double));
+                if (numbers_off == 0) {
+                    return 0;
                 }
-                res = json_object_add(parser, temp_object_copy, key_copy, temp_value_copy);
-                if (res != JSONSuccess) {
-                    parser->free_func(key_copy, parser->malloc_userdata);
-                    json_value_free(parser, temp_value_copy);
-                    json_value_free(parser, return_value);
-                    return NULL;
+                memcpy(writer->buf + numbers_off, array->numbers, array->count * sizeof(double));
+            } else if (array->count > 0) {
+                items_off = json_snapshot_alloc(writer, array->count * sizeof(JSON_Value*));
+                if (items_off == 0) {
+                    return 0;
                 }
             }
-            return return_value;
-        case JSONBoolean:
-            return json_value_init_boolean(parser, json_value_get_boolean(value));
+            memset(&stored_array, 0, sizeof(stored_array));
+            stored_array.wrapping_value = (JSON_Value*)value_off;
+            stored_array.items = (JSON_Value**)items_off;
+            stored_array.numbers = (double*)numbers_off;
+            stored_array.count = array->count;
+            stored_array.capacity = array->count;
+            stored_array.frozen = PARSON_TRUE;
+            memcpy(writer->buf + array_off, &stored_array, sizeof(stored_array));
+            stored.value.array = (JSON_Array*)array_off;
+            out_frame->children = array->numbers != NULL ? NULL : array->items;
+            out_frame->child_count = array->numbers != NULL ? 0 : array->count;
+            out_frame->slots_off = items_off;
+            break;
+        }
         case JSONNumber:
-            return json_value_init_number(parser, json_value_get_number(value));
-        case JSONString:
-            temp_string = json_value_get_string_desc(value);
-            if (temp_string == NULL) {
-                return NULL;
-            }
-            temp_string_copy = parson_strndup(parser, temp_string->chars, temp_string->length);
-            if (temp_string_copy == NULL) {
-                return NULL;
-            }
-            return_value = json_value_init_string_no_copy(parser, temp_string_copy, temp_string->length);
-            if (return_value == NULL) {
-                parser->free_func(temp_string_copy, parser->malloc_userdata);
-            }
-            return return_value;
-        case JSONNull:
-            return json_value_init_null(parser);
-        case JSONError:
-            return NULL;
+            stored.value.number = value->value.number;
+            break;
+        case JSONBoolean:
+            stored.value.boolean = value->value.boolean;
+            break;
         default:
-            return NULL;
+            break;
     }
+    memcpy(writer->buf + value_off, &stored, sizeof(stored));
+    return value_off;
 }
 
-size_t json_serialization_size(JSON_Parser const * parser, const JSON_Value *value) {
-    char num_buf[PARSON_NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(parser, value, NULL, 0, PARSON_FALSE, num_buf);
-    return res < 0 ? 0 : (size_t)(res) + 1;
-}
+JSON_Status json_value_save_snapshot(JSON_Parser const * parser, const JSON_Value *value, const char *filename) {
+    JSON_Snapshot_Writer writer;
+    JSON_Snapshot_Header header;
+    JSON_Snapshot_Frame *stack = NULL;
+    size_t stack_count = 0;
+    size_t stack_capacity = 0;
+    JSON_Snapshot_Frame frame;
+    size_t header_off = 0;
+    FILE *fp = NULL;
+    JSON_Status res = JSONFailure;
 
-JSON_Status json_serialize_to_buffer(JSON_Parser const * parser, const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size(parser, value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
+    if (parser == NULL || value == NULL || filename == NULL || sizeof(size_t) != sizeof(void*)) {
         return JSONFailure;
     }
-    written = json_serialize_to_buffer_r(parser, value, buf, 0, PARSON_FALSE, NULL);
-    if (written < 0) {
+    writer.parser = parser;
+    writer.buf = NULL;
+    writer.size = 0;
+    writer.capacity = 0;
+    writer.failed = PARSON_FALSE;
+
+    header_off = json_snapshot_alloc(&writer, sizeof(JSON_Snapshot_Header));
+    if (json_snapshot_emit_value(&writer, value, 0, &frame) == 0) {
+        goto cleanup; /* the header sits at offset 0, so 0 from emit always means failure */
+    }
+    if (frame.child_count > 0) {
+        stack_capacity = STARTING_CAPACITY;
+        stack = (JSON_Snapshot_Frame*)parson_malloc(parser, stack_capacity * sizeof(*stack));
+        if (stack == NULL) {
+            goto cleanup;
+        }
+        stack[stack_count++] = frame;
+    }
+    while (stack_count > 0) {
+        JSON_Snapshot_Frame *top = &stack[stack_count - 1];
+        if (top->child_ix >= top->child_count) {
+            stack_count--;
+            continue;
+        }
+        {
+            const JSON_Value *child = top->children[top->child_ix];
+            size_t slot_off = top->slots_off + top->child_ix * sizeof(size_t);
+            size_t child_off = json_snapshot_emit_value(&writer, child, top->value_off, &frame);
+            if (child_off == 0) {
+                goto cleanup;
+            }
+            *(size_t*)(writer.buf + slot_off) = child_off;
+            top->child_ix++;
+        }
+        if (frame.child_count > 0) {
+            if (stack_count >= stack_capacity) {
+                size_t new_capacity = stack_capacity * 2;
+                JSON_Snapshot_Frame *new_stack = (JSON_Snapshot_Frame*)parson_malloc(parser, new_capacity * sizeof(*stack));
+                if (new_stack == NULL) {
+                    goto cleanup;
+                }
+                memcpy(new_stack, stack, stack_count * sizeof(*stack));
+                parson_free(parser, stack);
+                stack = new_stack;
+                stack_capacity = new_capacity;
+            }
+            stack[stack_count++] = frame;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic[0] = 'P'; header.magic[1] = 'S'; header.magic[2] = 'N'; header.magic[3] = 'P';
+    header.version = PARSON_SNAPSHOT_VERSION;
+    header.word_size = (unsigned char)sizeof(void*);
+    header.ulong_size = (unsigned char)sizeof(unsigned long);
+    header.endianness = json_snapshot_endianness();
+    header.total_size = writer.size;
+    memcpy(writer.buf + header_off, &header, sizeof(header));
+
+    fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        goto cleanup;
+    }
+    if (fwrite(writer.buf, 1, writer.size, fp) == writer.size) {
+        res = JSONSuccess;
+    }
+    if (fclose(fp) == EOF) {
+        res = JSONFailure;
+    }
+cleanup:
+    parson_free(parser, stack);
+    parson_free(parser, writer.buf);
+    return res;
+}
+
+/* Converts one stored offset back to a pointer; rejects offsets outside the
+   blob so a truncated or corrupted file fails the load instead of crashing. */
+static JSON_Status json_snapshot_fix_ptr(char *blob, size_t total_size, void *slot) {
+    size_t off = 0;
+    void *ptr = NULL;
+    memcpy(&off, slot, sizeof(off));
+    if (off == 0) {
+        ptr = NULL;
+    } else if (off >= total_size) {
         return JSONFailure;
+    } else {
+        ptr = blob + off;
     }
+    memcpy(slot, &ptr, sizeof(ptr));
     return JSONSuccess;
 }
 
-JSON_Status json_serialize_to_file(JSON_Parser const * parser, const JSON_Value *value, const char *filename) {
-    JSON_Status return_code = JSONSuccess;
-    FILE *fp = NULL;
-    char *serialized_string = json_serialize_to_string(parser, value);
-    if (serialized_string == NULL) {
-        return JSONFailure;
-    }
-    fp = fopen(filename, "w");
-    if (fp == NULL) {
-        json_free_serialized_string(parser, serialized_string);
+/* Relocates one value and its immediate payload. */
+static JSON_Status json_snapshot_fixup_value(char *blob, size_t total_size, JSON_Value *value) {
+    size_t i = 0;
+    if (json_snapshot_fix_ptr(blob, total_size, &value->parent) != JSONSuccess) {
         return JSONFailure;
     }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
+    switch (value->type) {
+        case JSONString:
+            return json_snapshot_fix_ptr(blob, total_size, &value->value.string.chars);
+        case JSONObject: {
+            JSON_Object *object = NULL;
+            if (json_snapshot_fix_ptr(blob, total_size, &value->value.object) != JSONSuccess) {
+                return JSONFailure;
+            }
+            object = value->value.object;
+            if (json_snapshot_fix_ptr(blob, total_size, &object->wrapping_value) != JSONSuccess
+                || json_snapshot_fix_ptr(blob, total_size, &object->cells) != JSONSuccess
+                || json_snapshot_fix_ptr(blob, total_size, &object->names) != JSONSuccess
+                || json_snapshot_fix_ptr(blob, total_size, &object->values) != JSONSuccess
+                || json_snapshot_fix_ptr(blob, total_size, &object->cell_ixs) != JSONSuccess
+                || json_snapshot_fix_ptr(blob, total_size, &object->hashes) != JSONSuccess) {
+                return JSONFailure;
+            }
+            if (object->count > 0 && (object->names == NULL || object->values == NULL)) {
+                return JSONFailure;
+            }
+            for (i = 0; i < object->count; i++) {
+                if (json_snapshot_fix_ptr(blob, total_size, &object->names[i]) != JSONSuccess
+                    || json_snapshot_fix_ptr(blob, total_size, &object->values[i]) != JSONSuccess
+                    || object->names[i] == NULL || object->values[i] == NULL) {
+                    return JSONFailure;
+                }
+            }
+            return JSONSuccess;
+        }
+        case JSONArray: {
+            JSON_Array *array = NULL;
+            if (json_snapshot_fix_ptr(blob, total_size, &value->value.array) != JSONSuccess) {
+                return JSONFailure;
+            }
+            array = value->value.array;
+            if (json_snapshot_fix_ptr(blob, total_size, &array->wrapping_value) != JSONSuccess
+                || json_snapshot_fix_ptr(blob, total_size, &array->items) != JSONSuccess
+                || json_snapshot_fix_ptr(blob, total_size, &array->numbers) != JSONSuccess) {
+                return JSONFailure;
+            }
+            if (array->numbers != NULL) {
+                return array->items == NULL ? JSONSuccess : JSONFailure;
+            }
+            if (array->count > 0 && array->items == NULL) {
+                return JSONFailure;
+            }
+            for (i = 0; i < array->count; i++) {
+                if (json_snapshot_fix_ptr(blob, total_size, &array->items[i]) != JSONSuccess
+                    || array->items[i] == NULL) {
+                    return JSONFailure;
+                }
+            }
+            return JSONSuccess;
+        }
+        default:
+            return JSONSuccess;
     }
-    json_free_serialized_string(parser, serialized_string);
-    return return_code;
 }
 
-char * json_serialize_to_string(JSON_Parser const * parser, const JSON_Value *value) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size(parser, value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
+JSON_Value * json_value_load_snapshot(JSON_Parser const * parser, const char *filename) {
+    JSON_Snapshot_Header header;
+    FILE *fp = NULL;
+    char *blob = NULL;
+    long file_size = 0;
+    size_t size_read = 0;
+    size_t root_off = 0;
+    JSON_Value *root = NULL;
+    JSON_Value **work = NULL;
+    size_t work_count = 0;
+    size_t work_capacity = 0;
+    JSON_Value *current = NULL;
+
+    if (parser == NULL || filename == NULL || sizeof(size_t) != sizeof(void*)) {
         return NULL;
     }
-    buf = (char*)parser->malloc_func(buf_size_bytes, parser->malloc_userdata);
-    if (buf == NULL) {
+    fp = fopen(filename, "rb");
+    if (fp == NULL) {
         return NULL;
     }
-    serialization_result = json_serialize_to_buffer(parser, value, buf, buf_size_bytes);
-    if (serialization_result != JSONSuccess) {
-        json_free_serialized_string(parser, buf);
+    fseek(fp, 0L, SEEK_END);
+    file_size = ftell(fp);
+    if (file_size < (long)sizeof(JSON_Snapshot_Header)) {
+        fclose(fp);
         return NULL;
     }
-    return buf;
-}
+    rewind(fp);
+    blob = (char*)parson_malloc(parser, (size_t)file_size);
+    if (blob == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    size_read = fread(blob, 1, (size_t)file_size, fp);
+    fclose(fp);
+    if (size_read != (size_t)file_size) {
+        goto error;
+    }
+    memcpy(&header, blob, sizeof(header));
+    if (header.magic[0] != 'P' || header.magic[1] != 'S' || header.magic[2] != 'N' || header.magic[3] != 'P'
+        || header.version != PARSON_SNAPSHOT_VERSION
+        || header.word_size != (unsigned char)sizeof(void*)
+        || header.ulong_size != (unsigned char)sizeof(unsigned long)
+        || header.endianness != json_snapshot_endianness()
+        || header.total_size != (size_t)file_size) {
+        goto error;
+    }
+    root_off = (sizeof(JSON_Snapshot_Header) + (PARSON_SNAPSHOT_ALIGN - 1)) & ~(PARSON_SNAPSHOT_ALIGN - 1);
+    if (root_off + sizeof(JSON_Value) > (size_t)file_size) {
+        goto error;
+    }
+    root = (JSON_Value*)(blob + root_off);
 
-size_t json_serialization_size_pretty(JSON_Parser const * parser, const JSON_Value *value) {
-    char num_buf[PARSON_NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(parser, value, NULL, 0, PARSON_TRUE, num_buf);
-    return res < 0 ? 0 : (size_t)(res) + 1;
+    current = root;
+    while (current != NULL) {
+        size_t i = 0, child_count = 0;
+        JSON_Value **children = NULL;
+        if (json_snapshot_fixup_value(blob, header.total_size, current) != JSONSuccess) {
+            goto error;
+        }
+        switch (current->type) {
+            case JSONObject:
+                child_count = current->value.object->count;
+                children = current->value.object->values;
+                break;
+            case JSONArray:
+                if (current->value.array->numbers == NULL) {
+                    child_count = current->value.array->count;
+                    children = current->value.array->items;
+                }
+                break;
+            default:
+                break;
+        }
+        for (i = 0; i < child_count; i++) {
+            if (work_count >= work_capacity) {
+                size_t new_capacity = work_capacity ? work_capacity * 2 : STARTING_CAPACITY;
+                JSON_Value **new_work = (JSON_Value**)parson_malloc(parser, new_capacity * sizeof(JSON_Value*));
+                if (new_work == NULL) {
+                    goto error; /* unlike freeing, fixup cannot safely recurse-and-continue on arbitrary nesting */
+                }
+                if (work_count > 0) {
+                    memcpy(new_work, work, work_count * sizeof(JSON_Value*));
+                }
+                parson_free(parser, work);
+                work = new_work;
+                work_capacity = new_capacity;
+            }
+            work[work_count++] = children[i];
+        }
+        current = work_count > 0 ? work[--work_count] : NULL;
+    }
+    parson_free(parser, work);
+    return root;
+error:
+    parson_free(parser, work);
+    parson_free(parser, blob);
+    return NULL;
 }
 
-JSON_Status json_serialize_to_buffer_pretty(JSON_Parser const * parser, const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size_pretty(parser, value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
-    }
-    written = json_serialize_to_buffer_r(parser, value, buf, 0, PARSON_TRUE, NULL);
-    if (written < 0) {
+JSON_Status json_value_free_snapshot(JSON_Parser const * parser, JSON_Value *value) {
+    size_t root_off = (sizeof(JSON_Snapshot_Header) + (PARSON_SNAPSHOT_ALIGN - 1)) & ~(PARSON_SNAPSHOT_ALIGN - 1);
+    char *blob = NULL;
+    if (parser == NULL || value == NULL) {
         return JSONFailure;
     }
+    blob = (char*)value - root_off;
+    parson_free(parser, blob);
     return JSONSuccess;
 }
 
-JSON_Status json_serialize_to_file_pretty(JSON_Parser const * parser, const JSON_Value *value, const char *filename) {
-    JSON_Status return_code = JSONSuccess;
-    FILE *fp = NULL;
-    char *serialized_string = json_serialize_to_string_pretty(parser, value);
-    if (serialized_string == NULL) {
+JSON_Status json_array_set_reserve(JSON_Parser const * parser, JSON_Array *array, size_t size) {
+    return json_array_resize(parser, array, size);
+}
+
+JSON_Status json_object_set_reserve(JSON_Parser const * parser, JSON_Object *object, size_t capacity) {
+    if (object == NULL || object->frozen) {
         return JSONFailure;
     }
-    fp = fopen(filename, "w");
-    if (fp == NULL) {
-        json_free_serialized_string(parser, serialized_string);
+    if (capacity < object->count) {
+        capacity = object->count; /* grow-only, like the table itself */
+    }
+    return json_object_ensure_item_capacity(parser, object, capacity);
+}
+
+JSON_Status json_array_pack_numbers(JSON_Parser const * parser, JSON_Array *array) {
+    double *numbers = NULL;
+    size_t i = 0;
+    if (array == NULL || array->frozen) {
         return JSONFailure;
     }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
+    if (array->numbers != NULL) {
+        return JSONSuccess;
     }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
+    if (array->count == 0) {
+        return JSONFailure; /* an empty column carries no type information */
     }
-    json_free_serialized_string(parser, serialized_string);
-    return return_code;
-}
-
-char * json_serialize_to_string_pretty(JSON_Parser const * parser, const JSON_Value *value) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size_pretty(parser, value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
+    for (i = 0; i < array->count; i++) {
+        if (json_value_get_type(array->items[i]) != JSONNumber) {
+            return JSONFailure;
+        }
     }
-    buf = (char*)parser->malloc_func(buf_size_bytes, parser->malloc_userdata);
-    if (buf == NULL) {
-        return NULL;
+    numbers = (double*)parson_malloc(parser, array->count * sizeof(double));
+    if (numbers == NULL) {
+        return JSONFailure;
     }
-    serialization_result = json_serialize_to_buffer_pretty(parser, value, buf, buf_size_bytes);
-    if (serialization_result != JSONSuccess) {
-        json_free_serialized_string(parser, buf);
-        return NULL;
+    for (i = 0; i < array->count; i++) {
+        numbers[i] = array->items[i]->value.number;
+        parson_free(parser, array->items[i]);
     }
-    return buf;
-}
-
-void json_free_serialized_string(JSON_Parser const * parser, char *string) {
-    parser->free_func(string, parser->malloc_userdata);
+    parson_free(parser, array->items);
+    array->items = NULL;
+    array->numbers = numbers;
+    array->capacity = array->count;
+    return JSONSuccess;
 }
 
-JSON_Status json_array_set_reserve(JSON_Parser const * parser, JSON_Array *array, size_t size) {
-    return json_array_resize(parser, array, size);
+JSON_Status json_array_get_number_span(const JSON_Array *array, const double **out_numbers, size_t *out_count) {
+    if (array == NULL || array->numbers == NULL || out_numbers == NULL || out_count == NULL) {
+        return JSONFailure;
+    }
+    *out_numbers = array->numbers;
+    *out_count = array->count;
+    return JSONSuccess;
 }
 
 JSON_Status json_array_remove(JSON_Parser const * parser, JSON_Array *array, size_t ix) {
     size_t to_move_bytes = 0;
-    if (array == NULL || ix >= json_array_get_count(array)) {
+    if (array == NULL || array->frozen || array->numbers != NULL || ix >= json_array_get_count(array)) {
         return JSONFailure;
     }
     json_value_free(parser, json_array_get_value(array, ix));
     to_move_bytes = (json_array_get_count(array) - 1 - ix) * sizeof(JSON_Value*);
     memmove(array->items + ix, array->items + ix + 1, to_move_bytes);
     array->count -= 1;
+    json_value_invalidate_hash(array->wrapping_value);
     return JSONSuccess;
 }
 
 JSON_Status json_array_replace_value(JSON_Parser const * parser, JSON_Array *array, size_t ix, JSON_Value *value) {
-    if (array == NULL || value == NULL || value->parent != NULL || ix >= json_array_get_count(array)) {
+    if (array == NULL || array->frozen || array->numbers != NULL || value == NULL || value->parent != NULL || ix >= json_array_get_count(array)) {
         return JSONFailure;
     }
     json_value_free(parser, json_array_get_value(array, ix));
     value->parent = json_array_get_wrapping_value(array);
     array->items[ix] = value;
+    json_value_invalidate_hash(array->wrapping_value);
     return JSONSuccess;
 }
 
@@ -1993,13 +5825,22 @@ JSON_Status json_array_replace_null(JSON_Parser const * parser, JSON_Array *arra
 
 JSON_Status json_array_clear(JSON_Parser const * parser, JSON_Array *array) {
     size_t i = 0;
-    if (array == NULL) {
+    if (array == NULL || array->frozen) {
         return JSONFailure;
     }
+    if (array->numbers != NULL) {
+        parson_free(parser, array->numbers);
+        array->numbers = NULL;
+        array->capacity = 0;
+        array->count = 0;
+        json_value_invalidate_hash(array->wrapping_value);
+        return JSONSuccess;
+    }
     for (i = 0; i < json_array_get_count(array); i++) {
         json_value_free(parser, json_array_get_value(array, i));
     }
     array->count = 0;
+    json_value_invalidate_hash(array->wrapping_value);
     return JSONSuccess;
 }
 
@@ -2070,26 +5911,67 @@ JSON_Status json_array_append_null(JSON_Parser const * parser, JSON_Array *array
     return JSONSuccess;
 }
 
+JSON_Status json_array_append_numbers(JSON_Parser const * parser, JSON_Array *array, const double *numbers, size_t count) {
+    size_t i = 0;
+    if (array == NULL || array->frozen || array->numbers != NULL || (numbers == NULL && count > 0)) {
+        return JSONFailure;
+    }
+    if (array->count + count > array->capacity &&
+        json_array_resize(parser, array, array->count + count) != JSONSuccess) {
+        return JSONFailure;
+    }
+    for (i = 0; i < count; i++) {
+        JSON_Value *value = json_value_init_number(parser, numbers[i]);
+        if (value == NULL || json_array_add(parser, array, value) != JSONSuccess) {
+            json_value_free(parser, value);
+            return JSONFailure;
+        }
+    }
+    return JSONSuccess;
+}
+
+JSON_Status json_array_append_strings(JSON_Parser const * parser, JSON_Array *array, const char **strings, size_t count) {
+    size_t i = 0;
+    if (array == NULL || array->frozen || array->numbers != NULL || (strings == NULL && count > 0)) {
+        return JSONFailure;
+    }
+    if (array->count + count > array->capacity &&
+        json_array_resize(parser, array, array->count + count) != JSONSuccess) {
+        return JSONFailure;
+    }
+    for (i = 0; i < count; i++) {
+        JSON_Value *value = json_value_init_string(parser, strings[i]);
+        if (value == NULL || json_array_add(parser, array, value) != JSONSuccess) {
+            json_value_free(parser, value);
+            return JSONFailure;
+        }
+    }
+    return JSONSuccess;
+}
+
 JSON_Status json_object_set_value(JSON_Parser const * parser, JSON_Object *object, const char *name, JSON_Value *value) {
     unsigned long hash = 0;
     parson_bool_t found = PARSON_FALSE;
     size_t cell_ix = 0;
     size_t item_ix = 0;
+    size_t name_len = 0;
     JSON_Value *old_value = NULL;
     char *key_copy = NULL;
 
-    if (!object || !name || !value || value->parent) {
+    if (!object || !name || !value || value->parent || object->frozen) {
         return JSONFailure;
     }
-    hash = hash_string(name, strlen(name));
+    name_len = strlen(name);
+    hash = hash_string(name, name_len);
     found = PARSON_FALSE;
-    cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
+    cell_ix = json_object_get_cell_ix(object, name, name_len, hash, &found);
     if (found) {
-        item_ix = object->cells[cell_ix];
+        item_ix = object->cells[cell_ix].item_ix;
         old_value = object->values[item_ix];
         json_value_free(parser, old_value);
         object->values[item_ix] = value;
         value->parent = json_object_get_wrapping_value(object);
+        json_value_invalidate_hash(object->wrapping_value);
         return JSONSuccess;
     }
     if (object->count >= object->item_capacity) {
@@ -2097,19 +5979,20 @@ JSON_Status json_object_set_value(JSON_Parser const * parser, JSON_Object *objec
         if (res != JSONSuccess) {
             return JSONFailure;
         }
-        cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
+        cell_ix = json_object_get_cell_ix(object, name, name_len, hash, &found);
     }
-    key_copy = parson_strdup(parser, name);
+    key_copy = json_object_key_copy(parser, name, name_len, hash);
     if (!key_copy) {
         return JSONFailure;
     }
     object->names[object->count] = key_copy;
-    object->cells[cell_ix] = object->count;
+    json_object_fill_cell(&object->cells[cell_ix], object->count, key_copy, name_len, hash);
     object->values[object->count] = value;
     object->cell_ixs[object->count] = cell_ix;
     object->hashes[object->count] = hash;
     object->count++;
     value->parent = json_object_get_wrapping_value(object);
+    json_value_invalidate_hash(object->wrapping_value);
     return JSONSuccess;
 }
 
@@ -2158,6 +6041,24 @@ JSON_Status json_object_set_null(JSON_Parser const * parser, JSON_Object *object
     return status;
 }
 
+JSON_Status json_object_set_values(JSON_Parser const * parser, JSON_Object *object, const char **names, JSON_Value **values, size_t count) {
+    size_t i = 0;
+    if (object == NULL || object->frozen || ((names == NULL || values == NULL) && count > 0)) {
+        return JSONFailure;
+    }
+    /* duplicates of existing keys make this an upper bound, which only costs
+       some spare capacity */
+    if (json_object_ensure_item_capacity(parser, object, object->count + count) != JSONSuccess) {
+        return JSONFailure;
+    }
+    for (i = 0; i < count; i++) {
+        if (json_object_set_value(parser, object, names[i], values[i]) != JSONSuccess) {
+            return JSONFailure; /* values[i..count-1] remain owned by the caller */
+        }
+    }
+    return JSONSuccess;
+}
+
 JSON_Status json_object_dotset_value(JSON_Parser const * parser, JSON_Object *object, const char *name, JSON_Value *value) {
     const char *dot_pos = NULL;
     JSON_Value *temp_value = NULL, *new_value = NULL;
@@ -2165,7 +6066,8 @@ JSON_Status json_object_dotset_value(JSON_Parser const * parser, JSON_Object *ob
     JSON_Status status = JSONFailure;
     size_t name_len = 0;
     char *name_copy = NULL;
-    
+    unsigned long name_hash = 0;
+
     if (object == NULL || name == NULL || value == NULL) {
         return JSONFailure;
     }
@@ -2193,15 +6095,18 @@ JSON_Status json_object_dotset_value(JSON_Parser const * parser, JSON_Object *ob
         json_value_free(parser, new_value);
         return JSONFailure;
     }
-    name_copy = parson_strndup(parser, name, name_len);
+    name_hash = hash_string(name, name_len);
+    name_copy = json_object_key_copy(parser, name, name_len, name_hash);
     if (!name_copy) {
         json_object_dotremove_internal(parser, new_object, dot_pos + 1, 0);
         json_value_free(parser, new_value);
         return JSONFailure;
     }
-    status = json_object_add(parser, object, name_copy, new_value);
+    status = json_object_add_with_hash(parser, object, name_copy, name_hash, new_value);
     if (status != JSONSuccess) {
-        parser->free_func(name_copy, parser->malloc_userdata);
+        if (parser->intern_pool == NULL) {
+            parson_free(parser, name_copy);
+        }
         json_object_dotremove_internal(parser, new_object, dot_pos + 1, 0);
         json_value_free(parser, new_value);
         return JSONFailure;
@@ -2279,11 +6184,13 @@ JSON_Status json_object_dotremove(JSON_Parser const * parser, JSON_Object *objec
 
 JSON_Status json_object_clear(JSON_Parser const * parser, JSON_Object *object) {
     size_t i = 0;
-    if (object == NULL) {
+    if (object == NULL || object->frozen) {
         return JSONFailure;
     }
     for (i = 0; i < json_object_get_count(object); i++) {
-        parser->free_func(object->names[i], parser->malloc_userdata);
+        if (object->owns_keys) {
+            parson_free(parser, object->names[i]);
+        }
         object->names[i] = NULL;
         
         json_value_free(parser, object->values[i]);
@@ -2291,8 +6198,9 @@ JSON_Status json_object_clear(JSON_Parser const * parser, JSON_Object *object) {
     }
     object->count = 0;
     for (i = 0; i < object->cell_capacity; i++) {
-        object->cells[i] = OBJECT_INVALID_IX;
+        object->cells[i].item_ix = OBJECT_INVALID_IX;
     }
+    json_value_invalidate_hash(object->wrapping_value);
     return JSONSuccess;
 }
 
@@ -2356,69 +6264,566 @@ JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value) {
     }
 }
 
-int json_value_equals(const JSON_Value *a, const JSON_Value *b) {
-    JSON_Object *a_object = NULL, *b_object = NULL;
-    JSON_Array *a_array = NULL, *b_array = NULL;
-    const JSON_String *a_string = NULL, *b_string = NULL;
-    const char *key = NULL;
-    size_t a_count = 0, b_count = 0, i = 0;
-    JSON_Value_Type a_type, b_type;
-    a_type = json_value_get_type(a);
-    b_type = json_value_get_type(b);
-    if (a_type != b_type) {
-        return PARSON_FALSE;
+/* Compiled schema validation */
+
+typedef struct json_schema_node {
+    JSON_Value_Type type;      /* JSONNull accepts values of every type */
+    const char   *key;         /* key in the parent object; NULL for the root and array elements */
+    size_t        key_len;
+    unsigned long hash;        /* precomputed key hash */
+    size_t        first_child; /* children occupy contiguous node indices */
+    size_t        child_count;
+} JSON_Schema_Node;
+
+struct json_compiled_schema {
+    JSON_Parser parser;        /* allocator for schema memory, captured at compile */
+    JSON_Schema_Node *nodes;   /* nodes[0] is the root; the table and key bytes share one block */
+    size_t count;
+};
+
+JSON_Compiled_Schema * json_schema_compile(JSON_Parser const * parser, const JSON_Value *schema_value) {
+    JSON_Compiled_Schema *schema = NULL;
+    JSON_Schema_Node *nodes = NULL;
+    const JSON_Value **srcs = NULL;
+    char *key_buf = NULL;
+    const JSON_Value **work = NULL;
+    size_t work_count = 0;
+    size_t work_capacity = 0;
+    const JSON_Value *current = NULL;
+    size_t node_count = 1;
+    size_t key_bytes = 0;
+    size_t next_free = 1;
+    size_t i = 0, j = 0;
+
+    if (parser == NULL || schema_value == NULL || json_value_get_type(schema_value) == JSONError) {
+        return NULL;
     }
-    switch (a_type) {
-        case JSONArray:
-            a_array = json_value_get_array(a);
-            b_array = json_value_get_array(b);
-            a_count = json_array_get_count(a_array);
-            b_count = json_array_get_count(b_array);
-            if (a_count != b_count) {
-                return PARSON_FALSE;
+    /* first pass counts nodes and key bytes, second pass fills the single
+       block allocated between the passes */
+    current = schema_value;
+    while (current != NULL) {
+        size_t child_count = 0;
+        JSON_Value **children = NULL;
+        switch (json_value_get_type(current)) {
+            case JSONObject: {
+                const JSON_Object *object = current->value.object;
+                for (j = 0; j < object->count; j++) {
+                    key_bytes += strlen(object->names[j]) + 1;
+                }
+                node_count += object->count;
+                child_count = object->count;
+                children = object->values;
+                break;
             }
-            for (i = 0; i < a_count; i++) {
-                if (!json_value_equals(json_array_get_value(a_array, i),
-                                       json_array_get_value(b_array, i))) {
-                    return PARSON_FALSE;
+            case JSONArray: {
+                const JSON_Array *array = current->value.array;
+                node_count += array->count;
+                if (array->numbers == NULL) { /* packed elements become leaf nodes directly */
+                    child_count = array->count;
+                    children = array->items;
                 }
+                break;
             }
-            return PARSON_TRUE;
-        case JSONObject:
-            a_object = json_value_get_object(a);
-            b_object = json_value_get_object(b);
-            a_count = json_object_get_count(a_object);
-            b_count = json_object_get_count(b_object);
-            if (a_count != b_count) {
-                return PARSON_FALSE;
+            default:
+                break;
+        }
+        for (j = 0; j < child_count; j++) {
+            if (work_count >= work_capacity) {
+                size_t new_capacity = work_capacity ? work_capacity * 2 : STARTING_CAPACITY;
+                const JSON_Value **new_work = (const JSON_Value**)parson_malloc(parser, new_capacity * sizeof(JSON_Value*));
+                if (new_work == NULL) {
+                    parson_free(parser, work);
+                    return NULL;
+                }
+                if (work_count > 0) {
+                    memcpy(new_work, work, work_count * sizeof(JSON_Value*));
+                }
+                parson_free(parser, work);
+                work = new_work;
+                work_capacity = new_capacity;
+            }
+            work[work_count++] = children[j];
+        }
+        current = work_count > 0 ? work[--work_count] : NULL;
+    }
+    parson_free(parser, work);
+
+    schema = (JSON_Compiled_Schema*)parson_malloc(parser, sizeof(JSON_Compiled_Schema)
+        + node_count * sizeof(JSON_Schema_Node) + key_bytes);
+    if (schema == NULL) {
+        return NULL;
+    }
+    nodes = (JSON_Schema_Node*)(schema + 1);
+    key_buf = (char*)(nodes + node_count);
+    /* scratch map from node index to its schema value; children are laid out
+       breadth-first so processing nodes in index order visits parents first */
+    srcs = (const JSON_Value**)parson_malloc(parser, node_count * sizeof(JSON_Value*));
+    if (srcs == NULL) {
+        parson_free(parser, schema);
+        return NULL;
+    }
+    nodes[0].key = NULL;
+    nodes[0].key_len = 0;
+    nodes[0].hash = 0;
+    srcs[0] = schema_value;
+    for (i = 0; i < node_count; i++) {
+        JSON_Schema_Node *node = &nodes[i];
+        current = srcs[i];
+        node->first_child = 0;
+        node->child_count = 0;
+        if (current == NULL) {
+            continue; /* element of a packed schema array, typed when the parent was processed */
+        }
+        node->type = json_value_get_type(current);
+        if (node->type == JSONObject) {
+            const JSON_Object *object = current->value.object;
+            node->first_child = next_free;
+            node->child_count = object->count;
+            for (j = 0; j < object->count; j++) {
+                JSON_Schema_Node *child = &nodes[next_free + j];
+                size_t key_len = strlen(object->names[j]);
+                memcpy(key_buf, object->names[j], key_len + 1);
+                child->key = key_buf;
+                child->key_len = key_len;
+                child->hash = object->hashes[j];
+                key_buf += key_len + 1;
+                srcs[next_free + j] = object->values[j];
             }
-            for (i = 0; i < a_count; i++) {
-                key = json_object_get_name(a_object, i);
-                if (!json_value_equals(json_object_get_value(a_object, key),
-                                       json_object_get_value(b_object, key))) {
-                    return PARSON_FALSE;
+            next_free += object->count;
+        } else if (node->type == JSONArray) {
+            const JSON_Array *array = current->value.array;
+            node->first_child = next_free;
+            node->child_count = array->count;
+            for (j = 0; j < array->count; j++) {
+                JSON_Schema_Node *child = &nodes[next_free + j];
+                child->key = NULL;
+                child->key_len = 0;
+                child->hash = 0;
+                if (array->numbers != NULL) {
+                    child->type = JSONNumber;
+                    child->first_child = 0;
+                    child->child_count = 0;
+                    srcs[next_free + j] = NULL;
+                } else {
+                    srcs[next_free + j] = array->items[j];
                 }
             }
-            return PARSON_TRUE;
-        case JSONString:
-            a_string = json_value_get_string_desc(a);
-            b_string = json_value_get_string_desc(b);
-            if (a_string == NULL || b_string == NULL) {
-                return PARSON_FALSE; /* shouldn't happen */
+            next_free += array->count;
+        }
+    }
+    parson_free(parser, srcs);
+    schema->parser = *parser;
+    schema->nodes = nodes;
+    schema->count = node_count;
+    return schema;
+}
+
+void json_schema_free(JSON_Compiled_Schema *schema) {
+    if (schema == NULL) {
+        return;
+    }
+    parson_free(&schema->parser, schema);
+}
+
+typedef struct json_schema_pair {
+    size_t node_ix;
+    const JSON_Value *value;
+} JSON_Schema_Pair;
+
+/* Iterative node check with the usual scratch-stack pattern: pairs that can't
+   be queued when growing the stack fails are validated through a re-entrant
+   call instead. */
+static JSON_Status json_schema_validate_node(const JSON_Compiled_Schema *schema, size_t start_ix, const JSON_Value *start_value) {
+    JSON_Parser const * parser = &schema->parser;
+    JSON_Schema_Pair *work = NULL;
+    size_t work_count = 0;
+    size_t work_capacity = 0;
+    size_t node_ix = start_ix;
+    const JSON_Value *value = start_value;
+    JSON_Status res = JSONSuccess;
+    for (;;) {
+        const JSON_Schema_Node *node = &schema->nodes[node_ix];
+        size_t i = 0, pair_total = 0;
+        if (node->type != JSONNull) { /* null accepts every type */
+            if (node->type != json_value_get_type(value)) {
+                res = JSONFailure;
+                break;
+            }
+            if (node->type == JSONObject) {
+                pair_total = node->child_count;
+            } else if (node->type == JSONArray && node->child_count > 0) {
+                const JSON_Array *array = value->value.array;
+                if (array->numbers != NULL) {
+                    /* packed document arrays hold only numbers, so checking
+                       the applicable element schemas needs no member pairs */
+                    size_t used = array->count < node->child_count ? array->count : node->child_count;
+                    for (i = 0; i < used; i++) {
+                        const JSON_Schema_Node *child = &schema->nodes[node->first_child + i];
+                        if (child->type != JSONNumber && child->type != JSONNull) {
+                            res = JSONFailure;
+                            break;
+                        }
+                    }
+                } else {
+                    pair_total = array->count;
+                }
+            }
+        }
+        for (i = 0; i < pair_total && res == JSONSuccess; i++) {
+            size_t child_ix = 0;
+            const JSON_Value *member = NULL;
+            if (node->type == JSONObject) {
+                const JSON_Schema_Node *child = &schema->nodes[node->first_child + i];
+                child_ix = node->first_child + i;
+                member = json_object_getn_value_with_hash(value->value.object, child->key, child->key_len, child->hash);
+                if (member == NULL) {
+                    res = JSONFailure;
+                    break;
+                }
+            } else {
+                /* the last element schema repeats for the rest of the array */
+                size_t schema_ix = i < node->child_count ? i : node->child_count - 1;
+                child_ix = node->first_child + schema_ix;
+                member = value->value.array->items[i];
+            }
+            if (work_count >= work_capacity) {
+                size_t new_capacity = work_capacity ? work_capacity * 2 : STARTING_CAPACITY;
+                JSON_Schema_Pair *new_work = (JSON_Schema_Pair*)parson_malloc(parser, new_capacity * sizeof(JSON_Schema_Pair));
+                if (new_work == NULL) {
+                    if (json_schema_validate_node(schema, child_ix, member) != JSONSuccess) { /* can't queue it - recurse */
+                        res = JSONFailure;
+                    }
+                    continue;
+                }
+                if (work_count > 0) {
+                    memcpy(new_work, work, work_count * sizeof(JSON_Schema_Pair));
+                }
+                parson_free(parser, work);
+                work = new_work;
+                work_capacity = new_capacity;
             }
-            return a_string->length == b_string->length &&
-                   memcmp(a_string->chars, b_string->chars, a_string->length) == 0;
+            work[work_count].node_ix = child_ix;
+            work[work_count].value = member;
+            work_count++;
+        }
+        if (res != JSONSuccess || work_count == 0) {
+            break;
+        }
+        work_count--;
+        node_ix = work[work_count].node_ix;
+        value = work[work_count].value;
+    }
+    parson_free(parser, work);
+    return res;
+}
+
+JSON_Status json_validate_compiled(const JSON_Compiled_Schema *schema, const JSON_Value *value) {
+    if (schema == NULL || value == NULL) {
+        return JSONFailure;
+    }
+    return json_schema_validate_node(schema, 0, value);
+}
+
+/* Comparison is iterative: container members are queued as pairs on a scratch
+   stack instead of being compared through recursion, so deep trees don't
+   overflow the call stack. The scratch comes from the stdlib allocator since
+   this function takes no parser; it is transient and freed before returning.
+   If growing the scratch fails, the offending pair is compared through a
+   re-entrant call, degrading gracefully towards the old recursive behavior. */
+/* Structural hashing for cheap inequality checks. The hash is defined over
+   the logical content json_value_equals compares: object members contribute
+   order-independently, array elements in order, and packed number arrays hash
+   identically to their unpacked form. Numbers contribute only their presence,
+   keeping the hash consistent with the comparison's numeric tolerance - two
+   trees that json_value_equals calls equal always hash alike. Container
+   hashes are cached and dropped again by any mutation underneath them. */
+
+#define PARSON_HASH_SEED_NULL    0x9e3779b9UL
+#define PARSON_HASH_SEED_BOOLEAN 0x85ebca6bUL
+#define PARSON_HASH_SEED_NUMBER  0xc2b2ae35UL
+#define PARSON_HASH_SEED_STRING  0x27d4eb2fUL
+#define PARSON_HASH_SEED_ARRAY   0x165667b1UL
+#define PARSON_HASH_SEED_OBJECT  0xd3a2646cUL
+
+static unsigned long json_value_hash_scalar(const JSON_Value *value) {
+    switch (value->type) {
         case JSONBoolean:
-            return json_value_get_boolean(a) == json_value_get_boolean(b);
+            return PARSON_HASH_SEED_BOOLEAN ^ (unsigned long)(value->value.boolean ? 0x5555UL : 0xaaaaUL);
         case JSONNumber:
-            return fabs(json_value_get_number(a) - json_value_get_number(b)) < 0.000001; /* EPSILON */
-        case JSONError:
-            return PARSON_TRUE;
-        case JSONNull:
-            return PARSON_TRUE;
+            return PARSON_HASH_SEED_NUMBER;
+        case JSONString:
+            return PARSON_HASH_SEED_STRING ^ hash_string(value->value.string.chars, value->value.string.length);
         default:
-            return PARSON_TRUE;
+            return PARSON_HASH_SEED_NULL;
+    }
+}
+
+typedef struct json_hash_frame {
+    const JSON_Value *value;
+    size_t child_ix;
+    unsigned long acc;
+    unsigned long key_hash; /* this member's key hash, folded into the parent object's sum */
+} JSON_Hash_Frame;
+
+unsigned long json_value_hash(const JSON_Value *value) {
+    JSON_Hash_Frame *stack = NULL;
+    size_t stack_count = 0;
+    size_t stack_capacity = 0;
+    unsigned long result = 0;
+    JSON_Value_Type type = json_value_get_type(value);
+
+    if (value == NULL || type == JSONError) {
+        return 0;
+    }
+    if (type != JSONObject && type != JSONArray) {
+        result = json_value_hash_scalar(value);
+        return result != 0 ? result : 1;
+    }
+    stack_capacity = STARTING_CAPACITY;
+    stack = (JSON_Hash_Frame*)default_malloc(stack_capacity * sizeof(JSON_Hash_Frame), NULL);
+    if (stack == NULL) {
+        return 0;
     }
+    stack[0].value = value;
+    stack[0].child_ix = 0;
+    stack[0].acc = 0;
+    stack[0].key_hash = 0;
+    stack_count = 1;
+    while (stack_count > 0) {
+        JSON_Hash_Frame *top = &stack[stack_count - 1];
+        const JSON_Value *child = NULL;
+        unsigned long child_hash = 0;
+        unsigned long key_hash = 0;
+        parson_bool_t is_object = (json_value_get_type(top->value) == JSONObject);
+        size_t count = 0;
+
+        if (is_object) {
+            const JSON_Object *object = top->value->value.object;
+            count = object->count;
+            if (top->child_ix == 0) {
+                if (object->cached_hash != 0) {
+                    child_hash = object->cached_hash;
+                    goto finished;
+                }
+                top->acc = PARSON_HASH_SEED_OBJECT ^ (unsigned long)count;
+            }
+            if (top->child_ix < count) {
+                child = object->values[top->child_ix];
+                key_hash = object->hashes[top->child_ix];
+            }
+        } else {
+            const JSON_Array *array = top->value->value.array;
+            count = array->count;
+            if (top->child_ix == 0) {
+                if (array->cached_hash != 0) {
+                    child_hash = array->cached_hash;
+                    goto finished;
+                }
+                top->acc = PARSON_HASH_SEED_ARRAY ^ (unsigned long)count;
+                if (array->numbers != NULL) { /* same hash as the unpacked form */
+                    size_t i = 0;
+                    for (i = 0; i < count; i++) {
+                        top->acc = top->acc * 1099087573UL + PARSON_HASH_SEED_NUMBER;
+                    }
+                    count = 0; /* no child values to visit */
+                }
+            } else if (array->numbers != NULL) {
+                count = 0;
+            }
+            if (top->child_ix < count) {
+                child = array->items[top->child_ix];
+            }
+        }
+
+        if (child != NULL) {
+            JSON_Value_Type child_type = json_value_get_type(child);
+            top->child_ix++;
+            if (child_type != JSONObject && child_type != JSONArray) {
+                child_hash = json_value_hash_scalar(child);
+                if (is_object) {
+                    top->acc += key_hash ^ child_hash; /* order-independent member sum */
+                } else {
+                    top->acc = top->acc * 1099087573UL + child_hash;
+                }
+                continue;
+            }
+            if (stack_count >= stack_capacity) {
+                size_t new_capacity = stack_capacity * 2;
+                JSON_Hash_Frame *new_stack = (JSON_Hash_Frame*)default_malloc(new_capacity * sizeof(JSON_Hash_Frame), NULL);
+                if (new_stack == NULL) {
+                    default_free(stack, NULL);
+                    return 0;
+                }
+                memcpy(new_stack, stack, stack_count * sizeof(JSON_Hash_Frame));
+                default_free(stack, NULL);
+                stack = new_stack;
+                stack_capacity = new_capacity;
+            }
+            stack[stack_count].value = child;
+            stack[stack_count].child_ix = 0;
+            stack[stack_count].acc = 0;
+            stack[stack_count].key_hash = key_hash;
+            stack_count++;
+            continue;
+        }
+
+        /* all children folded in - finalize, cache and pass the hash up */
+        child_hash = top->acc != 0 ? top->acc : 1;
+        if (is_object) {
+            top->value->value.object->cached_hash = child_hash;
+        } else {
+            top->value->value.array->cached_hash = child_hash;
+        }
+finished:
+        key_hash = top->key_hash;
+        stack_count--;
+        if (stack_count == 0) {
+            result = child_hash;
+            break;
+        }
+        top = &stack[stack_count - 1];
+        if (json_value_get_type(top->value) == JSONObject) {
+            top->acc += key_hash ^ child_hash;
+        } else {
+            top->acc = top->acc * 1099087573UL + child_hash;
+        }
+    }
+    default_free(stack, NULL);
+    return result;
+}
+
+/* Reads element 'ix' as a double whether or not the array is packed; fails
+   when an unpacked element is not a number. */
+static parson_bool_t json_array_number_at(const JSON_Array *array, size_t ix, double *out_number) {
+    if (array->numbers != NULL) {
+        *out_number = array->numbers[ix];
+        return PARSON_TRUE;
+    }
+    if (json_value_get_type(array->items[ix]) != JSONNumber) {
+        return PARSON_FALSE;
+    }
+    *out_number = array->items[ix]->value.number;
+    return PARSON_TRUE;
+}
+
+int json_value_equals(const JSON_Value *a, const JSON_Value *b) {
+    const JSON_Value **pairs = NULL;
+    size_t pair_count = 0;
+    size_t pair_capacity = 0;
+    int result = PARSON_TRUE;
+    const JSON_Value *cur_a = a, *cur_b = b;
+    for (;;) {
+        JSON_Object *a_object = NULL, *b_object = NULL;
+        JSON_Array *a_array = NULL, *b_array = NULL;
+        const JSON_String *a_string = NULL, *b_string = NULL;
+        const char *key = NULL;
+        size_t a_count = 0, b_count = 0, i = 0;
+        JSON_Value_Type a_type, b_type;
+        a_type = json_value_get_type(cur_a);
+        b_type = json_value_get_type(cur_b);
+        if (a_type != b_type) {
+            result = PARSON_FALSE;
+            break;
+        }
+        switch (a_type) {
+            case JSONArray:
+            case JSONObject: {
+                unsigned long a_hash = 0, b_hash = 0;
+                if (a_type == JSONArray) {
+                    a_array = json_value_get_array(cur_a);
+                    b_array = json_value_get_array(cur_b);
+                    a_count = json_array_get_count(a_array);
+                    b_count = json_array_get_count(b_array);
+                    a_hash = a_array->cached_hash;
+                    b_hash = b_array->cached_hash;
+                } else {
+                    a_object = json_value_get_object(cur_a);
+                    b_object = json_value_get_object(cur_b);
+                    a_count = json_object_get_count(a_object);
+                    b_count = json_object_get_count(b_object);
+                    a_hash = a_object->cached_hash;
+                    b_hash = b_object->cached_hash;
+                }
+                if (a_hash != 0 && b_hash != 0 && a_hash != b_hash) {
+                    result = PARSON_FALSE; /* already-computed hashes reject without a walk */
+                    break;
+                }
+                if (a_count != b_count) {
+                    result = PARSON_FALSE;
+                    break;
+                }
+                if (a_type == JSONArray && (a_array->numbers != NULL || b_array->numbers != NULL)) {
+                    /* packed arrays have no member values to queue - compare
+                       the numbers directly */
+                    for (i = 0; i < a_count && result; i++) {
+                        double num_a = 0, num_b = 0;
+                        if (!json_array_number_at(a_array, i, &num_a)
+                            || !json_array_number_at(b_array, i, &num_b)) {
+                            result = PARSON_FALSE;
+                            break;
+                        }
+                        result = fabs(num_a - num_b) < 0.000001; /* EPSILON */
+                    }
+                    break;
+                }
+                for (i = 0; i < a_count && result; i++) {
+                    const JSON_Value *member_a = NULL, *member_b = NULL;
+                    if (a_type == JSONArray) {
+                        member_a = json_array_get_value(a_array, i);
+                        member_b = json_array_get_value(b_array, i);
+                    } else {
+                        key = json_object_get_name(a_object, i);
+                        member_a = json_object_get_value(a_object, key);
+                        member_b = json_object_get_value(b_object, key); /* NULL for a missing key fails the type check */
+                    }
+                    if (pair_count + 2 > pair_capacity) {
+                        size_t new_capacity = pair_capacity ? pair_capacity * 2 : STARTING_CAPACITY;
+                        const JSON_Value **new_pairs = (const JSON_Value**)default_malloc(new_capacity * sizeof(JSON_Value*), NULL);
+                        if (new_pairs == NULL) {
+                            result = json_value_equals(member_a, member_b); /* can't queue the pair - compare it now */
+                            continue;
+                        }
+                        if (pair_count > 0) {
+                            memcpy(new_pairs, pairs, pair_count * sizeof(JSON_Value*));
+                        }
+                        default_free(pairs, NULL);
+                        pairs = new_pairs;
+                        pair_capacity = new_capacity;
+                    }
+                    pairs[pair_count++] = member_a;
+                    pairs[pair_count++] = member_b;
+                }
+                break;
+            }
+            case JSONString:
+                a_string = json_value_get_string_desc(cur_a);
+                b_string = json_value_get_string_desc(cur_b);
+                if (a_string == NULL || b_string == NULL) {
+                    result = PARSON_FALSE; /* shouldn't happen */
+                    break;
+                }
+                result = a_string->length == b_string->length &&
+                         memcmp(a_string->chars, b_string->chars, a_string->length) == 0;
+                break;
+            case JSONBoolean:
+                result = json_value_get_boolean(cur_a) == json_value_get_boolean(cur_b);
+                break;
+            case JSONNumber:
+                result = fabs(json_value_get_number(cur_a) - json_value_get_number(cur_b)) < 0.000001; /* EPSILON */
+                break;
+            case JSONError:
+            case JSONNull:
+            default:
+                break;
+        }
+        if (!result || pair_count == 0) {
+            break;
+        }
+        cur_b = pairs[--pair_count];
+        cur_a = pairs[--pair_count];
+    }
+    default_free(pairs, NULL);
+    return result;
 }
 
 JSON_Value_Type json_type(const JSON_Value *value) {
@@ -2454,8 +6859,17 @@ JSON_Parser json_get_default_parser() {
     parser.malloc_func = default_malloc;
     parser.free_func = default_free;
     parser.malloc_userdata = NULL;
-    parser.float_fmt_str = PARSON_DEFAULT_FLOAT_FORMAT;
+    parser.float_fmt_str = NULL; /* numbers go through the built-in shortest round-trip formatter */
     parser.number_serialization_func = NULL;
     parser.escape_slashes = 1;
+    parser.skip_utf8_validation = 0;
+    parser.max_nesting = MAX_NESTING;
+    parser.intern_pool = NULL;
+    parser.stats = NULL;
+    parser.pack_number_arrays = 0;
+    parser.allow_comments = 0;
+    parser.parse_thread_count = 0;
+    parser.serialize_thread_count = 0;
+    parser.object_load_factor = 0;
     return parser;
 }
@@ -73,6 +73,28 @@ typedef void (*JSON_Free_Function)(void * ptr, void * userdata);
 */
 typedef int (*JSON_Number_Serialization_Function)(double num, char *buf);
 
+/* A sink for streamed serialization (see json_serialize_to_stream).
+   Receives consecutive chunks of output and should return 'len' on success;
+   any other return value aborts serialization. For a FILE* sink, wrap fwrite. */
+typedef size_t (*JSON_Stream_Write_Function)(const char *buffer, size_t len, void *user_data);
+
+typedef struct json_intern_pool JSON_Intern_Pool; /* see json_intern_pool_create */
+
+/* Counters filled in when a JSON_Stats struct is attached to a parser (see the
+   stats field). Zero-initialize before attaching; counters only ever grow, so
+   snapshot and subtract to meter a single operation. escaped_string_count out
+   of string_count gives the share of parsed strings that needed escape
+   processing; max_probe_length is the longest hash probe seen on an insert. */
+typedef struct json_stats {
+	size_t alloc_count;
+	size_t alloc_bytes;   /* sum of requested allocation sizes */
+	size_t free_count;
+	size_t rehash_count;  /* object hash tables grown */
+	size_t max_probe_length;
+	size_t string_count;  /* strings that went through escape processing */
+	size_t escaped_string_count;
+} JSON_Stats;
+
 /* Struct used to pass JSON parser config to parsing functions */
 struct JSON_Parser
 {
@@ -87,7 +109,9 @@ struct JSON_Parser
 
 	/* Sets float format used for serialization of numbers.
 	   Make sure it can't serialize to a string longer than PARSON_NUM_BUF_SIZE.
-	   If format is null then the default format is used. */
+	   If null, numbers are emitted by the built-in shortest round-trip
+	   formatter (Grisu2 with an integer fast path); set "%1.17g" to get the
+	   old sprintf output. */
 	char const * float_fmt_str;
 
 	/* Function that will be used for serialization of numbers.
@@ -96,6 +120,70 @@ struct JSON_Parser
 
 	/* Should slashes be escaped when serializing JSON? By default slashes are escaped. */
 	int escape_slashes;
+
+	/* Skip UTF-8 validation of strings passed to json_value_init_string and the
+	   json_*_set_string family. Useful when inputs were already validated upstream;
+	   the caller is then responsible for only feeding in valid UTF-8. Off by default. */
+	int skip_utf8_validation;
+
+	/* Maximum container nesting depth accepted by the parsers, 2048 by default.
+	   Parsing is iterative (it does not recurse per nesting level), so the limit
+	   can be raised safely for deep machine-generated documents; it mainly guards
+	   against unbounded memory use on adversarial input. */
+	size_t max_nesting;
+
+	/* Optional key intern pool (see json_intern_pool_create). When set, object
+	   keys are deduplicated through the pool: objects store shared pointers
+	   owned by the pool instead of per-object copies, and key hashes are reused
+	   instead of recomputed. Null by default. */
+	JSON_Intern_Pool * intern_pool;
+
+	/* Optional statistics sink. When set, allocation, hash-table and string
+	   processing counters are accumulated there (see JSON_Stats); when null
+	   the only cost is a pointer test per event. Null by default. */
+	JSON_Stats * stats;
+
+	/* Pack arrays whose elements are all numbers into a raw double column as
+	   the parsers close them (see json_array_pack_numbers). Packed arrays use
+	   a third of the memory and read contiguously, but are read-only and have
+	   no per-element JSON_Value: json_array_get_value returns null for them,
+	   while json_array_get_number and json_array_get_number_span read the
+	   column directly. Off by default. */
+	int pack_number_arrays;
+
+	/* Accept C ('slash-star') and C++ ('slash-slash') comments as whitespace in
+	   json_parse_string, json_parse_string_inplace and json_parse_file.
+	   Comments are skipped by the tokenizer in the same pass as whitespace, so
+	   no stripped copy of the input is made; the incremental feed parser does
+	   not support comments. Off by default;
+	   json_parse_string_with_comments/json_parse_file_with_comments are
+	   equivalent to setting it. */
+	int allow_comments;
+
+	/* Number of threads json_parse_string/json_parse_file may use to parse a
+	   large top-level array: a structural pre-scan splits the array at element
+	   boundaries and worker threads parse disjoint slices into the result
+	   array. Only effective when the library is built with
+	   PARSON_ENABLE_PARALLEL; inputs that aren't top-level arrays (or have
+	   comments enabled) parse sequentially as usual. The allocator must be
+	   thread-safe; stats and the intern pool are not updated by workers.
+	   0 (and 1) mean sequential, the default. */
+	size_t parse_thread_count;
+
+	/* Number of threads json_serialize_to_string/_to_buffer (and their pretty
+	   variants) may use: the top-level children of an array or object root are
+	   sized individually, assigned byte offsets, and serialized concurrently
+	   into disjoint ranges of the output. Only effective when the library is
+	   built with PARSON_ENABLE_PARALLEL; scalar roots and streaming
+	   serialization stay sequential. 0 (and 1) mean sequential, the default. */
+	size_t serialize_thread_count;
+
+	/* Object hash table load factor in percent: how full the cell array may
+	   get before a grow-and-rehash. 0 keeps the default (70); values are
+	   clamped to 10..90. Lower values trade memory for shorter probe chains,
+	   higher values pack churn-heavy session objects tighter between
+	   rehashes. Takes effect on the next rehash of an object. */
+	size_t object_load_factor;
 };
 
 typedef struct JSON_Parser JSON_Parser;
@@ -103,9 +191,70 @@ typedef struct JSON_Parser JSON_Parser;
 /* Default parser that uses malloc/free, JSON_DEFAULT_FLOAT_FORMAT and escape slashes */
 JSON_Parser json_get_default_parser();
 
-/* Parses first JSON value in a file, returns NULL in case of error */
+/* Arena allocator.
+   An arena hands out allocations from large growable blocks and releases them
+   all at once, so a whole parsed document can be torn down in O(1) instead of
+   one free per node. Use json_get_arena_parser to obtain a JSON_Parser whose
+   malloc_func/free_func are backed by the arena and pass it to any json_parse_*
+   or json_value_init_* function. Values allocated from an arena must not be
+   freed individually (json_value_free on them is a no-op); their lifetime ends
+   with json_arena_reset or json_arena_destroy. Don't mix values from an arena
+   parser and a regular parser in one tree. */
+typedef struct json_arena JSON_Arena;
+
+/* Creates an arena. Blocks are allocated with 'parser' (may be the default parser).
+   'block_size' is the granularity of the arena's internal blocks, 0 picks a sensible default. */
+JSON_Arena * json_arena_create(JSON_Parser const * parser, size_t block_size);
+
+/* Frees every allocation made from the arena in one go. The arena itself stays usable. */
+void json_arena_reset(JSON_Arena *arena);
+
+/* Frees every allocation made from the arena and the arena itself. */
+void json_arena_destroy(JSON_Arena *arena);
+
+/* Key intern pool.
+   Documents that share a fixed vocabulary of field names pay one key
+   allocation (and one hash computation) per object member per parse. A pool
+   deduplicates those keys: assign it to the parser's intern_pool field and
+   every object key parsed or set through that parser becomes a pointer into
+   the pool, allocated once when first seen. Attach the pool before creating
+   any values with the parser and keep it attached for their whole lifetime;
+   the pool must outlive every value that uses its keys, and it is not freed
+   by json_value_free. In-situ parsing ignores the pool (its keys already
+   avoid allocation). Create the pool with the same allocator as the parser
+   it is attached to. */
+JSON_Intern_Pool * json_intern_pool_create(JSON_Parser const * parser);
+
+/* Frees all interned keys and the pool itself. Only call this after every
+   value parsed or built with the pool attached has been freed. */
+void json_intern_pool_destroy(JSON_Intern_Pool *pool);
+
+/* Parser that allocates from 'arena' and inherits all other settings from the
+   parser the arena was created with. */
+JSON_Parser json_get_arena_parser(JSON_Arena *arena);
+
+/* Makes sure the arena can serve at least 'bytes' of further allocations from
+   one block, growing it by a single block allocation if needed. */
+JSON_Status json_arena_reserve(JSON_Arena *arena, size_t bytes);
+
+/* Deep copy sized up front: a measuring pass sums what the clone needs, one
+   arena block is reserved, then the copy fills right-sized containers without
+   any growth reallocation - much faster than json_value_deep_copy for large
+   trees. The clone is owned by the arena and is freed by json_arena_reset or
+   json_arena_destroy like any other arena value. */
+JSON_Value * json_value_deep_copy_bulk(JSON_Arena *arena, const JSON_Value *value);
+
+/* Parses first JSON value in a file, returns NULL in case of error.
+   Memory-maps the file where the platform supports it (falling back to a
+   regular buffered read), so parsing doesn't need a heap copy of the input. */
 JSON_Value * json_parse_file(JSON_Parser const * parser, const char *filename);
 
+/* Same as json_parse_file but only uses the memory-mapped path; returns NULL
+   when the file can't be mapped (on platforms without mmap support it behaves
+   exactly like json_parse_file). Define PARSON_DISABLE_MMAP to compile out the
+   mapping code entirely. */
+JSON_Value * json_parse_file_mmap(JSON_Parser const * parser, const char *filename);
+
 /* Parses first JSON value in a file and ignores comments (/ * * / and //),
    returns NULL in case of error */
 JSON_Value * json_parse_file_with_comments(JSON_Parser const * parser, const char *filename);
@@ -117,20 +266,87 @@ JSON_Value * json_parse_string(JSON_Parser const * parser, const char *string);
 	returns NULL in case of error */
 JSON_Value * json_parse_string_with_comments(JSON_Parser const * parser, const char *string);
 
+/*  Parses first JSON value in a mutable, null-terminated buffer, returns NULL in case of error.
+	The parse is destructive and zero-copy: string values and object keys are unescaped
+	in place and point into 'buffer', so 'buffer' has to outlive the returned value and
+	must not be modified while it is in use. Only the JSON_Value nodes and object/array
+	tables are allocated; json_value_free leaves the buffer contents alone. The returned
+	tree has to be treated as read-only: objects parsed in place don't own their keys,
+	so keys added to them later through the json_*_set APIs would not be released. */
+JSON_Value * json_parse_string_inplace(JSON_Parser const * parser, char *buffer);
+
+/* Streaming (SAX-style) event parsing.
+   json_parse_events walks the input with the same grammar as json_parse_string
+   but never builds a JSON_Value tree: it reports what it sees through the
+   callbacks below and allocates nothing per node (a single scratch buffer is
+   reused for strings that contain escape sequences). Unneeded callbacks may be
+   left NULL. A callback returning anything but JSONSuccess aborts the parse,
+   which then returns JSONFailure.
+   Strings and keys handed to callbacks are only valid for the duration of the
+   callback and are not necessarily null-terminated - use the length. */
+typedef struct JSON_Event_Callbacks {
+	JSON_Status (*on_object_start)(void *userdata);
+	JSON_Status (*on_object_key)(void *userdata, const char *key, size_t len);
+	JSON_Status (*on_object_end)(void *userdata);
+	JSON_Status (*on_array_start)(void *userdata);
+	JSON_Status (*on_array_end)(void *userdata);
+	JSON_Status (*on_string)(void *userdata, const char *string, size_t len);
+	JSON_Status (*on_number)(void *userdata, double number);
+	JSON_Status (*on_boolean)(void *userdata, int boolean);
+	JSON_Status (*on_null)(void *userdata);
+} JSON_Event_Callbacks;
+
+JSON_Status json_parse_events(JSON_Parser const * parser, const char *string, const JSON_Event_Callbacks *callbacks, void *userdata);
+
+/* Incremental ("feed") parsing.
+   A JSON_Feed_Parser consumes a document in arbitrary chunks - no need to
+   buffer the complete input first - and builds the same JSON_Value tree as
+   json_parse_string. Feed chunks as they arrive, then call
+   json_feed_parser_finish to obtain the parsed value (NULL on malformed or
+   incomplete input). finish also resets the context so it can be reused for
+   the next document. Memory held by the context while parsing is bounded by
+   the largest single token, not by the document size. Unlike
+   json_parse_string, the input must not start with a UTF-8 BOM. */
+typedef struct json_feed_parser JSON_Feed_Parser;
+
+JSON_Feed_Parser * json_feed_parser_create(JSON_Parser const * parser);
+JSON_Status        json_feed_parser_feed(JSON_Feed_Parser *feed_parser, const char *chunk, size_t len);
+JSON_Value *       json_feed_parser_finish(JSON_Feed_Parser *feed_parser);
+void               json_feed_parser_destroy(JSON_Feed_Parser *feed_parser);
+
 /* Serialization */
 size_t      json_serialization_size(JSON_Parser const * parser, const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(JSON_Parser const * parser, const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
 JSON_Status json_serialize_to_file(JSON_Parser const * parser, const JSON_Value *value, const char *filename);
 char *      json_serialize_to_string(JSON_Parser const * parser, const JSON_Value *value);
 
+/* Streamed serialization. Output is formatted into a small fixed internal
+   buffer and handed to 'write_func' as it fills, so memory stays bounded no
+   matter how large the document is (json_serialize_to_file streams the same
+   way). 'user_data' is passed through to every write_func call. */
+JSON_Status json_serialize_to_stream(JSON_Parser const * parser, const JSON_Value *value, JSON_Stream_Write_Function write_func, void *user_data);
+
 /* Pretty serialization */
 size_t      json_serialization_size_pretty(JSON_Parser const * parser, const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer_pretty(JSON_Parser const * parser, const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
 JSON_Status json_serialize_to_file_pretty(JSON_Parser const * parser, const JSON_Value *value, const char *filename);
 char *      json_serialize_to_string_pretty(JSON_Parser const * parser, const JSON_Value *value);
+JSON_Status json_serialize_to_stream_pretty(JSON_Parser const * parser, const JSON_Value *value, JSON_Stream_Write_Function write_func, void *user_data);
 
 void        json_free_serialized_string(JSON_Parser const * parser, char *string); /* frees string from json_serialize_to_string and json_serialize_to_string_pretty */
 
+/* Snapshots write the in-memory tree into one relocatable offset-based blob so
+   it can be reloaded without tokenizing, string processing or per-node
+   allocation - useful for large configs parsed on every startup. The format is
+   tied to the build (word size, endianness); a mismatched or corrupted file
+   fails the load. Loaded trees live in a single allocation, behave like frozen
+   trees (read-only, all accessors work, deep copies are mutable) and must be
+   released with json_value_free_snapshot, never json_value_free. Passing a
+   value that did not come from json_value_load_snapshot there is undefined. */
+JSON_Status  json_value_save_snapshot(JSON_Parser const * parser, const JSON_Value *value, const char *filename);
+JSON_Value * json_value_load_snapshot(JSON_Parser const * parser, const char *filename);
+JSON_Status  json_value_free_snapshot(JSON_Parser const * parser, JSON_Value *value);
+
 /* Comparing */
 int  json_value_equals(const JSON_Value *a, const JSON_Value *b);
 
@@ -146,6 +362,18 @@ int  json_value_equals(const JSON_Value *a, const JSON_Value *b);
  */
 JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value);
 
+/* Compiled form of the same schema convention for validating many documents
+   against one schema: json_schema_compile flattens the schema into a
+   contiguous descriptor table with precomputed key hashes, so each
+   json_validate_compiled call walks only the document. Two deliberate
+   differences from json_validate: array schemas with several elements check
+   documents positionally (the last element schema repeats for the rest of the
+   array), and the schema tree may be freed after compiling. */
+typedef struct json_compiled_schema JSON_Compiled_Schema;
+JSON_Compiled_Schema * json_schema_compile(JSON_Parser const * parser, const JSON_Value *schema_value);
+void                   json_schema_free(JSON_Compiled_Schema *schema); /* uses the allocator captured at compile */
+JSON_Status            json_validate_compiled(const JSON_Compiled_Schema *schema, const JSON_Value *value);
+
 /*
  * JSON Object
  */
@@ -169,6 +397,16 @@ JSON_Array  * json_object_dotget_array  (const JSON_Object *object, const char *
 double        json_object_dotget_number (const JSON_Object *object, const char *name); /* returns 0 on fail */
 int           json_object_dotget_boolean(const JSON_Object *object, const char *name); /* returns -1 on fail */
 
+/* Compiled paths avoid re-parsing the dot path and re-hashing its segments on
+   every lookup, which pays off when the same path is evaluated against many
+   documents. On top of dot notation they support array indices in brackets,
+   e.g. "orders[0].lines[2].price". Compiling returns NULL on malformed paths;
+   the path is independent of any document and can be reused across them. */
+typedef struct json_path JSON_Path;
+JSON_Path *  json_path_compile  (JSON_Parser const * parser, const char *dotpath);
+void         json_path_free     (JSON_Path *path); /* uses the allocator captured at compile */
+JSON_Value * json_path_get_value(const JSON_Path *path, const JSON_Object *object);
+
 /* Functions to get available names */
 size_t        json_object_get_count   (const JSON_Object *object);
 const char  * json_object_get_name    (const JSON_Object *object, size_t index);
@@ -192,6 +430,17 @@ JSON_Status json_object_set_number(JSON_Parser const * parser, JSON_Object *obje
 JSON_Status json_object_set_boolean(JSON_Parser const * parser, JSON_Object *object, const char *name, int boolean);
 JSON_Status json_object_set_null(JSON_Parser const * parser, JSON_Object *object, const char *name);
 
+/* Sets 'count' name/value pairs from parallel arrays after growing the hash
+ * table to its final size in one rehash. Values follow json_object_set_value
+ * ownership: each successfully set value belongs to the object, and on failure
+ * the remaining (unset) values stay with the caller. */
+JSON_Status json_object_set_values(JSON_Parser const * parser, JSON_Object *object, const char **names, JSON_Value **values, size_t count);
+
+/* Grows the object's hash table in a single rehash so 'capacity' items fit
+   within the load factor; mirrors json_array_set_reserve for insert-heavy
+   workloads. Never shrinks. */
+JSON_Status json_object_set_reserve(JSON_Parser const * parser, JSON_Object *object, size_t capacity);
+
 /* Works like dotget functions, but creates whole hierarchy if necessary.
  * json_object_dotset_value does not copy passed value so it shouldn't be freed afterwards. */
 JSON_Status json_object_dotset_value(JSON_Parser const * parser, JSON_Object *object, const char *name, JSON_Value *value);
@@ -226,6 +475,18 @@ JSON_Value  * json_array_get_wrapping_value(const JSON_Array *array);
 /* Set the reserve of a JSON Array upfront */
 JSON_Status json_array_set_reserve(JSON_Parser const * parser, JSON_Array *array, size_t size);
 
+/* Converts an array whose elements are all numbers into a packed double column.
+ * The per-element values are freed: json_array_get_value returns null afterwards
+ * and mutating calls fail, but json_array_get_number keeps working and reads
+ * straight from the column. Returns JSONFailure when the array is empty, frozen
+ * or holds a non-number; packing an already packed array succeeds. */
+JSON_Status json_array_pack_numbers(JSON_Parser const * parser, JSON_Array *array);
+
+/* Exposes the column of a packed array for bulk reads (memcpy, SIMD kernels).
+ * The span stays valid until the array is mutated or freed. Returns JSONFailure
+ * for arrays that are not packed. */
+JSON_Status json_array_get_number_span(const JSON_Array *array, const double **out_numbers, size_t *out_count);
+
 /* Frees and removes value at given index, does nothing and returns JSONFailure if index doesn't exist.
  * Order of values in array may change during execution.  */
 JSON_Status json_array_remove(JSON_Parser const * parser, JSON_Array *array, size_t i);
@@ -252,6 +513,12 @@ JSON_Status json_array_append_number(JSON_Parser const * parser, JSON_Array *arr
 JSON_Status json_array_append_boolean(JSON_Parser const * parser, JSON_Array *array, int boolean);
 JSON_Status json_array_append_null(JSON_Parser const * parser, JSON_Array *array);
 
+/* Bulk appends: reserve capacity once, then append 'count' elements, instead of
+ * paying a possible reallocation per call. On failure the array keeps the
+ * elements appended before the failing one. */
+JSON_Status json_array_append_numbers(JSON_Parser const * parser, JSON_Array *array, const double *numbers, size_t count);
+JSON_Status json_array_append_strings(JSON_Parser const * parser, JSON_Array *array, const char **strings, size_t count);
+
 /*
  *JSON Value
  */
@@ -265,6 +532,38 @@ JSON_Value * json_value_init_null   (JSON_Parser const * parser);
 JSON_Value * json_value_deep_copy   (JSON_Parser const * parser, const JSON_Value *value);
 void         json_value_free        (JSON_Parser const * parser, JSON_Value *value);
 
+/* Makes the tree rooted at value read-only and trims it for long-lived use:
+   every array is shrunk to its element count and every object's bookkeeping
+   arrays are repacked into one right-sized allocation. After freezing, all
+   mutating calls on the tree return JSONFailure; lookups, serialization,
+   json_value_equals and json_value_free work as before, and json_value_deep_copy
+   returns a mutable copy. On allocation failure some nodes may keep their spare
+   capacity, but the tree is still valid and fully frozen. */
+JSON_Status json_value_freeze(JSON_Parser const * parser, JSON_Value *value);
+
+/* Shared ownership for fanning one tree out to several threads instead of
+ * deep-copying it per consumer. json_value_ref registers one extra owner of a
+ * root value (atomically when the compiler provides atomics); every owner then
+ * releases with json_value_unref and the last release frees the tree. Share
+ * only trees that no owner mutates - freezing first (json_value_freeze) makes
+ * that the library's problem instead of a convention. Values that were ref'd
+ * must be released through json_value_unref, not json_value_free, and
+ * snapshot-loaded trees (freed as one block) cannot be shared this way. */
+JSON_Status json_value_ref(JSON_Value *value);
+JSON_Status json_value_unref(JSON_Parser const * parser, JSON_Value *value);
+
+/* Structural hash of a value, for use as a cheap pre-filter before
+ * json_value_equals: values the comparison calls equal always hash alike, so
+ * differing hashes prove inequality. Object members contribute independently
+ * of their insertion order and numbers contribute only their presence (the
+ * comparison tolerates small numeric differences, so their values can't).
+ * Container hashes are cached on first computation and invalidated by
+ * mutation; json_value_equals also consults already-computed hashes to reject
+ * unequal subtrees without walking them. Never 0 except on out-of-memory.
+ * Compute hashes before sharing a tree across threads (json_value_ref) - the
+ * lazy cache write is not synchronized. */
+unsigned long json_value_hash(const JSON_Value *value);
+
 JSON_Value_Type json_value_get_type   (const JSON_Value *value);
 JSON_Object *   json_value_get_object (const JSON_Value *value);
 JSON_Array  *   json_value_get_array  (const JSON_Value *value);
@@ -69,6 +69,9 @@ void test_failing_allocations(void);
 void test_custom_number_format(void);
 void test_custom_number_serialization_function(void);
 void test_object_clear(void);
+void test_number_roundtrip(void); /* Shortest round-trip formatter + number parsing fast path */
+void test_snapshots(void); /* Binary snapshots, including truncated/corrupted blobs */
+void test_parallel_equivalence(void); /* Threaded parse/serialize match the sequential output */
 
 void print_commits_info(const char *username, const char *repo);
 void persistence_example(void);
@@ -76,9 +79,15 @@ void serialization_example(void);
 
 static const char *g_tests_path = "tests";
 
+/* Parser config shared by the suites. Counting allocators are plugged in by
+   main(); suites that need a different knob take a local copy and flip it. */
+static JSON_Parser g_parser;
+
 static int g_malloc_count = 0;
-static void *counted_malloc(size_t size);
-static void counted_free(void *ptr);
+static void *counted_malloc(size_t size, void *userdata);
+static void counted_free(void *ptr, void *userdata);
+static void *uncounted_malloc(size_t size, void *userdata);
+static void uncounted_free(void *ptr, void *userdata);
 
 typedef struct failing_alloc {
     int allocation_to_fail;
@@ -90,10 +99,12 @@ typedef struct failing_alloc {
 
 static failing_alloc_t g_failing_alloc;
 
-static void *failing_malloc(size_t size);
-static void failing_free(void *ptr);
+static void *failing_malloc(size_t size, void *userdata);
+static void failing_free(void *ptr, void *userdata);
 
 static char * read_file(const char * filename);
+static char * read_file_binary(const char * filename, size_t *out_size);
+static int write_file_binary(const char * filename, const char *data, size_t size);
 const char* get_file_path(const char *filename);
 
 static int g_tests_passed;
@@ -122,7 +133,10 @@ int tests_main(int argc, char *argv[]) {
         g_tests_path = "tests";
     }
 
-    json_set_allocation_functions(counted_malloc, counted_free);
+    g_parser = json_get_default_parser();
+    g_parser.malloc_func = counted_malloc;
+    g_parser.free_func = counted_free;
+
     test_suite_1();
     test_suite_2_no_comments();
     test_suite_2_with_comments();
@@ -140,40 +154,43 @@ int tests_main(int argc, char *argv[]) {
     test_custom_number_format();
     test_custom_number_serialization_function();
     test_object_clear();
+    test_number_roundtrip();
+    test_snapshots();
+    test_parallel_equivalence();
 
     printf("Tests failed: %d\n", g_tests_failed);
     printf("Tests passed: %d\n", g_tests_passed);
     puts("################################################################################");
-    return 0;
+    return g_tests_failed ? 1 : 0;
 }
 
 void test_suite_1(void) {
     JSON_Value *val;
-    TEST((val = json_parse_file(get_file_path("test_1_1.txt"))) != NULL);
-    TEST(json_value_equals(json_parse_string(json_serialize_to_string(val)), val));
-    TEST(json_value_equals(json_parse_string(json_serialize_to_string_pretty(val)), val));
-    if (val) { json_value_free(val); }
-
-    TEST((val = json_parse_file(get_file_path("test_1_2.txt"))) == NULL); /* Over 2048 levels of nesting */
-    if (val) { json_value_free(val); }
-
-    TEST((val = json_parse_file(get_file_path("test_1_3.txt"))) != NULL);
-    TEST(json_value_equals(json_parse_string(json_serialize_to_string(val)), val));
-    TEST(json_value_equals(json_parse_string(json_serialize_to_string_pretty(val)), val));
-    if (val) { json_value_free(val); }
-
-    TEST((val = json_parse_file_with_comments(get_file_path("test_1_1.txt"))) != NULL);
-    TEST(json_value_equals(json_parse_string(json_serialize_to_string(val)), val));
-    TEST(json_value_equals(json_parse_string(json_serialize_to_string_pretty(val)), val));
-    if (val) { json_value_free(val); }
-
-    TEST((val = json_parse_file_with_comments(get_file_path("test_1_2.txt"))) == NULL); /* Over 2048 levels of nesting */
-    if (val) { json_value_free(val); }
-
-    TEST((val = json_parse_file_with_comments(get_file_path("test_1_3.txt"))) != NULL);
-    TEST(json_value_equals(json_parse_string(json_serialize_to_string(val)), val));
-    TEST(json_value_equals(json_parse_string(json_serialize_to_string_pretty(val)), val));
-    if (val) { json_value_free(val); }
+    TEST((val = json_parse_file(&g_parser, get_file_path("test_1_1.txt"))) != NULL);
+    TEST(json_value_equals(json_parse_string(&g_parser, json_serialize_to_string(&g_parser, val)), val));
+    TEST(json_value_equals(json_parse_string(&g_parser, json_serialize_to_string_pretty(&g_parser, val)), val));
+    if (val) { json_value_free(&g_parser, val); }
+
+    TEST((val = json_parse_file(&g_parser, get_file_path("test_1_2.txt"))) == NULL); /* Over 2048 levels of nesting */
+    if (val) { json_value_free(&g_parser, val); }
+
+    TEST((val = json_parse_file(&g_parser, get_file_path("test_1_3.txt"))) != NULL);
+    TEST(json_value_equals(json_parse_string(&g_parser, json_serialize_to_string(&g_parser, val)), val));
+    TEST(json_value_equals(json_parse_string(&g_parser, json_serialize_to_string_pretty(&g_parser, val)), val));
+    if (val) { json_value_free(&g_parser, val); }
+
+    TEST((val = json_parse_file_with_comments(&g_parser, get_file_path("test_1_1.txt"))) != NULL);
+    TEST(json_value_equals(json_parse_string(&g_parser, json_serialize_to_string(&g_parser, val)), val));
+    TEST(json_value_equals(json_parse_string(&g_parser, json_serialize_to_string_pretty(&g_parser, val)), val));
+    if (val) { json_value_free(&g_parser, val); }
+
+    TEST((val = json_parse_file_with_comments(&g_parser, get_file_path("test_1_2.txt"))) == NULL); /* Over 2048 levels of nesting */
+    if (val) { json_value_free(&g_parser, val); }
+
+    TEST((val = json_parse_file_with_comments(&g_parser, get_file_path("test_1_3.txt"))) != NULL);
+    TEST(json_value_equals(json_parse_string(&g_parser, json_serialize_to_string(&g_parser, val)), val));
+    TEST(json_value_equals(json_parse_string(&g_parser, json_serialize_to_string_pretty(&g_parser, val)), val));
+    if (val) { json_value_free(&g_parser, val); }
 }
 
 void test_suite_2(JSON_Value *root_value) {
@@ -289,96 +306,96 @@ void test_suite_2(JSON_Value *root_value) {
 void test_suite_2_no_comments(void) {
     const char *filename = "test_2.txt";
     JSON_Value *root_value = NULL;
-    root_value = json_parse_file(get_file_path(filename));
+    root_value = json_parse_file(&g_parser, get_file_path(filename));
     test_suite_2(root_value);
-    TEST(json_value_equals(root_value, json_parse_string(json_serialize_to_string(root_value))));
-    TEST(json_value_equals(root_value, json_parse_string(json_serialize_to_string_pretty(root_value))));
-    json_value_free(root_value);
+    TEST(json_value_equals(root_value, json_parse_string(&g_parser, json_serialize_to_string(&g_parser, root_value))));
+    TEST(json_value_equals(root_value, json_parse_string(&g_parser, json_serialize_to_string_pretty(&g_parser, root_value))));
+    json_value_free(&g_parser, root_value);
 }
 
 void test_suite_2_with_comments(void) {
     const char *filename = "test_2_comments.txt";
     JSON_Value *root_value = NULL;
-    root_value = json_parse_file_with_comments(get_file_path(filename));
+    root_value = json_parse_file_with_comments(&g_parser, get_file_path(filename));
     test_suite_2(root_value);
-    TEST(json_value_equals(root_value, json_parse_string(json_serialize_to_string(root_value))));
-    TEST(json_value_equals(root_value, json_parse_string(json_serialize_to_string_pretty(root_value))));
-    json_value_free(root_value);
+    TEST(json_value_equals(root_value, json_parse_string(&g_parser, json_serialize_to_string(&g_parser, root_value))));
+    TEST(json_value_equals(root_value, json_parse_string(&g_parser, json_serialize_to_string_pretty(&g_parser, root_value))));
+    json_value_free(&g_parser, root_value);
 }
 
 void test_suite_3(void) {
     /* Testing valid strings */
-    TEST(json_parse_string("{\"lorem\":\"ipsum\"}") != NULL);
-    TEST(json_parse_string("[\"lorem\"]") != NULL);
-    TEST(json_parse_string("null") != NULL);
-    TEST(json_parse_string("true") != NULL);
-    TEST(json_parse_string("false") != NULL);
-    TEST(json_parse_string("\"string\"") != NULL);
-    TEST(json_parse_string("123") != NULL);
-    TEST(json_parse_string("[\"lorem\",]") != NULL);
-    TEST(json_parse_string("{\"lorem\":\"ipsum\",}") != NULL);
+    TEST(json_parse_string(&g_parser, "{\"lorem\":\"ipsum\"}") != NULL);
+    TEST(json_parse_string(&g_parser, "[\"lorem\"]") != NULL);
+    TEST(json_parse_string(&g_parser, "null") != NULL);
+    TEST(json_parse_string(&g_parser, "true") != NULL);
+    TEST(json_parse_string(&g_parser, "false") != NULL);
+    TEST(json_parse_string(&g_parser, "\"string\"") != NULL);
+    TEST(json_parse_string(&g_parser, "123") != NULL);
+    TEST(json_parse_string(&g_parser, "[\"lorem\",]") != NULL);
+    TEST(json_parse_string(&g_parser, "{\"lorem\":\"ipsum\",}") != NULL);
 
     /* Test UTF-16 parsing */
-    TEST(STREQ(json_string(json_parse_string("\"\\u0024x\"")), "$x"));
-    TEST(STREQ(json_string(json_parse_string("\"\\u00A2x\"")), "¢x"));
-    TEST(STREQ(json_string(json_parse_string("\"\\u20ACx\"")), "€x"));
-    TEST(STREQ(json_string(json_parse_string("\"\\uD801\\uDC37x\"")), "𐐷x"));
+    TEST(STREQ(json_string(json_parse_string(&g_parser, "\"\\u0024x\"")), "$x"));
+    TEST(STREQ(json_string(json_parse_string(&g_parser, "\"\\u00A2x\"")), "¢x"));
+    TEST(STREQ(json_string(json_parse_string(&g_parser, "\"\\u20ACx\"")), "€x"));
+    TEST(STREQ(json_string(json_parse_string(&g_parser, "\"\\uD801\\uDC37x\"")), "𐐷x"));
 
     /* Testing invalid strings */
     g_malloc_count = 0;
-    TEST(json_parse_string(NULL) == NULL);
-    TEST(json_parse_string("") == NULL); /* empty string */
-    TEST(json_parse_string("{lorem:ipsum}") == NULL);
-    TEST(json_parse_string("{\"lorem\":\"ipsum\",]") == NULL);
-    TEST(json_parse_string("{\"lorem\":\"ipsum\",,}") == NULL);
-    TEST(json_parse_string("[,]") == NULL);
-    TEST(json_parse_string("[,") == NULL);
-    TEST(json_parse_string("[") == NULL);
-    TEST(json_parse_string("]") == NULL);
-    TEST(json_parse_string("{\"a\":0,\"a\":0}") == NULL); /* duplicate keys */
-    TEST(json_parse_string("{:,}") == NULL);
-    TEST(json_parse_string("{,}") == NULL);
-    TEST(json_parse_string("{,") == NULL);
-    TEST(json_parse_string("{:") == NULL);
-    TEST(json_parse_string("{") == NULL);
-    TEST(json_parse_string("}") == NULL);
-    TEST(json_parse_string("x") == NULL);
-    TEST(json_parse_string("{:\"no name\"}") == NULL);
-    TEST(json_parse_string("[,\"no first value\"]") == NULL);
-    TEST(json_parse_string("{\"key\"\"value\"}") == NULL);
-    TEST(json_parse_string("{\"a\"}") == NULL);
-    TEST(json_parse_string("[\"\\u00zz\"]") == NULL); /* invalid utf value */
-    TEST(json_parse_string("[\"\\u00\"]") == NULL); /* invalid utf value */
-    TEST(json_parse_string("[\"\\u\"]") == NULL); /* invalid utf value */
-    TEST(json_parse_string("[\"\\\"]") == NULL); /* control character */
-    TEST(json_parse_string("[\"\"\"]") == NULL); /* control character */
-    TEST(json_parse_string("[\"\0\"]") == NULL); /* control character */
-    TEST(json_parse_string("[\"\a\"]") == NULL); /* control character */
-    TEST(json_parse_string("[\"\b\"]") == NULL); /* control character */
-    TEST(json_parse_string("[\"\t\"]") == NULL); /* control character */
-    TEST(json_parse_string("[\"\n\"]") == NULL); /* control character */
-    TEST(json_parse_string("[\"\f\"]") == NULL); /* control character */
-    TEST(json_parse_string("[\"\r\"]") == NULL); /* control character */
-    TEST(json_parse_string("[0x2]") == NULL);    /* hex */
-    TEST(json_parse_string("[0X2]") == NULL);    /* HEX */
-    TEST(json_parse_string("[07]") == NULL);     /* octals */
-    TEST(json_parse_string("[0070]") == NULL);
-    TEST(json_parse_string("[07.0]") == NULL);
-    TEST(json_parse_string("[-07]") == NULL);
-    TEST(json_parse_string("[-007]") == NULL);
-    TEST(json_parse_string("[-07.0]") == NULL);
-    TEST(json_parse_string("[\"\\uDF67\\uD834\"]") == NULL); /* wrong order surrogate pair */
-    TEST(json_parse_string("[1.7976931348623157e309]") == NULL);
-    TEST(json_parse_string("[-1.7976931348623157e309]") == NULL);
+    TEST(json_parse_string(&g_parser, NULL) == NULL);
+    TEST(json_parse_string(&g_parser, "") == NULL); /* empty string */
+    TEST(json_parse_string(&g_parser, "{lorem:ipsum}") == NULL);
+    TEST(json_parse_string(&g_parser, "{\"lorem\":\"ipsum\",]") == NULL);
+    TEST(json_parse_string(&g_parser, "{\"lorem\":\"ipsum\",,}") == NULL);
+    TEST(json_parse_string(&g_parser, "[,]") == NULL);
+    TEST(json_parse_string(&g_parser, "[,") == NULL);
+    TEST(json_parse_string(&g_parser, "[") == NULL);
+    TEST(json_parse_string(&g_parser, "]") == NULL);
+    TEST(json_parse_string(&g_parser, "{\"a\":0,\"a\":0}") == NULL); /* duplicate keys */
+    TEST(json_parse_string(&g_parser, "{:,}") == NULL);
+    TEST(json_parse_string(&g_parser, "{,}") == NULL);
+    TEST(json_parse_string(&g_parser, "{,") == NULL);
+    TEST(json_parse_string(&g_parser, "{:") == NULL);
+    TEST(json_parse_string(&g_parser, "{") == NULL);
+    TEST(json_parse_string(&g_parser, "}") == NULL);
+    TEST(json_parse_string(&g_parser, "x") == NULL);
+    TEST(json_parse_string(&g_parser, "{:\"no name\"}") == NULL);
+    TEST(json_parse_string(&g_parser, "[,\"no first value\"]") == NULL);
+    TEST(json_parse_string(&g_parser, "{\"key\"\"value\"}") == NULL);
+    TEST(json_parse_string(&g_parser, "{\"a\"}") == NULL);
+    TEST(json_parse_string(&g_parser, "[\"\\u00zz\"]") == NULL); /* invalid utf value */
+    TEST(json_parse_string(&g_parser, "[\"\\u00\"]") == NULL); /* invalid utf value */
+    TEST(json_parse_string(&g_parser, "[\"\\u\"]") == NULL); /* invalid utf value */
+    TEST(json_parse_string(&g_parser, "[\"\\\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[\"\"\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[\"\0\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[\"\a\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[\"\b\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[\"\t\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[\"\n\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[\"\f\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[\"\r\"]") == NULL); /* control character */
+    TEST(json_parse_string(&g_parser, "[0x2]") == NULL);    /* hex */
+    TEST(json_parse_string(&g_parser, "[0X2]") == NULL);    /* HEX */
+    TEST(json_parse_string(&g_parser, "[07]") == NULL);     /* octals */
+    TEST(json_parse_string(&g_parser, "[0070]") == NULL);
+    TEST(json_parse_string(&g_parser, "[07.0]") == NULL);
+    TEST(json_parse_string(&g_parser, "[-07]") == NULL);
+    TEST(json_parse_string(&g_parser, "[-007]") == NULL);
+    TEST(json_parse_string(&g_parser, "[-07.0]") == NULL);
+    TEST(json_parse_string(&g_parser, "[\"\\uDF67\\uD834\"]") == NULL); /* wrong order surrogate pair */
+    TEST(json_parse_string(&g_parser, "[1.7976931348623157e309]") == NULL);
+    TEST(json_parse_string(&g_parser, "[-1.7976931348623157e309]") == NULL);
     TEST(g_malloc_count == 0);
 }
 
 void test_suite_4(void) {
     const char *filename = "test_2.txt";
     JSON_Value *a = NULL, *a_copy = NULL;
-    a = json_parse_file(get_file_path(filename));
+    a = json_parse_file(&g_parser, get_file_path(filename));
     TEST(json_value_equals(a, a)); /* test equality test */
-    a_copy = json_value_deep_copy(a);
+    a_copy = json_value_deep_copy(&g_parser, a);
     TEST(a_copy != NULL);
     TEST(json_value_equals(a, a_copy));
 }
@@ -386,7 +403,7 @@ void test_suite_4(void) {
 void test_suite_5(void) {
     double zero = 0.0; /* msvc is silly (workaround for error C2124) */
 
-    JSON_Value *val_from_file = json_parse_file(get_file_path("test_5.txt"));
+    JSON_Value *val_from_file = json_parse_file(&g_parser, get_file_path("test_5.txt"));
 
     JSON_Value *val = NULL, *val_with_parent;
     JSON_Object *obj = NULL;
@@ -395,153 +412,153 @@ void test_suite_5(void) {
     JSON_Value *remove_test_val = NULL;
     JSON_Array *remove_test_arr = NULL;
 
-    val = json_value_init_object();
+    val = json_value_init_object(&g_parser);
     TEST(val != NULL);
 
     obj = json_value_get_object(val);
     TEST(obj != NULL);
 
-    TEST(json_object_set_string(obj, "first", "John") == JSONSuccess);
-    TEST(json_object_set_string(obj, "last", "Doe") == JSONSuccess);
-    TEST(json_object_set_number(obj, "age", 25) == JSONSuccess);
-    TEST(json_object_set_boolean(obj, "registered", 1) == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "first", "John") == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "last", "Doe") == JSONSuccess);
+    TEST(json_object_set_number(&g_parser, obj, "age", 25) == JSONSuccess);
+    TEST(json_object_set_boolean(&g_parser, obj, "registered", 1) == JSONSuccess);
 
-    TEST(json_object_set_value(obj, "interests", json_value_init_array()) == JSONSuccess);
+    TEST(json_object_set_value(&g_parser, obj, "interests", json_value_init_array(&g_parser)) == JSONSuccess);
     interests_arr = json_object_get_array(obj, "interests");
     TEST(interests_arr != NULL);
-    TEST(json_array_append_string(interests_arr, "Writing") == JSONSuccess);
-    TEST(json_array_append_string(interests_arr, "Mountain Biking") == JSONSuccess);
-    TEST(json_array_replace_string(interests_arr, 0, "Reading") == JSONSuccess);
-
-    TEST(json_object_dotset_string(obj, "favorites.color", "blue") == JSONSuccess);
-    TEST(json_object_dotset_string(obj, "favorites.sport", "running") == JSONSuccess);
-    TEST(json_object_dotset_string(obj, "favorites.fruit", "apple") == JSONSuccess);
-    TEST(json_object_dotremove(obj, "favorites.fruit") == JSONSuccess);
-    TEST(json_object_set_string(obj, "utf string", "lorem ipsum") == JSONSuccess);
-    TEST(json_object_set_string(obj, "utf-8 string", "あいうえお") == JSONSuccess);
-    TEST(json_object_set_string(obj, "surrogate string", "lorem𝄞ipsum𝍧lorem") == JSONSuccess);
-    TEST(json_object_set_string_with_len(obj, "string with null", "abc\0def", 7) == JSONSuccess);
-    TEST(json_object_set_string(obj, "windows path", "C:\\Windows\\Path") == JSONSuccess);
+    TEST(json_array_append_string(&g_parser, interests_arr, "Writing") == JSONSuccess);
+    TEST(json_array_append_string(&g_parser, interests_arr, "Mountain Biking") == JSONSuccess);
+    TEST(json_array_replace_string(&g_parser, interests_arr, 0, "Reading") == JSONSuccess);
+
+    TEST(json_object_dotset_string(&g_parser, obj, "favorites.color", "blue") == JSONSuccess);
+    TEST(json_object_dotset_string(&g_parser, obj, "favorites.sport", "running") == JSONSuccess);
+    TEST(json_object_dotset_string(&g_parser, obj, "favorites.fruit", "apple") == JSONSuccess);
+    TEST(json_object_dotremove(&g_parser, obj, "favorites.fruit") == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "utf string", "lorem ipsum") == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "utf-8 string", "あいうえお") == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "surrogate string", "lorem𝄞ipsum𝍧lorem") == JSONSuccess);
+    TEST(json_object_set_string_with_len(&g_parser, obj, "string with null", "abc\0def", 7) == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "windows path", "C:\\Windows\\Path") == JSONSuccess);
     TEST(json_value_equals(val_from_file, val));
 
-    TEST(json_object_set_string(obj, NULL, "") == JSONFailure);
-    TEST(json_object_set_string(obj, "last", NULL) == JSONFailure);
-    TEST(json_object_set_string(obj, NULL, NULL) == JSONFailure);
-    TEST(json_object_set_value(obj, NULL, NULL) == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, NULL, "") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "last", NULL) == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, NULL, NULL) == JSONFailure);
+    TEST(json_object_set_value(&g_parser, obj, NULL, NULL) == JSONFailure);
 
-    TEST(json_object_dotset_string(obj, NULL, "") == JSONFailure);
-    TEST(json_object_dotset_string(obj, "favorites.color", NULL) == JSONFailure);
-    TEST(json_object_dotset_string(obj, NULL, NULL) == JSONFailure);
-    TEST(json_object_dotset_value(obj, NULL, NULL) == JSONFailure);
+    TEST(json_object_dotset_string(&g_parser, obj, NULL, "") == JSONFailure);
+    TEST(json_object_dotset_string(&g_parser, obj, "favorites.color", NULL) == JSONFailure);
+    TEST(json_object_dotset_string(&g_parser, obj, NULL, NULL) == JSONFailure);
+    TEST(json_object_dotset_value(&g_parser, obj, NULL, NULL) == JSONFailure);
 
-    TEST(json_array_append_string(NULL, "lorem") == JSONFailure);
-    TEST(json_array_append_value(interests_arr, NULL) == JSONFailure);
-    TEST(json_array_append_value(NULL, NULL) == JSONFailure);
+    TEST(json_array_append_string(&g_parser, NULL, "lorem") == JSONFailure);
+    TEST(json_array_append_value(&g_parser, interests_arr, NULL) == JSONFailure);
+    TEST(json_array_append_value(&g_parser, NULL, NULL) == JSONFailure);
 
-    TEST(json_array_remove(NULL, 0) == JSONFailure);
-    TEST(json_array_replace_value(interests_arr, 0, NULL) == JSONFailure);
-    TEST(json_array_replace_string(NULL, 0, "lorem") == JSONFailure);
-    TEST(json_array_replace_string(interests_arr, 100, "not existing") == JSONFailure);
+    TEST(json_array_remove(&g_parser, NULL, 0) == JSONFailure);
+    TEST(json_array_replace_value(&g_parser, interests_arr, 0, NULL) == JSONFailure);
+    TEST(json_array_replace_string(&g_parser, NULL, 0, "lorem") == JSONFailure);
+    TEST(json_array_replace_string(&g_parser, interests_arr, 100, "not existing") == JSONFailure);
 
-    TEST(json_array_append_string(json_object_get_array(obj, "interests"), NULL) == JSONFailure);
+    TEST(json_array_append_string(&g_parser, json_object_get_array(obj, "interests"), NULL) == JSONFailure);
 
-    TEST(json_array_append_string(interests_arr, "Writing") == JSONSuccess);
-    TEST(json_array_remove(interests_arr, 0) == JSONSuccess);
-    TEST(json_array_remove(interests_arr, 1) == JSONSuccess);
-    TEST(json_array_remove(interests_arr, 0) == JSONSuccess);
-    TEST(json_array_remove(interests_arr, 0) == JSONFailure); /* should be empty by now */
+    TEST(json_array_append_string(&g_parser, interests_arr, "Writing") == JSONSuccess);
+    TEST(json_array_remove(&g_parser, interests_arr, 0) == JSONSuccess);
+    TEST(json_array_remove(&g_parser, interests_arr, 1) == JSONSuccess);
+    TEST(json_array_remove(&g_parser, interests_arr, 0) == JSONSuccess);
+    TEST(json_array_remove(&g_parser, interests_arr, 0) == JSONFailure); /* should be empty by now */
 
-    val_with_parent = json_value_init_null();
-    TEST(json_object_set_value(obj, "x", val_with_parent) == JSONSuccess);
-    TEST(json_object_set_value(obj, "x", val_with_parent) == JSONFailure);
+    val_with_parent = json_value_init_null(&g_parser);
+    TEST(json_object_set_value(&g_parser, obj, "x", val_with_parent) == JSONSuccess);
+    TEST(json_object_set_value(&g_parser, obj, "x", val_with_parent) == JSONFailure);
 
-    val_with_parent = json_value_init_null();
-    TEST(json_array_append_value(interests_arr, val_with_parent) == JSONSuccess);
-    TEST(json_array_append_value(interests_arr, val_with_parent) == JSONFailure);
+    val_with_parent = json_value_init_null(&g_parser);
+    TEST(json_array_append_value(&g_parser, interests_arr, val_with_parent) == JSONSuccess);
+    TEST(json_array_append_value(&g_parser, interests_arr, val_with_parent) == JSONFailure);
 
-    val_with_parent = json_value_init_null();
-    TEST(json_array_replace_value(interests_arr, 0, val_with_parent) == JSONSuccess);
-    TEST(json_array_replace_value(interests_arr, 0, val_with_parent) == JSONFailure);
+    val_with_parent = json_value_init_null(&g_parser);
+    TEST(json_array_replace_value(&g_parser, interests_arr, 0, val_with_parent) == JSONSuccess);
+    TEST(json_array_replace_value(&g_parser, interests_arr, 0, val_with_parent) == JSONFailure);
 
-    TEST(json_object_remove(obj, "interests") == JSONSuccess);
+    TEST(json_object_remove(&g_parser, obj, "interests") == JSONSuccess);
 
     /* UTF-8 tests */
-    TEST(json_object_set_string(obj, "correct string", "κόσμε") == JSONSuccess);
-
-    TEST(json_object_set_string(obj, "boundary 1", "\xed\x9f\xbf") == JSONSuccess);
-    TEST(json_object_set_string(obj, "boundary 2", "\xee\x80\x80") == JSONSuccess);
-    TEST(json_object_set_string(obj, "boundary 3", "\xef\xbf\xbd") == JSONSuccess);
-    TEST(json_object_set_string(obj, "boundary 4", "\xf4\x8f\xbf\xbf") == JSONSuccess);
-
-    TEST(json_object_set_string(obj, "first continuation byte", "\x80") == JSONFailure);
-    TEST(json_object_set_string(obj, "last continuation byte", "\xbf") == JSONFailure);
-
-    TEST(json_object_set_string(obj, "impossible sequence 1", "\xfe") == JSONFailure);
-    TEST(json_object_set_string(obj, "impossible sequence 2", "\xff") == JSONFailure);
-    TEST(json_object_set_string(obj, "impossible sequence 3", "\xfe\xfe\xff\xff") == JSONFailure);
-
-    TEST(json_object_set_string(obj, "overlong 1", "\xc0\xaf") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong 2", "\xc1\xbf") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong 3", "\xe0\x80\xaf") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong 4", "\xe0\x9f\xbf") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong 5", "\xf0\x80\x80\xaf") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong 6", "\xf0\x8f\xbf\xbf") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong 7", "\xf0\x8f\xbf\xbf") == JSONFailure);
-
-    TEST(json_object_set_string(obj, "overlong null 1", "\xc0\x80") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong null 2", "\xe0\x80\x80") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong null 3", "\xf0\x80\x80\x80") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong null 4", "\xf8\x80\x80\x80\x80") == JSONFailure);
-    TEST(json_object_set_string(obj, "overlong null 5", "\xfc\x80\x80\x80\x80\x80") == JSONFailure);
-
-    TEST(json_object_set_string(obj, "single surrogate 1", "\xed\xa0\x80") == JSONFailure);
-    TEST(json_object_set_string(obj, "single surrogate 2", "\xed\xaf\xbf") == JSONFailure);
-    TEST(json_object_set_string(obj, "single surrogate 3", "\xed\xbf\xbf") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "correct string", "κόσμε") == JSONSuccess);
+
+    TEST(json_object_set_string(&g_parser, obj, "boundary 1", "\xed\x9f\xbf") == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "boundary 2", "\xee\x80\x80") == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "boundary 3", "\xef\xbf\xbd") == JSONSuccess);
+    TEST(json_object_set_string(&g_parser, obj, "boundary 4", "\xf4\x8f\xbf\xbf") == JSONSuccess);
+
+    TEST(json_object_set_string(&g_parser, obj, "first continuation byte", "\x80") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "last continuation byte", "\xbf") == JSONFailure);
+
+    TEST(json_object_set_string(&g_parser, obj, "impossible sequence 1", "\xfe") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "impossible sequence 2", "\xff") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "impossible sequence 3", "\xfe\xfe\xff\xff") == JSONFailure);
+
+    TEST(json_object_set_string(&g_parser, obj, "overlong 1", "\xc0\xaf") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong 2", "\xc1\xbf") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong 3", "\xe0\x80\xaf") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong 4", "\xe0\x9f\xbf") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong 5", "\xf0\x80\x80\xaf") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong 6", "\xf0\x8f\xbf\xbf") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong 7", "\xf0\x8f\xbf\xbf") == JSONFailure);
+
+    TEST(json_object_set_string(&g_parser, obj, "overlong null 1", "\xc0\x80") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong null 2", "\xe0\x80\x80") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong null 3", "\xf0\x80\x80\x80") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong null 4", "\xf8\x80\x80\x80\x80") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "overlong null 5", "\xfc\x80\x80\x80\x80\x80") == JSONFailure);
+
+    TEST(json_object_set_string(&g_parser, obj, "single surrogate 1", "\xed\xa0\x80") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "single surrogate 2", "\xed\xaf\xbf") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, obj, "single surrogate 3", "\xed\xbf\xbf") == JSONFailure);
 
     /* Testing removing values from array, order of the elements should be preserved */
-    remove_test_val = json_parse_string("[1, 2, 3, 4, 5]");
+    remove_test_val = json_parse_string(&g_parser, "[1, 2, 3, 4, 5]");
     remove_test_arr = json_array(remove_test_val);
-    json_array_remove(remove_test_arr, 2);
-    TEST(json_value_equals(remove_test_val, json_parse_string("[1, 2, 4, 5]")));
-    json_array_remove(remove_test_arr, 0);
-    TEST(json_value_equals(remove_test_val, json_parse_string("[2, 4, 5]")));
-    json_array_remove(remove_test_arr, 2);
-    TEST(json_value_equals(remove_test_val, json_parse_string("[2, 4]")));
+    json_array_remove(&g_parser, remove_test_arr, 2);
+    TEST(json_value_equals(remove_test_val, json_parse_string(&g_parser, "[1, 2, 4, 5]")));
+    json_array_remove(&g_parser, remove_test_arr, 0);
+    TEST(json_value_equals(remove_test_val, json_parse_string(&g_parser, "[2, 4, 5]")));
+    json_array_remove(&g_parser, remove_test_arr, 2);
+    TEST(json_value_equals(remove_test_val, json_parse_string(&g_parser, "[2, 4]")));
 
     /* Testing nan and inf */
-    TEST(json_object_set_number(obj, "num", 0.0 / zero) == JSONFailure);
-    TEST(json_object_set_number(obj, "num", 1.0 / zero) == JSONFailure);
+    TEST(json_object_set_number(&g_parser, obj, "num", 0.0 / zero) == JSONFailure);
+    TEST(json_object_set_number(&g_parser, obj, "num", 1.0 / zero) == JSONFailure);
 }
 
 void test_suite_6(void) {
     const char *filename = "test_2.txt";
     JSON_Value *a = NULL;
     JSON_Value *b = NULL;
-    a = json_parse_file(get_file_path(filename));
-    b = json_parse_file(get_file_path(filename));
+    a = json_parse_file(&g_parser, get_file_path(filename));
+    b = json_parse_file(&g_parser, get_file_path(filename));
     TEST(json_value_equals(a, b));
-    json_object_set_string(json_object(a), "string", "eki");
+    json_object_set_string(&g_parser, json_object(a), "string", "eki");
     TEST(!json_value_equals(a, b));
-    a = json_value_deep_copy(b);
+    a = json_value_deep_copy(&g_parser, b);
     TEST(json_value_equals(a, b));
-    json_array_append_number(json_object_get_array(json_object(b), "string array"), 1337);
+    json_array_append_number(&g_parser, json_object_get_array(json_object(b), "string array"), 1337);
     TEST(!json_value_equals(a, b));
 }
 
 void test_suite_7(void) {
-    JSON_Value *val_from_file = json_parse_file(get_file_path("test_5.txt"));
-    JSON_Value *schema = json_value_init_object();
+    JSON_Value *val_from_file = json_parse_file(&g_parser, get_file_path("test_5.txt"));
+    JSON_Value *schema = json_value_init_object(&g_parser);
     JSON_Object *schema_obj = json_value_get_object(schema);
     JSON_Array *interests_arr = NULL;
-    json_object_set_string(schema_obj, "first", "");
-    json_object_set_string(schema_obj, "last", "");
-    json_object_set_number(schema_obj, "age", 0);
-    json_object_set_value(schema_obj, "interests", json_value_init_array());
+    json_object_set_string(&g_parser, schema_obj, "first", "");
+    json_object_set_string(&g_parser, schema_obj, "last", "");
+    json_object_set_number(&g_parser, schema_obj, "age", 0);
+    json_object_set_value(&g_parser, schema_obj, "interests", json_value_init_array(&g_parser));
     interests_arr = json_object_get_array(schema_obj, "interests");
-    json_array_append_string(interests_arr, "");
-    json_object_set_null(schema_obj, "favorites");
+    json_array_append_string(&g_parser, interests_arr, "");
+    json_object_set_null(&g_parser, schema_obj, "favorites");
     TEST(json_validate(schema, val_from_file) == JSONSuccess);
-    json_object_set_string(schema_obj, "age", "");
+    json_object_set_string(&g_parser, schema_obj, "age", "");
     TEST(json_validate(schema, val_from_file) == JSONFailure);
 }
 
@@ -552,13 +569,13 @@ void test_suite_8(void) {
     JSON_Value *b = NULL;
     char *buf = NULL;
     size_t serialization_size = 0;
-    a = json_parse_file(get_file_path(filename));
-    TEST(json_serialize_to_file(a, get_file_path(temp_filename)) == JSONSuccess);
-    b = json_parse_file(get_file_path(temp_filename));
+    a = json_parse_file(&g_parser, get_file_path(filename));
+    TEST(json_serialize_to_file(&g_parser, a, temp_filename) == JSONSuccess);
+    b = json_parse_file(&g_parser, temp_filename);
     TEST(json_value_equals(a, b));
     remove(temp_filename);
-    serialization_size = json_serialization_size(a);
-    buf = json_serialize_to_string(a);
+    serialization_size = json_serialization_size(&g_parser, a);
+    buf = json_serialize_to_string(&g_parser, a);
     TEST((strlen(buf)+1) == serialization_size);
 }
 
@@ -570,13 +587,13 @@ void test_suite_9(void) {
     JSON_Value *a = NULL;
     JSON_Value *b = NULL;
     size_t serialization_size = 0;
-    a = json_parse_file(get_file_path(filename));
-    TEST(json_serialize_to_file_pretty(a, get_file_path(temp_filename)) == JSONSuccess);
-    b = json_parse_file(get_file_path(temp_filename));
+    a = json_parse_file(&g_parser, get_file_path(filename));
+    TEST(json_serialize_to_file_pretty(&g_parser, a, temp_filename) == JSONSuccess);
+    b = json_parse_file(&g_parser, temp_filename);
     TEST(json_value_equals(a, b));
     remove(temp_filename);
-    serialization_size = json_serialization_size_pretty(a);
-    serialized = json_serialize_to_string_pretty(a);
+    serialization_size = json_serialization_size_pretty(&g_parser, a);
+    serialized = json_serialize_to_string_pretty(&g_parser, a);
     TEST((strlen(serialized)+1) == serialization_size);
 
     file_contents = read_file(get_file_path(filename));
@@ -590,19 +607,19 @@ void test_suite_10(void) {
 
     g_malloc_count = 0;
 
-    val = json_parse_file(get_file_path("test_1_1.txt"));
-    json_value_free(val);
+    val = json_parse_file(&g_parser, get_file_path("test_1_1.txt"));
+    json_value_free(&g_parser, val);
 
-    val = json_parse_file(get_file_path("test_1_3.txt"));
-    json_value_free(val);
+    val = json_parse_file(&g_parser, get_file_path("test_1_3.txt"));
+    json_value_free(&g_parser, val);
 
-    val = json_parse_file(get_file_path("test_2.txt"));
-    serialized = json_serialize_to_string_pretty(val);
-    json_free_serialized_string(serialized);
-    json_value_free(val);
+    val = json_parse_file(&g_parser, get_file_path("test_2.txt"));
+    serialized = json_serialize_to_string_pretty(&g_parser, val);
+    json_free_serialized_string(&g_parser, serialized);
+    json_value_free(&g_parser, val);
 
-    val = json_parse_file(get_file_path("test_2_pretty.txt"));
-    json_value_free(val);
+    val = json_parse_file(&g_parser, get_file_path("test_2_pretty.txt"));
+    json_value_free(&g_parser, val);
 
     TEST(g_malloc_count == 0);
 }
@@ -611,29 +628,30 @@ void test_suite_11(void) {
     const char * array_with_slashes = "[\"a/b/c\"]";
     const char * array_with_escaped_slashes = "[\"a\\/b\\/c\"]";
     char *serialized = NULL;
-    JSON_Value *value = json_parse_string(array_with_slashes);
+    JSON_Parser parser = g_parser;
+    JSON_Value *value = json_parse_string(&g_parser, array_with_slashes);
 
-    serialized = json_serialize_to_string(value);
+    serialized = json_serialize_to_string(&g_parser, value); /* slashes are escaped by default */
     TEST(STREQ(array_with_escaped_slashes, serialized));
 
-    json_set_escape_slashes(0);
-    serialized = json_serialize_to_string(value);
+    parser.escape_slashes = 0;
+    serialized = json_serialize_to_string(&parser, value);
     TEST(STREQ(array_with_slashes, serialized));
 
-    json_set_escape_slashes(1);
-    serialized = json_serialize_to_string(value);
+    parser.escape_slashes = 1;
+    serialized = json_serialize_to_string(&parser, value);
     TEST(STREQ(array_with_escaped_slashes, serialized));
 }
 
 void test_memory_leaks(void) {
     g_malloc_count = 0;
 
-    TEST(json_object_set_string(NULL, "lorem", "ipsum") == JSONFailure);
-    TEST(json_object_set_number(NULL, "lorem", 42) == JSONFailure);
-    TEST(json_object_set_boolean(NULL, "lorem", 0) == JSONFailure);
-    TEST(json_object_set_null(NULL, "lorem") == JSONFailure);
+    TEST(json_object_set_string(&g_parser, NULL, "lorem", "ipsum") == JSONFailure);
+    TEST(json_object_set_number(&g_parser, NULL, "lorem", 42) == JSONFailure);
+    TEST(json_object_set_boolean(&g_parser, NULL, "lorem", 0) == JSONFailure);
+    TEST(json_object_set_null(&g_parser, NULL, "lorem") == JSONFailure);
 
-    TEST(json_parse_string("{\"\\u0000\"") == NULL);
+    TEST(json_parse_string(&g_parser, "{\"\\u0000\"") == NULL);
 
     TEST(g_malloc_count == 0);
 }
@@ -642,11 +660,13 @@ void test_failing_allocations(void) {
     const char *filename = "test_2.txt";
     JSON_Value *root_value = NULL;
     JSON_Object *root_object = NULL;
+    JSON_Parser parser = g_parser;
     int i = 0;
     int n = 0;
     char key_val_buf[32];
 
-    json_set_allocation_functions(failing_malloc, failing_free);
+    parser.malloc_func = failing_malloc;
+    parser.free_func = failing_free;
 
     printf("Testing failing allocations: ");
 
@@ -659,7 +679,7 @@ void test_failing_allocations(void) {
         g_failing_alloc.should_fail = 1;
         n++;
 
-        root_value = json_parse_file(get_file_path(filename));
+        root_value = json_parse_file(&parser, get_file_path(filename));
         if (g_failing_alloc.has_failed) {
             if (root_value) {
                 printf("Allocation has failed but parsing succeeded after allocation %d\n", n - 1);
@@ -672,19 +692,19 @@ void test_failing_allocations(void) {
             root_object = json_object(root_value);
             for (i = 0; i < 64; i++) {
                 sprintf(key_val_buf, "%d", i);
-                json_object_set_string(root_object, key_val_buf, key_val_buf);
+                json_object_set_string(&parser, root_object, key_val_buf, key_val_buf);
             }
 
             for (i = 0; i < 64; i++) {
                 sprintf(key_val_buf, "%d", i);
-                json_object_set_string(root_object, key_val_buf, key_val_buf);
+                json_object_set_string(&parser, root_object, key_val_buf, key_val_buf);
             }
 
-            json_object_dotset_number(root_object, "ala.ma.kota", 123);
-            json_object_dotremove(root_object, "ala.ma.kota");
+            json_object_dotset_number(&parser, root_object, "ala.ma.kota", 123);
+            json_object_dotremove(&parser, root_object, "ala.ma.kota");
         }
 
-        json_value_free(root_value);
+        json_value_free(&parser, root_value);
 
         if (g_failing_alloc.alloc_count != 0) {
             printf("Leak after failing allocation %d\n", n - 1);
@@ -697,7 +717,6 @@ void test_failing_allocations(void) {
         }
     }
 
-    json_set_allocation_functions(counted_malloc, counted_free);
     printf("OK (tested %d failing allocations)\n", n - 1);
     g_tests_passed++;
 }
@@ -706,13 +725,13 @@ void test_custom_number_format(void) {
     g_malloc_count = 0;
     {
         char *serialized = NULL;
-        JSON_Value *val = json_value_init_number(0.6);
-        json_set_float_serialization_format("%.1f");
-        serialized = json_serialize_to_string(val);
-        json_set_float_serialization_format(NULL);
+        JSON_Parser parser = g_parser;
+        JSON_Value *val = json_value_init_number(&parser, 0.6);
+        parser.float_fmt_str = "%.1f";
+        serialized = json_serialize_to_string(&parser, val);
         TEST(STREQ(serialized, "0.6"));
-        json_free_serialized_string(serialized);
-        json_value_free(val);
+        json_free_serialized_string(&parser, serialized);
+        json_value_free(&parser, val);
     }
     TEST(g_malloc_count == 0);
 }
@@ -731,14 +750,14 @@ void test_custom_number_serialization_function(void) {
     {
         /* We just test that custom_serialization_func() gets called, not it's performance */
         char *serialized = NULL;
-        JSON_Value *val = json_value_init_number(0.6);
-        json_set_number_serialization_function(custom_serialization_func);
-        serialized = json_serialize_to_string(val);
+        JSON_Parser parser = g_parser;
+        JSON_Value *val = json_value_init_number(&parser, 0.6);
+        parser.number_serialization_func = custom_serialization_func;
+        serialized = json_serialize_to_string(&parser, val);
         TEST(STREQ(serialized, "0.6"));
         TEST(custom_serialization_func_called);
-        json_set_number_serialization_function(NULL);
-        json_free_serialized_string(serialized);
-        json_value_free(val);
+        json_free_serialized_string(&parser, serialized);
+        json_value_free(&parser, val);
     }
     TEST(g_malloc_count == 0);
 }
@@ -746,13 +765,278 @@ void test_custom_number_serialization_function(void) {
 void test_object_clear(void) {
     g_malloc_count = 0;
     {
-        JSON_Value *val = json_value_init_object();
+        JSON_Value *val = json_value_init_object(&g_parser);
         JSON_Object *obj = json_value_get_object(val);
-        json_object_set_string(obj, "foo", "bar");
-        json_object_clear(obj);
+        json_object_set_string(&g_parser, obj, "foo", "bar");
+        json_object_clear(&g_parser, obj);
         TEST(json_object_get_value(obj, "foo") == NULL);
-        json_value_free(val);
+        json_value_free(&g_parser, val);
+    }
+    TEST(g_malloc_count == 0);
+}
+
+static void check_number_serializes_to(double number, const char *expected) {
+    JSON_Value *val = json_value_init_number(&g_parser, number);
+    char *serialized = json_serialize_to_string(&g_parser, val);
+    if (!STREQ(serialized, expected)) {
+        printf("serializing %.17g: expected \"%s\", got \"%s\"\n",
+               number, expected, serialized ? serialized : "(null)");
+        g_tests_failed++;
+    } else {
+        g_tests_passed++;
+    }
+    json_free_serialized_string(&g_parser, serialized);
+    json_value_free(&g_parser, val);
+}
+
+static void check_number_roundtrips(double number) {
+    JSON_Value *val = json_value_init_number(&g_parser, number);
+    char *serialized = json_serialize_to_string(&g_parser, val);
+    JSON_Value *reparsed = serialized ? json_parse_string(&g_parser, serialized) : NULL;
+    if (reparsed == NULL || json_value_get_type(reparsed) != JSONNumber
+        || json_number(reparsed) != number) {
+        printf("round-trip of %.17g through \"%s\" failed\n",
+               number, serialized ? serialized : "(null)");
+        g_tests_failed++;
+    } else {
+        g_tests_passed++;
+    }
+    if (reparsed) { json_value_free(&g_parser, reparsed); }
+    json_free_serialized_string(&g_parser, serialized);
+    json_value_free(&g_parser, val);
+}
+
+static void check_number_parses_like_strtod(const char *literal) {
+    JSON_Value *val = json_parse_string(&g_parser, literal);
+    if (val == NULL || json_value_get_type(val) != JSONNumber
+        || json_number(val) != strtod(literal, NULL)) {
+        printf("parsing \"%s\": expected %.17g, got %.17g\n",
+               literal, strtod(literal, NULL), val ? json_number(val) : 0.0);
+        g_tests_failed++;
+    } else {
+        g_tests_passed++;
+    }
+    if (val) { json_value_free(&g_parser, val); }
+}
+
+void test_number_roundtrip(void) {
+    /* Exercises both halves of the default number pipeline: the shortest
+       round-trip formatter (with its integer fast path) on output and the
+       custom strtod on input. Every finite double must survive
+       serialize -> parse exactly, bit for bit. */
+    static const double roundtrip_cases[] = {
+        0.0, 1.0, -1.0, 0.5, -0.5, 0.1, 0.3, 2.5, 1e22, 1e-22, 1e100,
+        -0.000314, 123456789.123456789, 3.141592653589793, 2.2250738585072014e-308,
+        1.7976931348623157e308, 4.9406564584124654e-324, /* max double, min denormal */
+        9007199254740991.0, -9007199254740991.0, /* 2^53 - 1 */
+        65536.0, 16777217.0, 1e15, 123456.78125
+    };
+    size_t i;
+
+    g_malloc_count = 0;
+
+    for (i = 0; i < sizeof(roundtrip_cases) / sizeof(roundtrip_cases[0]); i++) {
+        check_number_roundtrips(roundtrip_cases[i]);
+        check_number_roundtrips(roundtrip_cases[i] / 3.0);
+    }
+
+    /* The integer fast path must print integers without a fraction or
+       exponent, and the shortest form must be chosen for simple fractions. */
+    check_number_serializes_to(0.0, "0");
+    check_number_serializes_to(1.0, "1");
+    check_number_serializes_to(-1.0, "-1");
+    check_number_serializes_to(25.0, "25");
+    check_number_serializes_to(1234567890.0, "1234567890");
+    check_number_serializes_to(-9007199254740991.0, "-9007199254740991");
+    check_number_serializes_to(0.5, "0.5");
+    check_number_serializes_to(0.1, "0.1");
+    check_number_serializes_to(-0.000314, "-0.000314");
+
+    /* The parsing fast path and the slow fallback must agree with strtod. */
+    check_number_parses_like_strtod("0");
+    check_number_parses_like_strtod("-0");
+    check_number_parses_like_strtod("123");
+    check_number_parses_like_strtod("-123");
+    check_number_parses_like_strtod("123.456");
+    check_number_parses_like_strtod("0.0000001");
+    check_number_parses_like_strtod("1e10");
+    check_number_parses_like_strtod("2.5e-9");
+    check_number_parses_like_strtod("-1.5e-8");
+    check_number_parses_like_strtod("9007199254740993"); /* 2^53 + 1, needs the slow path */
+    check_number_parses_like_strtod("123456789012345678901234567890"); /* > 19 digits */
+    check_number_parses_like_strtod("1.7976931348623157e308");
+    check_number_parses_like_strtod("4.9406564584124654e-324");
+    check_number_parses_like_strtod("0.1e-310"); /* denormal via exponent */
+
+    /* An explicit float format string still overrides the formatter. */
+    {
+        JSON_Parser parser = g_parser;
+        JSON_Value *val = NULL;
+        char *serialized = NULL;
+        parser.float_fmt_str = "%1.17g";
+        val = json_value_init_number(&parser, 0.1);
+        serialized = json_serialize_to_string(&parser, val);
+        TEST(serialized != NULL);
+        TEST(strtod(serialized, NULL) == 0.1);
+        json_free_serialized_string(&parser, serialized);
+        json_value_free(&parser, val);
+    }
+
+    TEST(g_malloc_count == 0);
+}
+
+void test_snapshots(void) {
+    const char *snapshot_filename = "test_snapshot.bin";
+    JSON_Value *val = NULL;
+    JSON_Value *loaded = NULL;
+    char *blob = NULL;
+    size_t blob_size = 0;
+    size_t truncations[4];
+    size_t i;
+
+    g_malloc_count = 0;
+
+    val = json_parse_file(&g_parser, get_file_path("test_2.txt"));
+    TEST(val != NULL);
+    TEST(json_value_save_snapshot(&g_parser, val, snapshot_filename) == JSONSuccess);
+
+    /* A snapshot loads back equal and frees as one block. */
+    loaded = json_value_load_snapshot(&g_parser, snapshot_filename);
+    TEST(loaded != NULL);
+    TEST(json_value_equals(val, loaded));
+    TEST(json_value_free_snapshot(&g_parser, loaded) == JSONSuccess);
+
+    blob = read_file_binary(snapshot_filename, &blob_size);
+    TEST(blob != NULL && blob_size > 64);
+
+    /* Truncated blobs must be rejected, never crash or over-read. */
+    truncations[0] = 0;
+    truncations[1] = 4;
+    truncations[2] = blob_size / 2;
+    truncations[3] = blob_size - 1;
+    for (i = 0; i < sizeof(truncations) / sizeof(truncations[0]); i++) {
+        TEST(write_file_binary(snapshot_filename, blob, truncations[i]));
+        TEST(json_value_load_snapshot(&g_parser, snapshot_filename) == NULL);
+    }
+
+    /* Corrupted magic. */
+    blob[0] ^= 0xFF;
+    TEST(write_file_binary(snapshot_filename, blob, blob_size));
+    TEST(json_value_load_snapshot(&g_parser, snapshot_filename) == NULL);
+    blob[0] ^= 0xFF;
+
+    /* Corrupted format version. */
+    blob[4] ^= 0xFF;
+    TEST(write_file_binary(snapshot_filename, blob, blob_size));
+    TEST(json_value_load_snapshot(&g_parser, snapshot_filename) == NULL);
+    blob[4] ^= 0xFF;
+
+    /* A valid header over a garbage payload must fail the offset fixups. */
+    for (i = 16; i < blob_size; i++) {
+        blob[i] = (char)0xFF;
     }
+    TEST(write_file_binary(snapshot_filename, blob, blob_size));
+    TEST(json_value_load_snapshot(&g_parser, snapshot_filename) == NULL);
+
+    /* Nonexistent files fail cleanly too. */
+    remove(snapshot_filename);
+    TEST(json_value_load_snapshot(&g_parser, snapshot_filename) == NULL);
+
+    free(blob);
+    json_value_free(&g_parser, val);
+    TEST(g_malloc_count == 0);
+}
+
+/* A top-level array of simple records, the shape the threaded paths split. */
+static char * build_records_doc(size_t record_count) {
+    char *doc = (char*)malloc(record_count * 80 + 16);
+    char *cur = doc;
+    size_t i;
+    if (doc == NULL) {
+        return NULL;
+    }
+    *cur++ = '[';
+    for (i = 0; i < record_count; i++) {
+        cur += sprintf(cur, "%s{\"id\":%lu,\"name\":\"item-%lu\",\"vals\":[%lu,%lu.5]}",
+                       i ? "," : "", (unsigned long)i, (unsigned long)i,
+                       (unsigned long)i, (unsigned long)(i * 3));
+    }
+    *cur++ = ']';
+    *cur = '\0';
+    return doc;
+}
+
+void test_parallel_equivalence(void) {
+    /* The thread-count knobs may never change observable behavior: threaded
+       parses build the same tree and threaded serialization emits the same
+       bytes as the sequential code. Without PARSON_ENABLE_PARALLEL the knobs
+       fall back to the sequential paths, so this suite is valid either way
+       (the test_parallel make target builds with threads enabled). */
+    static const size_t thread_counts[] = { 2, 3, 8 };
+    JSON_Parser parallel_parser = g_parser;
+    char *doc = build_records_doc(2000);
+    JSON_Value *sequential = NULL;
+    JSON_Value *threaded = NULL;
+    char *sequential_out = NULL;
+    char *threaded_out = NULL;
+    size_t i;
+
+    g_malloc_count = 0;
+
+    /* Worker threads allocate concurrently and the counting test allocator is
+       not thread-safe, so the threaded parser runs on plain malloc/free
+       (the library requires a thread-safe allocator for threaded use). */
+    parallel_parser.malloc_func = uncounted_malloc;
+    parallel_parser.free_func = uncounted_free;
+
+    TEST(doc != NULL);
+    sequential = json_parse_string(&g_parser, doc);
+    TEST(sequential != NULL);
+    TEST(json_array_get_count(json_array(sequential)) == 2000);
+
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        parallel_parser.parse_thread_count = thread_counts[i];
+        threaded = json_parse_string(&parallel_parser, doc);
+        TEST(threaded != NULL);
+        TEST(json_value_equals(sequential, threaded));
+        json_value_free(&parallel_parser, threaded);
+    }
+
+    sequential_out = json_serialize_to_string(&g_parser, sequential);
+    TEST(sequential_out != NULL);
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        parallel_parser.serialize_thread_count = thread_counts[i];
+        threaded_out = json_serialize_to_string(&parallel_parser, sequential);
+        TEST(STREQ(sequential_out, threaded_out));
+        TEST(json_serialization_size(&parallel_parser, sequential) == strlen(sequential_out) + 1);
+        json_free_serialized_string(&parallel_parser, threaded_out);
+    }
+    json_free_serialized_string(&g_parser, sequential_out);
+
+    /* Pretty output must stay byte-identical as well. */
+    sequential_out = json_serialize_to_string_pretty(&g_parser, sequential);
+    TEST(sequential_out != NULL);
+    parallel_parser.serialize_thread_count = 4;
+    threaded_out = json_serialize_to_string_pretty(&parallel_parser, sequential);
+    TEST(STREQ(sequential_out, threaded_out));
+    json_free_serialized_string(&parallel_parser, threaded_out);
+    json_free_serialized_string(&g_parser, sequential_out);
+    json_value_free(&g_parser, sequential);
+
+    /* Malformed input is still rejected with threads enabled. */
+    parallel_parser.parse_thread_count = 4;
+    TEST(json_parse_string(&parallel_parser, "[1,,2]") == NULL);
+    TEST(json_parse_string(&parallel_parser, "[1,2,1abc,4]") == NULL);
+    TEST(json_parse_string(&parallel_parser, "[1,2,{\"a\":1]") == NULL);
+
+    /* Non-array roots fall back to the sequential parser. */
+    threaded = json_parse_string(&parallel_parser, "{\"a\":[1,2,3],\"b\":\"c\"}");
+    sequential = json_parse_string(&g_parser, "{\"a\":[1,2,3],\"b\":\"c\"}");
+    TEST(threaded != NULL && json_value_equals(sequential, threaded));
+    json_value_free(&parallel_parser, threaded);
+    json_value_free(&g_parser, sequential);
+
+    free(doc);
     TEST(g_malloc_count == 0);
 }
 
@@ -774,7 +1058,7 @@ void print_commits_info(const char *username, const char *repo) {
     system(curl_command);
 
     /* parsing json and validating output */
-    root_value = json_parse_file(get_file_path(output_filename));
+    root_value = json_parse_file(&g_parser, get_file_path(output_filename));
     if (json_value_get_type(root_value) != JSONArray) {
         system(cleanup_command);
         return;
@@ -792,42 +1076,42 @@ void print_commits_info(const char *username, const char *repo) {
     }
 
     /* cleanup code */
-    json_value_free(root_value);
+    json_value_free(&g_parser, root_value);
     system(cleanup_command);
 }
 
 void persistence_example(void) {
-    JSON_Value *schema = json_parse_string("{\"name\":\"\"}");
-    JSON_Value *user_data = json_parse_file(get_file_path("user_data.json"));
+    JSON_Value *schema = json_parse_string(&g_parser, "{\"name\":\"\"}");
+    JSON_Value *user_data = json_parse_file(&g_parser, get_file_path("user_data.json"));
     char buf[256];
     const char *name = NULL;
     if (user_data == NULL || json_validate(schema, user_data) != JSONSuccess) {
         puts("Enter your name:");
         scanf("%s", buf);
-        user_data = json_value_init_object();
-        json_object_set_string(json_object(user_data), "name", buf);
-        json_serialize_to_file(user_data, "user_data.json");
+        user_data = json_value_init_object(&g_parser);
+        json_object_set_string(&g_parser, json_object(user_data), "name", buf);
+        json_serialize_to_file(&g_parser, user_data, "user_data.json");
     }
     name = json_object_get_string(json_object(user_data), "name");
     printf("Hello, %s.", name);
-    json_value_free(schema);
-    json_value_free(user_data);
+    json_value_free(&g_parser, schema);
+    json_value_free(&g_parser, user_data);
     return;
 }
 
 void serialization_example(void) {
-    JSON_Value *root_value = json_value_init_object();
+    JSON_Value *root_value = json_value_init_object(&g_parser);
     JSON_Object *root_object = json_value_get_object(root_value);
     char *serialized_string = NULL;
-    json_object_set_string(root_object, "name", "John Smith");
-    json_object_set_number(root_object, "age", 25);
-    json_object_dotset_string(root_object, "address.city", "Cupertino");
-    json_object_dotset_value(root_object, "contact.emails",
-                             json_parse_string("[\"email@example.com\", \"email2@example.com\"]"));
-    serialized_string = json_serialize_to_string_pretty(root_value);
+    json_object_set_string(&g_parser, root_object, "name", "John Smith");
+    json_object_set_number(&g_parser, root_object, "age", 25);
+    json_object_dotset_string(&g_parser, root_object, "address.city", "Cupertino");
+    json_object_dotset_value(&g_parser, root_object, "contact.emails",
+                             json_parse_string(&g_parser, "[\"email@example.com\", \"email2@example.com\"]"));
+    serialized_string = json_serialize_to_string_pretty(&g_parser, root_value);
     puts(serialized_string);
-    json_free_serialized_string(serialized_string);
-    json_value_free(root_value);
+    json_free_serialized_string(&g_parser, serialized_string);
+    json_value_free(&g_parser, root_value);
 }
 
 static char * read_file(const char * file_path) {
@@ -868,6 +1152,42 @@ static char * read_file(const char * file_path) {
     return file_contents;
 }
 
+static char * read_file_binary(const char * file_path, size_t *out_size) {
+    FILE *fp = fopen(file_path, "rb");
+    long pos = 0;
+    char *contents = NULL;
+    if (!fp) {
+        return NULL;
+    }
+    fseek(fp, 0L, SEEK_END);
+    pos = ftell(fp);
+    if (pos < 0) {
+        fclose(fp);
+        return NULL;
+    }
+    rewind(fp);
+    contents = (char*)malloc(pos ? (size_t)pos : 1);
+    if (!contents || fread(contents, 1, (size_t)pos, fp) != (size_t)pos) {
+        free(contents);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *out_size = (size_t)pos;
+    return contents;
+}
+
+static int write_file_binary(const char * file_path, const char *data, size_t size) {
+    FILE *fp = fopen(file_path, "wb");
+    size_t written = 0;
+    if (!fp) {
+        return 0;
+    }
+    written = fwrite(data, 1, size, fp);
+    fclose(fp);
+    return written == size;
+}
+
 const char* get_file_path(const char *filename) {
     static char path_buf[2048] = { 0 };
     memset(path_buf, 0, sizeof(path_buf));
@@ -875,23 +1195,36 @@ const char* get_file_path(const char *filename) {
     return path_buf;
 }
 
-static void *counted_malloc(size_t size) {
+static void *counted_malloc(size_t size, void *userdata) {
     void *res = malloc(size);
+    (void)userdata;
     if (res != NULL) {
         g_malloc_count++;
     }
     return res;
 }
 
-static void counted_free(void *ptr) {
+static void counted_free(void *ptr, void *userdata) {
+    (void)userdata;
     if (ptr != NULL) {
         g_malloc_count--;
     }
     free(ptr);
 }
 
-static void *failing_malloc(size_t size) {
+static void *uncounted_malloc(size_t size, void *userdata) {
+    (void)userdata;
+    return malloc(size);
+}
+
+static void uncounted_free(void *ptr, void *userdata) {
+    (void)userdata;
+    free(ptr);
+}
+
+static void *failing_malloc(size_t size, void *userdata) {
     void *res = NULL;
+    (void)userdata;
     if (g_failing_alloc.should_fail && g_failing_alloc.total_count >= g_failing_alloc.allocation_to_fail) {
         g_failing_alloc.has_failed = 1;
         return NULL;
@@ -904,7 +1237,8 @@ static void *failing_malloc(size_t size) {
     return res;
 }
 
-static void failing_free(void *ptr) {
+static void failing_free(void *ptr, void *userdata) {
+    (void)userdata;
     if (ptr != NULL) {
         g_failing_alloc.alloc_count--;
     }